@@ -0,0 +1,41 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Helpers shared by the host benchmarks.
+
+#ifndef I2C_UNDERNEATH_BENCHMARK_H
+#define I2C_UNDERNEATH_BENCHMARK_H
+
+#include <chrono>
+#include <bus_trace/bus_trace.h>
+#include <bus_trace/bus_trace_builder.h>
+
+namespace benchmarks {
+
+// Fills 'trace' with back to back I2C messages.
+inline void build_trace(bus_trace::BusTrace& trace, size_t max_events) {
+    using bus_trace::BusTraceBuilder;
+    const size_t events_per_message = bus_trace::BusTrace::max_events_required(8, false);
+    BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::FastMode);
+    builder.bus_initially_idle();
+    uint8_t value = 0x35;
+    while (trace.event_count() + events_per_message < max_events) {
+        builder.start_bit().address_byte(0x53, BusTraceBuilder::WRITE).ack();
+        for (int i = 0; i < 8; ++i) {
+            builder.data_byte(value++).ack();
+        }
+        builder.stop_bit();
+    }
+}
+
+template<typename F>
+double time_micros(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+} // benchmarks
+
+#endif //I2C_UNDERNEATH_BENCHMARK_H
@@ -0,0 +1,129 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Measures how long it takes to analyse and decode traces of different lengths
+// on the host.
+// Run the 'bus_trace_benchmark' target built by native/CMakeLists.txt.
+
+#include <cstdio>
+#include <bus_trace/bus_trace.h>
+#include <bus_trace/bus_trace_decoder.h>
+#include <bus_trace/byte_decoder.h>
+#include <analysis/i2c_timing_analyser.h>
+#include "fakes/common/hal/fake_clock.h"
+#include "benchmark.h"
+
+using namespace bus_trace;
+using namespace benchmarks;
+
+namespace {
+
+common::hal::FakeClock fake_clock;
+
+// Simulates the analysis pattern used by I2CTimingAnalyser before it
+// became incremental. Measures the time between each SCL edge and the
+// previous SCL edge in the opposite direction.
+uint64_t scl_edge_pairs(const BusTrace& trace) {
+    uint64_t total = 0;
+    size_t previous_rise = 0;
+    size_t previous_fall = 0;
+    for (size_t i = 1; i < trace.event_count(); ++i) {
+        const BusEvent* event = trace.event(i);
+        if (event->scl_rose()) {
+            total += trace.nanos_between(i, previous_fall);
+            previous_rise = i;
+        } else if (event->scl_fell()) {
+            total += trace.nanos_between(i, previous_rise);
+            previous_fall = i;
+        }
+    }
+    return total;
+}
+
+// Copies 'trace' to 'copy' but changes the line state of the event at
+// 'index' so the messages differ there.
+void copy_with_difference(const BusTrace& trace, BusTrace& copy, size_t index) {
+    for (size_t i = 0; i < trace.event_count(); ++i) {
+        BusEvent event = *trace.event(i);
+        if (i == index) {
+            event.flags = event.flags ^ BusEventFlags::SDA_LINE_STATE;
+        }
+        copy.add_event(event);
+    }
+}
+
+// Measures the time from the start of the trace to every event.
+// This is the worst case for nanos_between() without an index.
+uint64_t time_since_start(const BusTrace& trace) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < trace.event_count(); ++i) {
+        total += trace.nanos_between(i, 0);
+    }
+    return total;
+}
+
+} // namespace
+
+int main() {
+    printf("%10s %14s %16s %16s %18s %18s %14s %14s\n", "events", "analyse (us)",
+           "scl pairs (us)", "+index (us)", "since start (us)", "+index (us)",
+           "decode (us)", "bytes (us)");
+    volatile uint64_t sink = 0;
+    for (size_t max_events = 1'000; max_events <= 64'000; max_events *= 2) {
+        BusTrace plain(&fake_clock, max_events);
+        build_trace(plain, max_events);
+        BusTrace indexed(&fake_clock, max_events);
+        build_trace(indexed, max_events);
+        indexed.enable_tick_index();
+
+        double analyse = time_micros([&]() {
+            auto analysis = analysis::I2CTimingAnalyser::analyse(plain, 100, 100);
+            sink += analysis.scl_low_time.count();
+        });
+        double pairs = time_micros([&]() { sink += scl_edge_pairs(plain); });
+        double pairs_indexed = time_micros([&]() { sink += scl_edge_pairs(indexed); });
+        double since_start = time_micros([&]() { sink += time_since_start(plain); });
+        double since_start_indexed = time_micros([&]() { sink += time_since_start(indexed); });
+        BusTraceDecoder trace_decoder(max_events);
+        double decode = time_micros([&]() {
+            trace_decoder.decode(plain);
+            sink += trace_decoder.field_count();
+        });
+        ByteDecoder byte_decoder(max_events);
+        double bytes = time_micros([&]() {
+            for (size_t i = 0; i < plain.event_count(); ++i) {
+                byte_decoder.add_event(plain.event(i)->flags);
+            }
+            sink += byte_decoder.byte_count();
+        });
+        printf("%10zu %14.0f %16.0f %16.0f %18.0f %18.0f %14.0f %14.0f\n", plain.event_count(),
+               analyse, pairs, pairs_indexed, since_start, since_start_indexed, decode, bytes);
+    }
+
+    // compare_messages() stops at the first difference so its cost should
+    // be proportional to the position of the difference. Converting both
+    // traces with to_message() first costs the same wherever it is.
+    const size_t compare_events = 10'000;
+    const int repeats = 100;
+    printf("\ncompare_messages() with %zu events. Average of %d runs.\n", compare_events, repeats);
+    printf("%16s %16s %20s\n", "difference at", "streaming (us)", "to_message (us)");
+    BusTrace trace(&fake_clock, compare_events);
+    build_trace(trace, compare_events);
+    for (int percent = 0; percent <= 100; percent += 25) {
+        size_t index = trace.event_count() * percent / 100;
+        BusTrace other(&fake_clock, compare_events);
+        copy_with_difference(trace, other, index);
+        double streaming = time_micros([&]() {
+            for (int i = 0; i < repeats; ++i) {
+                sink += trace.compare_messages(other);
+            }
+        }) / repeats;
+        double whole = time_micros([&]() {
+            for (int i = 0; i < repeats; ++i) {
+                sink += trace.to_message().compare_edges(other.to_message());
+            }
+        }) / repeats;
+        printf("%15d%% %16.1f %20.1f\n", percent, streaming, whole);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Measures the trace comparison functions on the host. Each comparison
+// is between 2 identical traces so it has to read every event. The
+// results are given per event so it's easy to spot a regression.
+// Run the 'compare_benchmark' target built by native/CMakeLists.txt.
+//
+// With '--check' it takes fewer measurements and fails if any result is
+// over a coarse limit. ctest runs it this way. The limits are an order
+// of magnitude above the times for an unoptimised build, so they only
+// catch gross regressions. e.g. a comparison that's no longer linear.
+
+#include <cstdio>
+#include <cstring>
+#include <bus_trace/bus_trace.h>
+#include "fakes/common/hal/fake_clock.h"
+#include "benchmark.h"
+
+using namespace bus_trace;
+using namespace benchmarks;
+
+namespace {
+
+common::hal::FakeClock fake_clock;
+
+// Limits for --check in nanoseconds per event
+const double MAX_NANOS_PER_EDGE_COMPARISON = 100.0;
+const double MAX_NANOS_PER_MESSAGE_COMPARISON = 1'000.0;
+
+// Number of events read by each measurement
+size_t events_per_measurement = 10'000'000;
+
+int repeats_for(size_t event_count) {
+    size_t repeats = events_per_measurement / (event_count ? event_count : 1);
+    return repeats ? (int)repeats : 1;
+}
+
+// Returns the average time per event in nanoseconds.
+template<typename F>
+double nanos_per_event(size_t event_count, F&& compare) {
+    int repeats = repeats_for(event_count);
+    double micros = time_micros([&]() {
+        for (int i = 0; i < repeats; ++i) {
+            compare();
+        }
+    });
+    return micros * 1'000 / ((double)repeats * (double)event_count);
+}
+
+// Returns false and reports the failure if 'nanos' is over 'limit'.
+bool within_limit(const char* name, size_t event_count, double nanos, double limit) {
+    if (nanos > limit) {
+        printf("FAIL: %s took %.2f nanos per event for %zu events. The limit is %.2f\n",
+               name, nanos, event_count, limit);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    if (check) {
+        events_per_measurement = 1'000'000;
+    }
+    bool ok = true;
+    printf("Nanoseconds per event when comparing identical traces.\n");
+    printf("%10s %14s %16s %18s %18s\n", "events", "compare_edges",
+           "is_identical_to", "compare_messages", "edges circular");
+    volatile size_t sink = 0;
+    for (size_t max_events = 1'000; max_events <= 64'000; max_events *= 4) {
+        BusTrace trace(&fake_clock, max_events);
+        build_trace(trace, max_events);
+        BusTrace other(&fake_clock, max_events);
+        build_trace(other, max_events);
+        size_t count = trace.event_count();
+
+        // A circular trace that has wrapped around
+        BusTrace circular(&fake_clock, count);
+        circular.set_circular(true);
+        for (size_t i = 0; i < count + count / 2; ++i) {
+            circular.add_event(*trace.event(i % count));
+        }
+
+        double edges = nanos_per_event(count, [&]() { sink += trace.compare_edges(other); });
+        double identical = nanos_per_event(count, [&]() { sink += trace.is_identical_to(other); });
+        double messages = nanos_per_event(count, [&]() { sink += trace.compare_messages(other); });
+        double wrapped = nanos_per_event(count, [&]() { sink += circular.compare_edges(circular); });
+        printf("%10zu %14.2f %16.2f %18.2f %18.2f\n", count, edges, identical, messages, wrapped);
+        if (check) {
+            ok &= within_limit("compare_edges", count, edges, MAX_NANOS_PER_EDGE_COMPARISON);
+            ok &= within_limit("is_identical_to", count, identical, MAX_NANOS_PER_EDGE_COMPARISON);
+            ok &= within_limit("compare_messages", count, messages, MAX_NANOS_PER_MESSAGE_COMPARISON);
+            ok &= within_limit("circular compare_edges", count, wrapped, MAX_NANOS_PER_EDGE_COMPARISON);
+        }
+    }
+    return ok ? 0 : 1;
+}
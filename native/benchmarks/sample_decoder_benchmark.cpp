@@ -0,0 +1,117 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Measures how fast GpioSampleDecoder turns GPIO samples into BusEvents.
+// Compare the results with the sample rate you need for a given bus
+// speed to decide whether sampling or interrupt capture is better.
+// e.g. sampling a 1 MHz bus at 24 MHz gives an edge every 12 samples.
+// Run the 'sample_decoder_benchmark' target built by native/CMakeLists.txt.
+
+#include <cstdio>
+#include <vector>
+#include <bus_trace/bus_trace.h>
+#include <bus_trace/gpio_sample_decoder.h>
+#include "benchmark.h"
+
+using namespace bus_trace;
+using namespace benchmarks;
+
+namespace {
+
+const uint32_t SDA_MASK = 1 << 16;
+const uint32_t SCL_MASK = 1 << 17;
+const size_t SAMPLE_COUNT = 1 << 20;
+
+// Toggles SCL every 'interval' samples and SDA every other time.
+// Other bits change randomly like the other pins on the port.
+std::vector<uint32_t> make_samples(size_t interval) {
+    std::vector<uint32_t> samples(SAMPLE_COUNT);
+    uint32_t state = SDA_MASK | SCL_MASK;
+    uint32_t random = 1;
+    for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+        if (interval && i % interval == 0) {
+            state ^= SCL_MASK;
+            if (i % (2 * interval) == 0) {
+                state ^= SDA_MASK;
+            }
+        }
+        random = random * 1103515245 + 12345;
+        samples[i] = state | (random & 0xFFFF);
+    }
+    return samples;
+}
+
+// The obvious implementation. Compares one sample at a time.
+// It does the same work for each event as GpioSampleDecoder.
+size_t decode_one_at_a_time(BusTrace& trace, const uint32_t* samples, size_t count) {
+    const uint32_t masks = SDA_MASK | SCL_MASK;
+    uint32_t previous = samples[0] & masks;
+    uint64_t last_event = 0;
+    size_t merged = 0;
+    for (size_t i = 1; i < count; ++i) {
+        uint32_t sample = samples[i] & masks;
+        if (sample != previous) {
+            uint8_t states = ((sample & SDA_MASK) ? SDA_LINE_STATE : 0) | ((sample & SCL_MASK) ? SCL_LINE_STATE : 0);
+            uint8_t changed = ((sample ^ previous) & SDA_MASK ? SDA_LINE_CHANGED : 0) |
+                              ((sample ^ previous) & SCL_MASK ? SCL_LINE_CHANGED : 0);
+            merged += (changed == (SDA_LINE_CHANGED | SCL_LINE_CHANGED));
+            uint64_t delta = i - last_event;
+            trace.add_event_with_delta(delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta, (BusEventFlags)(changed | states));
+            last_event = i;
+            previous = sample;
+        }
+    }
+    return merged;
+}
+
+// Keeps the merged event count so the compiler can't skip calculating it
+volatile size_t merged_events;
+
+// Returns millions of samples per second. Takes the best of several
+// runs to reduce the noise from other processes.
+template<typename F>
+double megasamples_per_second(F&& decode) {
+    const int runs = 5;
+    const int repeats = 20;
+    double best = 0;
+    for (int run = 0; run < runs; ++run) {
+        double micros = time_micros([&]() {
+            for (int i = 0; i < repeats; ++i) {
+                decode();
+            }
+        });
+        double rate = (double)repeats * SAMPLE_COUNT / micros;
+        if (rate > best) {
+            best = rate;
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+int main() {
+    printf("Millions of samples decoded per second.\n");
+    printf("%20s %10s %16s %18s\n", "samples per edge", "events", "one at a time", "GpioSampleDecoder");
+    const size_t intervals[] = {0, 2'400, 120, 30, 12, 4, 1};
+    BusTrace trace(SAMPLE_COUNT + 1);
+    for (size_t interval : intervals) {
+        std::vector<uint32_t> samples = make_samples(interval);
+        double simple = megasamples_per_second([&]() {
+            trace.reset();
+            merged_events = decode_one_at_a_time(trace, samples.data(), samples.size());
+        });
+        double kernel = megasamples_per_second([&]() {
+            trace.reset();
+            GpioSampleDecoder decoder(trace, SDA_MASK, SCL_MASK);
+            decoder.add_samples(samples.data(), samples.size());
+            merged_events = decoder.merged_event_count();
+        });
+        if (interval) {
+            printf("%20zu %10zu %16.1f %18.1f\n", interval, trace.event_count(), simple, kernel);
+        } else {
+            printf("%20s %10zu %16.1f %18.1f\n", "idle", trace.event_count(), simple, kernel);
+        }
+    }
+    return 0;
+}
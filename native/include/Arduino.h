@@ -0,0 +1,59 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Host replacement for the Arduino core.
+// Provides just enough of the Arduino API to build the trace and
+// analysis code on a desktop machine. It does not emulate the hardware.
+
+#ifndef I2C_UNDERNEATH_NATIVE_ARDUINO_H
+#define I2C_UNDERNEATH_NATIVE_ARDUINO_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include "Print.h"
+#include "Printable.h"
+#include "Stream.h"
+#include "WString.h"
+
+using std::min;
+using std::max;
+
+// Writes to stdout.
+class HostSerial : public Print {
+public:
+    size_t write(uint8_t b) override {
+        return fputc(b, stdout) == EOF ? 0 : 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        return fwrite(buffer, 1, size, stdout);
+    }
+
+    using Print::write;
+};
+
+inline HostSerial Serial;
+
+inline uint32_t micros() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint32_t millis() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline void delayNanoseconds(uint32_t nanos) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(nanos);
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+inline void delayMicroseconds(uint32_t micros) {
+    delayNanoseconds(micros * 1'000);
+}
+
+#endif //I2C_UNDERNEATH_NATIVE_ARDUINO_H
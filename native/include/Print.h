@@ -0,0 +1,70 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Host replacement for the Arduino core's Print class.
+// Only implements the parts of the API used by this library.
+
+#ifndef I2C_UNDERNEATH_NATIVE_PRINT_H
+#define I2C_UNDERNEATH_NATIVE_PRINT_H
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "Printable.h"
+#include "WString.h"
+
+class Print {
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t b) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t count = 0;
+        while (size--) {
+            count += write(*buffer++);
+        }
+        return count;
+    }
+
+    size_t write(const char* s) {
+        return write((const uint8_t*)s, strlen(s));
+    }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return printf("%d", n); }
+    size_t print(unsigned int n) { return printf("%u", n); }
+    size_t print(long n) { return printf("%ld", n); }
+    size_t print(unsigned long n) { return printf("%lu", n); }
+    size_t print(long long n) { return printf("%lld", n); }
+    size_t print(unsigned long long n) { return printf("%llu", n); }
+    size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+    size_t print(const Printable& obj) { return obj.printTo(*this); }
+
+    size_t println() { return write("\r\n"); }
+
+    template<typename T>
+    size_t println(const T& value) {
+        size_t count = print(value);
+        return count + println();
+    }
+
+    __attribute__((format(printf, 2, 3)))
+    size_t printf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        char buffer[256];
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length < 0) {
+            return 0;
+        }
+        return write((const uint8_t*)buffer, std::min((size_t)length, sizeof(buffer) - 1));
+    }
+};
+
+#endif //I2C_UNDERNEATH_NATIVE_PRINT_H
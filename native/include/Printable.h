@@ -0,0 +1,21 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Host replacement for the Arduino core's Printable.h
+
+#ifndef I2C_UNDERNEATH_NATIVE_PRINTABLE_H
+#define I2C_UNDERNEATH_NATIVE_PRINTABLE_H
+
+#include <cstddef>
+
+class Print;
+
+// Implemented by classes that know how to print themselves.
+class Printable {
+public:
+    virtual ~Printable() = default;
+
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+#endif //I2C_UNDERNEATH_NATIVE_PRINTABLE_H
@@ -0,0 +1,43 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Host replacement for the Arduino core's Stream class.
+// Only implements the parts of the API used by this library.
+
+#ifndef I2C_UNDERNEATH_NATIVE_STREAM_H
+#define I2C_UNDERNEATH_NATIVE_STREAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include "Print.h"
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+
+    // Returns the next byte or -1 if there isn't one.
+    virtual int read() = 0;
+
+    virtual int peek() = 0;
+
+    // Reads bytes until 'length' bytes have been read or there are no more.
+    // Returns the number of bytes read.
+    size_t readBytes(char* buffer, size_t length) {
+        size_t count = 0;
+        while (count < length) {
+            int c = read();
+            if (c < 0) {
+                break;
+            }
+            *buffer++ = (char)c;
+            count++;
+        }
+        return count;
+    }
+
+    size_t readBytes(uint8_t* buffer, size_t length) {
+        return readBytes((char*)buffer, length);
+    }
+};
+
+#endif //I2C_UNDERNEATH_NATIVE_STREAM_H
@@ -0,0 +1,74 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Host replacement for the Arduino core's String class.
+// Only implements the parts of the API used by this library.
+
+#ifndef I2C_UNDERNEATH_NATIVE_WSTRING_H
+#define I2C_UNDERNEATH_NATIVE_WSTRING_H
+
+#include <string>
+
+class String {
+public:
+    String() = default;
+
+    String(const char* value) : value(value ? value : "") {   // NOLINT(google-explicit-constructor)
+    }
+
+    String& append(char c) {
+        value.push_back(c);
+        return *this;
+    }
+
+    String& append(const char* s) {
+        value.append(s);
+        return *this;
+    }
+
+    String& append(const String& s) {
+        value.append(s.value);
+        return *this;
+    }
+
+    String& operator+=(char c) {
+        return append(c);
+    }
+
+    String& operator+=(const char* s) {
+        return append(s);
+    }
+
+    String& operator+=(const String& s) {
+        return append(s);
+    }
+
+    int compareTo(const String& other) const {
+        return value.compare(other.value);
+    }
+
+    bool equals(const String& other) const {
+        return value == other.value;
+    }
+
+    bool operator==(const String& other) const {
+        return equals(other);
+    }
+
+    bool operator!=(const String& other) const {
+        return !equals(other);
+    }
+
+    unsigned int length() const {
+        return (unsigned int)value.length();
+    }
+
+    const char* c_str() const {
+        return value.c_str();
+    }
+
+private:
+    std::string value;
+};
+
+#endif //I2C_UNDERNEATH_NATIVE_WSTRING_H
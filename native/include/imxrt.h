@@ -0,0 +1,6 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+//
+// Host replacement for the Teensy 4 register definitions.
+// Deliberately empty. Code that touches the i.MX RT registers
+// is not built for the host.
@@ -8,6 +8,8 @@
 
 namespace analysis {
 
+class StreamingTimingAnalyser;
+
 class I2CTimingAnalyser {
 public:
     static const uint16_t DEFAULT_FALL_TIME = 8;
@@ -23,6 +25,9 @@ public:
     // Will not record all times if 'trace' contains any events in which SDA and
     // SCL changed at the same time. You can use BusTrace::to_message() to split
     // merged events.
+    //
+    // Use StreamingTimingAnalyser if you want to analyse events as they're
+    // recorded instead.
     static I2CTimingAnalysis analyse(const bus_trace::BusTrace& trace,
                                      uint16_t sda_rise_time,
                                      uint16_t scl_rise_time,
@@ -30,6 +35,8 @@ public:
                                      uint16_t scl_fall_time = DEFAULT_FALL_TIME);
 
 private:
+    friend class StreamingTimingAnalyser;
+
     class Adjuster {
     public:
         Adjuster(uint16_t sda_rise_time, uint16_t sda_fall_time, uint16_t scl_rise_time, uint16_t scl_fall_time);
@@ -0,0 +1,127 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <Arduino.h>
+#include "streaming_timing_analyser.h"
+
+namespace analysis {
+
+StreamingTimingAnalyser::StreamingTimingAnalyser(const common::hal::Clock* clock,
+                                                 uint16_t sda_rise_time, uint16_t scl_rise_time,
+                                                 uint16_t sda_fall_time, uint16_t scl_fall_time)
+    : clock(clock),
+      adjust(sda_rise_time, sda_fall_time, scl_rise_time, scl_fall_time),
+      sda_rise_time(sda_rise_time),
+      sda_fall_time(sda_fall_time) {
+}
+
+void StreamingTimingAnalyser::reset() {
+    analysis_ = I2CTimingAnalysis();
+    event_count_ = 0;
+    previous_event = bus_trace::BusEvent(0, bus_trace::BusEventFlags::BOTH_LOW_AND_UNCHANGED);
+    current_tick = 0;
+    extension_ticks = 0;
+    previous_scl_rise_tick = 0;
+    previous_scl_fall_tick = 0;
+    latest_clock_low = 0;
+    data_changed = false;
+}
+
+void StreamingTimingAnalyser::add_event(const bus_trace::BusEvent& event) {
+    if (event_count_++ == 0) {
+        // The first event should be both lines high. It just gives
+        // us the initial state of the bus.
+        previous_event = event;
+        return;
+    }
+    if (event.is_time_extension()) {
+        // Not a real event. Add the time to the next event.
+        extension_ticks += event.ticks();
+        return;
+    }
+    const uint32_t ticks = extension_ticks + event.delta_t_in_ticks;
+    extension_ticks = 0;
+    current_tick += ticks;
+    const uint32_t nanos_to_previous = ticks_to_nanos(ticks);
+    auto flags = event.flags;
+    if (flags & bus_trace::BusEventFlags::SCL_LINE_CHANGED) {
+        // SCL changed
+        if (event.scl_rose()) {
+            // SCL LOW -> HIGH
+            previous_scl_rise_tick = current_tick;
+            latest_clock_low = ticks_to_nanos(current_tick - previous_scl_fall_tick);
+            analysis_.scl_low_time.include(adjust.clock_low_time(latest_clock_low));
+            if (data_changed) {
+                analysis_.data_setup_time.include(adjust.data_setup_time(nanos_to_previous, previous_event.sda_rose()));
+                data_changed = false;
+            }
+        } else {
+            // SCL HIGH -> LOW
+            previous_scl_fall_tick = current_tick;
+            if (previous_event.scl_rose()) {
+                // This is a data bit or a NACK/ACK
+                auto clock_high = ticks_to_nanos(current_tick - previous_scl_rise_tick);
+                analysis_.scl_high_time.include(adjust.clock_high_time(clock_high));
+
+                // Calculate frequency for the last clock cycle
+                auto period = clock_high + latest_clock_low;
+                auto frequency = (uint32_t)((1e9 * 1.0) / period);
+                analysis_.clock_frequency.include(frequency);
+            } else if (previous_event.sda_fell()) {
+                // SCL HIGH -> LOW after SDA fell. This is a START condition.
+                analysis_.start_hold_time.include(adjust.start_hold_time(nanos_to_previous));
+            } else {
+                Serial.println("Invalid Trace: Found SCL falling edge but not a data bit or STOP condition.");
+            }
+        }
+    } else {
+        // SDA changed
+        if (flags & bus_trace::BusEventFlags::SCL_LINE_STATE) {
+            // SDA LOW -> HIGH while SCL is HIGH. This is a STOP or START condition.
+            if (event.sda_rose()) {
+                // SDA LOW -> HIGH while SCL is HIGH. This is a STOP condition.
+                analysis_.stop_setup_time.include(adjust.setup_stop_time(nanos_to_previous));
+            } else {
+                // SDA HIGH -> LOW while SCL is HIGH. This is a START condition.
+                if (previous_event.scl_rose()) {
+                    // This is a repeated START condition
+                    analysis_.start_setup_time.include(adjust.setup_start_time(nanos_to_previous));
+                } else if (previous_event.sda_rose()) {
+                    // This is START following a STOP
+                    analysis_.bus_free_time.include(adjust.bus_free_time(nanos_to_previous));
+                } else if (previous_event.flags == (bus_trace::BusEventFlags::SDA_LINE_STATE | bus_trace::BusEventFlags::SCL_LINE_STATE)) {
+                    // This is START at the beginning of a trace
+                    // There are no I2C requirements for the interval so ignore it.
+                } else {
+                    // The previous event must have been SDA falling as well.
+                    // This doesn't make sense.
+                    Serial.println("Invalid Trace: Found 2 falling edges on SDA in a row.");
+                }
+            }
+        } else {
+            // SDA changed while SCL is LOW. This is the setup for a data bit or an ACK
+            data_changed = true;
+            if (previous_event.scl_fell()) {
+                // SDA changed after SCL fell.
+                bool sda_rose = event.sda_rose();
+                uint32_t adjusted_data_hold_time = adjust.data_hold_time(nanos_to_previous, sda_rose);
+                analysis_.data_hold_time.include(adjusted_data_hold_time);
+
+                uint32_t data_valid_time = adjusted_data_hold_time + (sda_rose ? sda_rise_time : sda_fall_time);
+                analysis_.data_valid_time.include(data_valid_time);
+            }
+            // else SDA changed more than once while SCL is LOW. Ignore it.
+        }
+    }
+    previous_event = event;
+}
+
+uint32_t StreamingTimingAnalyser::ticks_to_nanos(uint32_t ticks) const {
+    if (!clock) {
+        // Can't calculate a result. Return an error code.
+        return UINT32_MAX;
+    }
+    return clock->ticks_to_nanos(ticks);
+}
+
+} // analysis
@@ -0,0 +1,73 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_STREAMING_TIMING_ANALYSER_H
+#define I2C_UNDERNEATH_STREAMING_TIMING_ANALYSER_H
+
+#include <cstdint>
+#include <bus_trace/bus_event.h>
+#include <common/hal/clock.h>
+#include <analysis/i2c_timing_analyser.h>
+#include <analysis/i2c_timing_analysis.h>
+
+namespace analysis {
+
+// Analyses the timings of an I2C bus one event at a time.
+//
+// This gives the same results as I2CTimingAnalyser::analyse() but it doesn't
+// need a BusTrace. You can feed it the events from a BusEventQueue while
+// the BusRecorder is running. Each event takes a fixed amount of work
+// regardless of how many events have been analysed already.
+//
+// See I2CTimingAnalyser::analyse() for an explanation of the rise and fall times.
+class StreamingTimingAnalyser {
+public:
+    // 'clock' converts the event deltas to nanoseconds. It must be the clock
+    // that was used to record the events. All times are UINT32_MAX if
+    // 'clock' is nullptr.
+    StreamingTimingAnalyser(const common::hal::Clock* clock,
+                            uint16_t sda_rise_time,
+                            uint16_t scl_rise_time,
+                            uint16_t sda_fall_time = I2CTimingAnalyser::DEFAULT_FALL_TIME,
+                            uint16_t scl_fall_time = I2CTimingAnalyser::DEFAULT_FALL_TIME);
+
+    // Updates the analysis with the next event.
+    // The first event is taken to be the initial state of the bus.
+    void add_event(const bus_trace::BusEvent& event);
+
+    // The analysis of all the events added since this object was
+    // created or reset.
+    inline const I2CTimingAnalysis& analysis() const {
+        return analysis_;
+    }
+
+    // The number of events added since this object was created or reset.
+    inline uint32_t event_count() const {
+        return event_count_;
+    }
+
+    // Discards the analysis so we can start again.
+    void reset();
+
+private:
+    const common::hal::Clock* clock;
+    const I2CTimingAnalyser::Adjuster adjust;
+    const uint16_t sda_rise_time;
+    const uint16_t sda_fall_time;
+
+    I2CTimingAnalysis analysis_;
+    uint32_t event_count_ = 0;
+    bus_trace::BusEvent previous_event = bus_trace::BusEvent(0, bus_trace::BusEventFlags::BOTH_LOW_AND_UNCHANGED);
+    uint32_t current_tick = 0;          // Ticks since the first event. Wraps round which is fine as we only need differences.
+    uint32_t extension_ticks = 0;       // Ticks from time extension events that precede the next event
+    uint32_t previous_scl_rise_tick = 0;
+    uint32_t previous_scl_fall_tick = 0;
+    uint32_t latest_clock_low = 0;
+    bool data_changed = false;
+
+    uint32_t ticks_to_nanos(uint32_t ticks) const;
+};
+
+} // analysis
+
+#endif //I2C_UNDERNEATH_STREAMING_TIMING_ANALYSER_H
@@ -0,0 +1,36 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "address_filtered_trace.h"
+
+namespace bus_trace {
+
+AddressFilteredTrace::AddressFilteredTrace(BusTrace& trace)
+    : trace(trace) {
+}
+
+bool AddressFilteredTrace::add_address(uint8_t address, uint8_t mask) {
+    if (address_count == MAX_ADDRESSES) {
+        return false;
+    }
+    addresses[address_count] = address & 0x7F;
+    masks[address_count] = mask & 0x7F;
+    address_count++;
+    return true;
+}
+
+void AddressFilteredTrace::clear_addresses() {
+    address_count = 0;
+}
+
+void AddressFilteredTrace::reset(uint32_t current_tick_count) {
+    trace.reset();
+    decoder.reset();
+    state = State::Initial;
+    pending_count = 0;
+    ticks_start = current_tick_count;
+    kept_transactions = 0;
+    discarded_transactions = 0;
+}
+
+} // bus_trace
@@ -0,0 +1,181 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_ADDRESS_FILTERED_TRACE_H
+#define I2C_UNDERNEATH_ADDRESS_FILTERED_TRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+#include "byte_decoder.h"
+
+namespace bus_trace {
+
+// Only records the transactions sent to the addresses you're interested
+// in. This lets you watch one device on a busy bus without filling the
+// trace with everybody else's traffic.
+// e.g. to record transactions for devices 0x50 to 0x57 and 0x68
+//   AddressFilteredTrace filtered(trace);
+//   filtered.add_address(0x50, 0x78);
+//   filtered.add_address(0x68);
+//
+// A transaction runs from a START to the next STOP. Its events are held
+// back until its address has been decoded. They're then either added to
+// the trace or discarded along with the rest of the transaction. Repeated
+// STARTs are part of the current transaction so a register read is kept
+// or discarded as a whole. The time between the transactions that are
+// kept is preserved.
+//
+// The first event after reset() is always added to the trace as it gives
+// the initial state of the lines. Events outside of a transaction are
+// discarded.
+//
+// add_event() is called by the BusRecorder's interrupt service routine.
+class AddressFilteredTrace {
+public:
+    // The maximum number of address patterns. See add_address()
+    static const size_t MAX_ADDRESSES = 4;
+
+    // The maximum number of events held back while we wait for the
+    // address. A START and an address byte take fewer than 30.
+    // A transaction is discarded if it needs more.
+    static const size_t MAX_PENDING_EVENTS = 48;
+
+    explicit AddressFilteredTrace(BusTrace& trace);
+
+    AddressFilteredTrace(const AddressFilteredTrace&) = delete;
+    AddressFilteredTrace& operator=(const AddressFilteredTrace&) = delete;
+
+    // Keeps transactions whose 7 bit address matches 'address' in every
+    // bit that's set in 'mask'. Use a mask of 0x7F to match one address.
+    // Returns false if there are already MAX_ADDRESSES patterns.
+    bool add_address(uint8_t address, uint8_t mask = 0x7F);
+
+    // Removes all the address patterns. No transactions are kept
+    // until another one is added.
+    void clear_addresses();
+
+    // True if transactions to 'address' are kept.
+    inline bool matches(uint8_t address) const {
+        for (size_t i = 0; i < address_count; ++i) {
+            if (((address ^ addresses[i]) & masks[i]) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline BusTrace& get_trace() const {
+        return trace;
+    }
+
+    // Empties the trace and forgets the state of the bus. Sets the time
+    // of the previous event to 'current_tick_count'. Keeps the addresses.
+    // NOT safe to call while recording.
+    void reset(uint32_t current_tick_count = 0);
+
+    // The number of transactions added to the trace since the last reset.
+    inline size_t kept_transaction_count() const {
+        return kept_transactions;
+    }
+
+    // The number of transactions discarded since the last reset. Includes
+    // transactions that were discarded because they had too many events
+    // before the address. See MAX_PENDING_EVENTS
+    inline size_t discarded_transaction_count() const {
+        return discarded_transactions;
+    }
+
+    // Adds an event that happened at 'current_tick_count'.
+    inline void add_event(uint32_t current_tick_count, BusEventFlags flags) {
+        const DecodedByte::Type type = decoder.add_event(flags);
+        if (type == DecodedByte::Type::Start) {
+            // A new transaction. Forget anything that happened before it.
+            state = State::Addressing;
+            pending_count = 0;
+        }
+        switch (state) {
+            case State::Keeping:
+                commit(current_tick_count, flags);
+                if (type == DecodedByte::Type::Stop) {
+                    state = State::Idle;
+                }
+                break;
+            case State::Addressing:
+                if (pending_count == MAX_PENDING_EVENTS) {
+                    state = State::Discarding;
+                    discarded_transactions++;
+                    break;
+                }
+                pending[pending_count++] = {current_tick_count, flags};
+                if (type == DecodedByte::Type::AddressAck || type == DecodedByte::Type::AddressNack) {
+                    if (matches(decoder.last_value() >> 1)) {
+                        for (size_t i = 0; i < pending_count; ++i) {
+                            commit(pending[i].tick, pending[i].flags);
+                        }
+                        state = State::Keeping;
+                        kept_transactions++;
+                    } else {
+                        state = State::Discarding;
+                        discarded_transactions++;
+                    }
+                    pending_count = 0;
+                } else if (type == DecodedByte::Type::Stop) {
+                    // STOP before the address. Nothing to keep.
+                    state = State::Idle;
+                    pending_count = 0;
+                }
+                break;
+            case State::Discarding:
+                if (type == DecodedByte::Type::Stop) {
+                    state = State::Idle;
+                }
+                break;
+            case State::Initial:
+                commit(current_tick_count, flags);
+                state = State::Idle;
+                break;
+            case State::Idle:
+                break;
+        }
+    }
+
+private:
+    enum class State : uint8_t {
+        Initial,    // Waiting for the first event
+        Idle,       // Between transactions
+        Addressing, // Holding events back until we know the address
+        Keeping,    // Adding events to the trace
+        Discarding  // Ignoring events until the next STOP
+    };
+
+    struct PendingEvent {
+        uint32_t tick;
+        BusEventFlags flags;
+    };
+
+    BusTrace& trace;
+    uint8_t addresses[MAX_ADDRESSES] = {};
+    uint8_t masks[MAX_ADDRESSES] = {};
+    size_t address_count = 0;
+
+    // The decoder doesn't keep any bytes. We just want to know
+    // when each byte is completed.
+    ByteDecoder decoder{nullptr, 0};
+    State state = State::Initial;
+    PendingEvent pending[MAX_PENDING_EVENTS] = {};
+    size_t pending_count = 0;
+    uint32_t ticks_start = 0;   // Time of the last event added to the trace
+    size_t kept_transactions = 0;
+    size_t discarded_transactions = 0;
+
+    inline void commit(uint32_t tick, BusEventFlags flags) {
+        trace.add_event_with_delta(tick - ticks_start, flags);
+        ticks_start = tick;
+    }
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_ADDRESS_FILTERED_TRACE_H
@@ -26,6 +26,10 @@ public:
     // between events. The SMBus time out is 35 ms which is 35,000,000 nanos.
     // This would require a 4 byte type. 2 bytes between events gives 109,000
     // nanos on a Teensy 4. Enough for a 9 KHz baud rate. SMBus is minimum of 10 kHz
+    //
+    // Longer gaps, such as idle time between messages, are recorded by
+    // putting a time extension event in front of the event.
+    // See time_extension()
     uint16_t delta_t_in_ticks;
 
     // Describes the event that happened and the state of the bus lines.
@@ -33,6 +37,35 @@ public:
 
 //    uint8_t unused; // Pack byte.
 
+    // The number of ticks between 2 events can be larger than
+    // delta_t_in_ticks can hold. In that case, the trace contains a
+    // time extension event followed by the real event. The delta of the
+    // extension event holds the top 16 bits of the gap and the delta of
+    // the real event holds the bottom 16 bits.
+    //
+    // A time extension event doesn't change either line. Its line states
+    // are the states before 'next_flags'.
+    static BusEvent time_extension(uint32_t ticks_to_next_event, BusEventFlags next_flags) {
+        const uint8_t line_states = next_flags & (BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE);
+        const uint8_t changed_lines = (next_flags >> 2) & (BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE);
+        return BusEvent((uint16_t)(ticks_to_next_event >> 16),
+                        (BusEventFlags)(BusEventFlags::TIME_EXTENSION | (line_states ^ changed_lines)));
+    }
+
+    // True if this event just extends the time to the next event.
+    // See time_extension()
+    bool is_time_extension() const {
+        const uint8_t mask = BusEventFlags::TIME_EXTENSION | BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_CHANGED;
+        return (flags & mask) == BusEventFlags::TIME_EXTENSION;
+    }
+
+    // The number of ticks that this event adds to the time since the
+    // start of the trace. This is delta_t_in_ticks for all events
+    // except time extensions.
+    uint32_t ticks() const {
+        return is_time_extension() ? (uint32_t)delta_t_in_ticks << 16 : delta_t_in_ticks;
+    }
+
     bool scl_fell() const {
         return includes_flags(BusEventFlags::SCL_LINE_CHANGED) && excludes_flags(BusEventFlags::SCL_LINE_STATE);
     }
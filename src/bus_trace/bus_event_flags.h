@@ -36,7 +36,12 @@ enum BusEventFlags : uint8_t {
     SCL_LINE_CHANGED = 1 << (uint8_t)BusEventFlagBits::SCL_LINE_CHANGED_BIT,
     SDA_LINE_STATE = 1 << (uint8_t)BusEventFlagBits::SDA_LINE_STATE_BIT,
     SCL_LINE_STATE = 1 << (uint8_t)BusEventFlagBits::SCL_LINE_STATE_BIT,
-    BOTH_LOW_AND_UNCHANGED = 0
+    BOTH_LOW_AND_UNCHANGED = 0,
+    // Marks an event that only extends the time to the next event.
+    // Both pins can't change without a line changing so this
+    // combination never describes a real event.
+    // See BusEvent::is_time_extension()
+    TIME_EXTENSION = SDA_PIN_CHANGED | SCL_PIN_CHANGED
 };
 
 // Sets bit 'bit' of 'flags' with the new value
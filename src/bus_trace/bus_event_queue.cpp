@@ -0,0 +1,43 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "bus_event_queue.h"
+
+namespace bus_trace {
+
+BusEventQueue::BusEventQueue(size_t capacity)
+    : events(new BusEvent[round_down_to_power_of_2(capacity)]), created_events(true),
+      max_size(round_down_to_power_of_2(capacity)), mask(max_size ? max_size - 1 : 0) {
+}
+
+BusEventQueue::BusEventQueue(BusEvent* events, size_t capacity)
+    : events(events), created_events(false),
+      max_size(round_down_to_power_of_2(capacity)), mask(max_size ? max_size - 1 : 0) {
+}
+
+BusEventQueue::~BusEventQueue() {
+    if (created_events && events) {
+        delete[] events;
+        events = nullptr;
+    }
+}
+
+void BusEventQueue::reset(uint32_t current_tick_count) {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    dropped_events.store(0, std::memory_order_relaxed);
+    ticks_start = current_tick_count;
+}
+
+size_t BusEventQueue::round_down_to_power_of_2(size_t value) {
+    if (value == 0) {
+        return 0;   // A queue with no space. push() discards everything.
+    }
+    size_t result = 1;
+    while (result <= value / 2) {
+        result *= 2;
+    }
+    return result;
+}
+
+} // bus_trace
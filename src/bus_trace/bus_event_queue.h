@@ -0,0 +1,136 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_EVENT_QUEUE_H
+#define I2C_UNDERNEATH_BUS_EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+
+namespace bus_trace {
+
+// A fixed size, lock-free queue of BusEvents with a single producer
+// and a single consumer.
+//
+// This lets a BusRecorder record continuously. The recorder's interrupt
+// service routine pushes events onto the queue and the application's
+// loop() pops them off again at the same time. Neither side has to
+// disable interrupts or take a lock. Recording can continue forever as
+// long as the consumer keeps up. Events are dropped if the queue is full.
+//
+// Only one thread (or ISR) may call the producer methods and only one
+// may call the consumer methods. reset() must not be called while
+// either side is active.
+class BusEventQueue {
+public:
+    // Creates a queue that can hold 'capacity' events.
+    // 'capacity' is rounded down to a power of 2. A queue with a
+    // capacity of 0 can't hold any events. Every push() is discarded.
+    explicit BusEventQueue(size_t capacity);
+
+    // Allows you to define the array of events wherever you want.
+    // events: an array of BusEvents that will be used by the queue
+    // capacity: the number of events in 'events'. The queue only uses
+    // the largest power of 2 that is less than or equal to 'capacity'.
+    // The queue can't hold any events if 'capacity' is 0.
+    BusEventQueue(BusEvent* events, size_t capacity);
+
+    ~BusEventQueue();
+
+    BusEventQueue(const BusEventQueue&) = delete;
+    BusEventQueue& operator=(const BusEventQueue&) = delete;
+
+    // The maximum number of events in the queue. Always a power of 2.
+    inline size_t capacity() const {
+        return max_size;
+    }
+
+    // The number of events waiting to be popped.
+    // The result is a snapshot. It may be out of date by the time you use it.
+    inline size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    inline bool empty() const {
+        return size() == 0;
+    }
+
+    // The number of events that were discarded because the queue was full.
+    inline size_t dropped_event_count() const {
+        return dropped_events.load(std::memory_order_relaxed);
+    }
+
+    // Empties the queue and sets the time of the previous event to
+    // 'current_tick_count'. NOT safe to call while the queue is in use.
+    void reset(uint32_t current_tick_count = 0);
+
+    // PRODUCER
+    // Adds an event to the queue. Returns false and discards the event
+    // if the queue is full.
+    inline bool push(const BusEvent& event) {
+        const size_t current_head = head.load(std::memory_order_relaxed);
+        if (current_head - tail.load(std::memory_order_acquire) >= max_size) {
+            dropped_events.store(dropped_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        events[current_head & mask] = event;
+        head.store(current_head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // PRODUCER
+    // Adds an event that happened at 'current_tick_count'.
+    // The event's delta is the time since the previous event that was
+    // actually added to the queue. This means that dropping an event doesn't
+    // affect the timing of the events that follow it.
+    //
+    // If the delta is too large for a BusEvent then the event is preceded
+    // by a time extension event. See BusEvent::time_extension(). Both
+    // events are dropped unless there's room for both.
+    inline bool push(uint32_t current_tick_count, BusEventFlags flags) {
+        const uint32_t delta = current_tick_count - ticks_start;
+        if (delta > UINT16_MAX) {
+            if (capacity() - size() < 2) {
+                dropped_events.store(dropped_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            }
+            push(BusEvent::time_extension(delta, flags));
+        }
+        if (push(BusEvent((uint16_t)delta, flags))) {
+            ticks_start = current_tick_count;
+            return true;
+        }
+        return false;
+    }
+
+    // CONSUMER
+    // Removes the oldest event from the queue and copies it to 'event'.
+    // Returns false and leaves 'event' unchanged if the queue is empty.
+    inline bool pop(BusEvent& event) {
+        const size_t current_tail = tail.load(std::memory_order_relaxed);
+        if (current_tail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        event = events[current_tail & mask];
+        tail.store(current_tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    BusEvent* events;               // Array of events
+    bool created_events;            // True if we own events. False if it was passed to the constructor.
+    const size_t max_size;          // capacity. Always 0 or a power of 2.
+    const size_t mask;              // capacity - 1 or 0 if the capacity is 0
+    std::atomic<size_t> head{0};    // Count of events pushed. Only written by the producer.
+    std::atomic<size_t> tail{0};    // Count of events popped. Only written by the consumer.
+    std::atomic<size_t> dropped_events{0};  // Only written by the producer.
+    uint32_t ticks_start = 0;       // Tick count of the most recent event. Only used by the producer.
+
+    static size_t round_down_to_power_of_2(size_t value);
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_EVENT_QUEUE_H
@@ -11,7 +11,7 @@ void bus_trace::BusRecorder::set_callback(void (*on_change)()) {
     this->isr = on_change;
 }
 
-bool BusRecorder::start(BusTrace& trace) {
+bool BusRecorder::can_start() const {
     if(irq_scl != irq) {
         Serial.println("ERROR: Cannot start BusRecorder. SDA and SCL pins have different interrupt blocks.");
         return false;
@@ -21,32 +21,153 @@ bool BusRecorder::start(BusTrace& trace) {
         Serial.println("ERROR: Cannot start BusRecorder. You must call set_callback() before start()");
         return false;
     }
+    return true;
+}
+
+bool BusRecorder::start(BusTrace& trace) {
+    return start_recording(trace);
+}
+
+bool BusRecorder::start(PackedBusTrace& trace) {
+    return start_recording(trace);
+}
+
+bool BusRecorder::start(DoubleBufferedTrace& traces) {
+    return start_recording(traces);
+}
+
+bool BusRecorder::start(TriggeredTrace& capture) {
+    return start_recording(capture);
+}
+
+bool BusRecorder::start(AddressFilteredTrace& filtered) {
+    return start_recording(filtered);
+}
+
+bool BusRecorder::start(BusEventQueue& queue) {
+    return start_recording(queue);
+}
+
+bool BusRecorder::start(ByteDecoder& decoder) {
+    return start_recording(decoder);
+}
+
+template<typename Sink>
+bool BusRecorder::start_recording(Sink& new_sink) {
+    if (!can_start()) {
+        return false;
+    }
 
     stop(); // Stop the current recording if there is one.
+    glitches = 0;
+    merged_events = 0;
 
-    // Start a new trace
-    current_trace = &trace;
+    // Start a new recording
+    sink = &new_sink;
+    sink_dropped_events = dropped_events<Sink>;
 
     noInterrupts()
     attach_gpio_interrupt();
     previous_pin_states = fastGpio->PSR & masks;
     setLineStates(previous_pin_states);
-    current_trace->reset();
-    trace.add_event(line_states);
+    begin(new_sink, ARM_DWT_CYCCNT, line_states);
+    edge_handler = record_edge<Sink>;
     interrupts()
 
     return true;
 }
 
+void BusRecorder::begin(BusTrace& trace, uint32_t, BusEventFlags line_states) {
+    trace.reset();
+    trace.add_event(line_states);
+}
+
+void BusRecorder::begin(PackedBusTrace& trace, uint32_t now, BusEventFlags line_states) {
+    trace.reset(now);
+    trace.add_event(now, line_states);
+}
+
+void BusRecorder::begin(DoubleBufferedTrace& traces, uint32_t now, BusEventFlags line_states) {
+    traces.reset(now);
+    traces.add_event(now, line_states);
+}
+
+void BusRecorder::begin(TriggeredTrace& capture, uint32_t now, BusEventFlags line_states) {
+    capture.reset(now);
+    capture.add_event(now, line_states);
+}
+
+void BusRecorder::begin(AddressFilteredTrace& filtered, uint32_t now, BusEventFlags line_states) {
+    filtered.reset(now);
+    filtered.add_event(now, line_states);
+}
+
+void BusRecorder::begin(BusEventQueue& queue, uint32_t now, BusEventFlags line_states) {
+    queue.reset(now);
+    queue.push(now, line_states);
+}
+
+void BusRecorder::begin(ByteDecoder& decoder, uint32_t, BusEventFlags) {
+    // The decoder doesn't need the initial line states
+    decoder.reset();
+}
+
 void BusRecorder::stop() {
     noInterrupts()
     detach_gpio_interrupt();
     interrupts()
-    current_trace = nullptr;
+    if (recording()) {
+        dropped_events_at_stop = dropped_event_count();
+    }
+    edge_handler = discard_edge;
+    sink = nullptr;
+    sink_dropped_events = nullptr;
 }
 
 bool BusRecorder::is_recording() const {
-    return current_trace != nullptr;
+    return recording();
+}
+
+RecorderStatistics BusRecorder::statistics() const {
+    RecorderStatistics result;
+    result.glitches = glitches;
+    result.merged_events = merged_events;
+    result.dropped_events = recording() ? dropped_event_count() : dropped_events_at_stop;
+    return result;
+}
+
+size_t BusRecorder::dropped_event_count() const {
+    return sink ? sink_dropped_events(sink) : 0;
+}
+
+size_t BusRecorder::dropped_event_count(const BusTrace& trace) {
+    return trace.dropped_event_count();
+}
+
+size_t BusRecorder::dropped_event_count(const PackedBusTrace& trace) {
+    return trace.dropped_event_count();
+}
+
+size_t BusRecorder::dropped_event_count(const DoubleBufferedTrace& traces) {
+    return traces.dropped_event_count();
+}
+
+size_t BusRecorder::dropped_event_count(const TriggeredTrace&) {
+    // The capture stops adding events once it's complete so nothing is dropped.
+    return 0;
+}
+
+size_t BusRecorder::dropped_event_count(const AddressFilteredTrace& filtered) {
+    return filtered.get_trace().dropped_event_count();
+}
+
+size_t BusRecorder::dropped_event_count(const BusEventQueue& queue) {
+    return queue.dropped_event_count();
+}
+
+size_t BusRecorder::dropped_event_count(const ByteDecoder&) {
+    // The decoder never drops events. See ByteDecoder::dropped_byte_count()
+    return 0;
 }
 
 void BusRecorder::attach_gpio_interrupt() {
@@ -5,7 +5,14 @@
 #define I2C_UNDERNEATH_BUS_RECORDER_H
 
 #include <cstdint>
+#include "address_filtered_trace.h"
+#include "bus_event_queue.h"
 #include "bus_trace.h"
+#include "byte_decoder.h"
+#include "double_buffered_trace.h"
+#include "packed_bus_trace.h"
+#include "recorder_statistics.h"
+#include "triggered_trace.h"
 #include "common/hal/teensy/teensy_pin.h"
 
 namespace bus_trace {
@@ -50,6 +57,12 @@ namespace bus_trace {
 // Recording glitches takes 200 nanoseconds. 70 nanos longer than it
 // take to record a transition.
 //
+// These timings were measured when the recorder only recorded to a
+// BusTrace. The ISR now makes one indirect call per interrupt to reach
+// the code for the current trace, queue or decoder. That code is
+// inlined so the extra cost is a few clock cycles. The timestamp is
+// taken before the call so the timings in the trace are unaffected.
+//
 // Recording a 1 MHz I2C transaction will take roughly 1/2 of
 // the Teensy's clock cycles.
 class BusRecorder {
@@ -69,19 +82,76 @@ public:
 
     // Stops any recording that's in progress and then starts a new recording.
     // Bus events are added to 'trace' as long as there's room. Events are
-    // dropped silently when 'trace' is full.
+    // dropped silently when 'trace' is full. Use BusTrace::set_circular()
+    // to keep the most recent events instead.
     //
     // Returns false if the recorder can't start. This only happens if the
     // BusRecorder has been configured incorrectly. The failure reason is
     // printed to Serial.
     bool start(BusTrace& trace);
 
+    // Stops any recording that's in progress and then starts recording
+    // to 'queue'. This allows you to record continuously. Pop the events
+    // off the queue in your loop() while the recorder is running. Events
+    // are dropped if the queue is full.
+    //
+    // Don't pop events from 'queue' while calling this method.
+    //
+    // Returns false if the recorder can't start. See start(BusTrace&)
+    bool start(BusEventQueue& queue);
+
+    // Stops any recording that's in progress and then starts recording
+    // to 'trace'. A PackedBusTrace holds several times more events than
+    // a BusTrace of the same size. Events are dropped when it's full.
+    //
+    // Returns false if the recorder can't start. See start(BusTrace&)
+    bool start(PackedBusTrace& trace);
+
+    // Stops any recording that's in progress and then starts recording
+    // to 'traces'. The recorder swaps to the other trace when the current
+    // one fills up. Save each full trace and release it while the
+    // recorder is running to record for as long as you like without a gap.
+    // See DoubleBufferedTrace.
+    //
+    // Returns false if the recorder can't start. See start(BusTrace&)
+    bool start(DoubleBufferedTrace& traces);
+
+    // Stops any recording that's in progress and then starts recording
+    // to 'capture'. The recorder keeps the events around the first event
+    // that fires the capture's trigger and ignores everything after that.
+    // Check capture.is_complete() to find out when it's finished.
+    // See TriggeredTrace and BusTrigger.
+    //
+    // Returns false if the recorder can't start. See start(BusTrace&)
+    bool start(TriggeredTrace& capture);
+
+    // Stops any recording that's in progress and then starts recording
+    // the transactions that match the addresses in 'filtered'. Other
+    // transactions are discarded so the trace only grows with the
+    // traffic you're interested in. See AddressFilteredTrace.
+    //
+    // Returns false if the recorder can't start. See start(BusTrace&)
+    bool start(AddressFilteredTrace& filtered);
+
+    // Stops any recording that's in progress and then starts decoding
+    // the bus into 'decoder'. This uses far less RAM than recording
+    // a trace but the timings are lost. See ByteDecoder.
+    //
+    // Returns false if the recorder can't start. See start(BusTrace&)
+    bool start(ByteDecoder& decoder);
+
     // Stops recording
     void stop();
 
     // Returns true if we're recording
     bool is_recording() const;
 
+    // Counts the glitches, merged events and dropped events in the
+    // current recording or in the last one if the recorder has stopped.
+    // Events are never dropped when decoding to a ByteDecoder. Check
+    // ByteDecoder::dropped_byte_count() instead.
+    RecorderStatistics statistics() const;
+
     // Adds an event to the trace. DON'T call this method directly.
     // Use set_callbacks() to fire it automatically when the pins
     // detect a rising or falling edge.
@@ -91,6 +161,69 @@ public:
         // unless it occurred during the previous interrupt.
         uint32_t timestamp = ARM_DWT_CYCCNT;
 
+        // Jump to the version of record_edge() for whatever we're recording to
+        edge_handler(*this, timestamp);
+    }
+
+private:
+    const uint32_t sda_mask;
+    const uint32_t scl_mask;
+    const uint32_t masks;
+    IMXRT_GPIO_t* const gpio;
+    IMXRT_GPIO_t* const fastGpio;
+    const IRQ_NUMBER_t irq;
+    const IRQ_NUMBER_t irq_scl;
+
+    void (* isr)() = nullptr;
+
+    typedef void (* EdgeHandler)(BusRecorder& recorder, uint32_t timestamp);
+    typedef size_t (* DroppedEventsFn)(const void* sink);
+
+    // Whatever we're recording to. e.g. a trace, a queue or a decoder.
+    // 'sink' is nullptr when we're not recording.
+    // 'edge_handler' is record_edge<Sink>() for the type of 'sink' so
+    // the ISR makes one indirect call per interrupt. The code that adds
+    // events to the sink is inlined into it.
+    void* sink = nullptr;
+    EdgeHandler edge_handler = discard_edge;
+    DroppedEventsFn sink_dropped_events = nullptr;
+    BusEventFlags line_states = BOTH_LOW_AND_UNCHANGED;
+    uint32_t previous_pin_states = 0;
+
+    // Statistics for the current recording
+    size_t glitches = 0;
+    size_t merged_events = 0;
+    size_t dropped_events_at_stop = 0;  // Dropped events in the last recording
+
+    // The number of events dropped by whatever we're recording to
+    size_t dropped_event_count() const;
+
+    inline bool recording() const {
+        return sink;
+    }
+
+    // Stops any recording that's in progress and then starts recording to 'new_sink'.
+    // All the public start() methods delegate to this one.
+    template<typename Sink>
+    bool start_recording(Sink& new_sink);
+
+    // Used when we're not recording
+    static void discard_edge(BusRecorder& recorder, uint32_t) {
+        recorder.gpio->ISR = recorder.masks;
+    }
+
+    template<typename Sink>
+    static void record_edge(BusRecorder& recorder, uint32_t timestamp) {
+        recorder.handle_edge(*static_cast<Sink*>(recorder.sink), timestamp);
+    }
+
+    template<typename Sink>
+    static size_t dropped_events(const void* sink) {
+        return dropped_event_count(*static_cast<const Sink*>(sink));
+    }
+
+    template<typename Sink>
+    inline void handle_edge(Sink& current_sink, uint32_t timestamp) {
         // It's much faster to use the fast GPIO port to read the pins.
         const uint32_t pin_states = fastGpio->PSR & masks;
 
@@ -101,15 +234,15 @@ public:
             // Clear the interrupt
             gpio->ISR = masks;
 
-            // We don't want to record this event.
-            if (!current_trace) return;
-
             // If both pins have changed then report them in a single event.
             // We don't know which one happened first anyway.
             BusEventFlags previous_line_states = line_states;
             setLineStates(pin_states);
             auto changed_flags = (BusEventFlags)((line_states ^ previous_line_states) << 2);
-            current_trace->add_event(timestamp, changed_flags | line_states);
+            if (changed_flags == (SDA_LINE_CHANGED | SCL_LINE_CHANGED)) {
+                merged_events++;
+            }
+            record(current_sink, timestamp, changed_flags | line_states);
         } else {
             // A line has glitched. i.e. changed state and then change back
             // Can be caused by noise or by the master handing control to the slave
@@ -119,33 +252,65 @@ public:
             // Clear the interrupt
             gpio->ISR = masks;
 
-            // We don't want to record this event.
-            if (!current_trace) return;
-
+            glitches++;
             const BusEventFlags glitch_lines = pin_states_to_line_states(interrupt_pins);
             const BusEventFlags glitch_line_states = glitch_lines ^ line_states;
             auto changed_flags = (BusEventFlags)(glitch_lines << 2);
-            current_trace->add_event(timestamp, changed_flags | glitch_line_states);
-            current_trace->add_event(timestamp, changed_flags | line_states);
+            record(current_sink, timestamp, changed_flags | glitch_line_states);
+            record(current_sink, timestamp, changed_flags | line_states);
         }
         previous_pin_states = pin_states;
         // WARNING: If the ISR exits too soon after clearing gpio->ISR then it'll fire again immediately
     }
 
-private:
-    const uint32_t sda_mask;
-    const uint32_t scl_mask;
-    const uint32_t masks;
-    IMXRT_GPIO_t* const gpio;
-    IMXRT_GPIO_t* const fastGpio;
-    const IRQ_NUMBER_t irq;
-    const IRQ_NUMBER_t irq_scl;
+    // Adds an event to each type of sink
+    static inline void record(BusTrace& trace, uint32_t timestamp, BusEventFlags flags) {
+        trace.add_event(timestamp, flags);
+    }
 
-    void (* isr)() = nullptr;
+    static inline void record(PackedBusTrace& trace, uint32_t timestamp, BusEventFlags flags) {
+        trace.add_event(timestamp, flags);
+    }
 
-    BusTrace* current_trace = nullptr;
-    BusEventFlags line_states = BOTH_LOW_AND_UNCHANGED;
-    uint32_t previous_pin_states = 0;
+    static inline void record(DoubleBufferedTrace& traces, uint32_t timestamp, BusEventFlags flags) {
+        traces.add_event(timestamp, flags);
+    }
+
+    static inline void record(TriggeredTrace& capture, uint32_t timestamp, BusEventFlags flags) {
+        capture.add_event(timestamp, flags);
+    }
+
+    static inline void record(AddressFilteredTrace& filtered, uint32_t timestamp, BusEventFlags flags) {
+        filtered.add_event(timestamp, flags);
+    }
+
+    static inline void record(BusEventQueue& queue, uint32_t timestamp, BusEventFlags flags) {
+        queue.push(timestamp, flags);
+    }
+
+    static inline void record(ByteDecoder& decoder, uint32_t, BusEventFlags flags) {
+        decoder.add_event(flags);
+    }
+
+    // Resets each type of sink and adds the initial line states
+    static void begin(BusTrace& trace, uint32_t now, BusEventFlags line_states);
+    static void begin(PackedBusTrace& trace, uint32_t now, BusEventFlags line_states);
+    static void begin(DoubleBufferedTrace& traces, uint32_t now, BusEventFlags line_states);
+    static void begin(TriggeredTrace& capture, uint32_t now, BusEventFlags line_states);
+    static void begin(AddressFilteredTrace& filtered, uint32_t now, BusEventFlags line_states);
+    static void begin(BusEventQueue& queue, uint32_t now, BusEventFlags line_states);
+    static void begin(ByteDecoder& decoder, uint32_t now, BusEventFlags line_states);
+
+    // The number of events each type of sink has dropped
+    static size_t dropped_event_count(const BusTrace& trace);
+    static size_t dropped_event_count(const PackedBusTrace& trace);
+    static size_t dropped_event_count(const DoubleBufferedTrace& traces);
+    static size_t dropped_event_count(const TriggeredTrace& capture);
+    static size_t dropped_event_count(const AddressFilteredTrace& filtered);
+    static size_t dropped_event_count(const BusEventQueue& queue);
+    static size_t dropped_event_count(const ByteDecoder& decoder);
+
+    bool can_start() const;
 
     void attach_gpio_interrupt();
 
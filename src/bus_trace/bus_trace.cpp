@@ -2,7 +2,10 @@
 // Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
 
 #include <Arduino.h>
+#include <algorithm>
+#include <utility>
 #include "bus_trace.h"
+#include "message_iterator.h"
 
 namespace bus_trace {
 
@@ -22,6 +25,15 @@ BusTrace::BusTrace(BusEvent* events, size_t max_event_count)
     : clock(nullptr), events(events), created_events(false), max_event_count(max_event_count) {
 }
 
+BusTrace::BusTrace(const common::hal::Clock* clock, BusEvent* events, size_t max_event_count)
+    : clock(clock), events(events), created_events(false), max_event_count(max_event_count) {
+}
+
+BusTrace::BusTrace(const BusEvent* events, size_t event_count, const common::hal::Clock* clock)
+    : clock(clock), events(const_cast<BusEvent*>(events)), created_events(false), read_only(true),
+      max_event_count(event_count), current_event_count(event_count) {
+}
+
 BusTrace::BusTrace(size_t max_event_count)
     : clock(nullptr), events(new BusEvent[max_event_count]), created_events(true), max_event_count(max_event_count) {
 }
@@ -31,148 +43,204 @@ BusTrace::BusTrace(const common::hal::Clock* clock, size_t max_event_count)
 }
 
 BusTrace::~BusTrace() {
+    release();
+}
+
+BusTrace::BusTrace(BusTrace&& other) noexcept
+    : clock(other.clock), events(nullptr), created_events(false), max_event_count(0) {
+    *this = std::move(other);
+}
+
+BusTrace& BusTrace::operator=(BusTrace&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    release();
+    clock = other.clock;
+    ticks_start = other.ticks_start;
+    events = other.events;
+    created_events = other.created_events;
+    read_only = other.read_only;
+    max_event_count = other.max_event_count;
+    current_event_count = other.current_event_count;
+    circular = other.circular;
+    first_event = other.first_event;
+    overwritten_events = other.overwritten_events;
+    dropped_events = other.dropped_events;
+    delta_overflows = other.delta_overflows;
+    cumulative_ticks = other.cumulative_ticks;
+    indexed_event_count = other.indexed_event_count;
+    indexed_overwritten_events = other.indexed_overwritten_events;
+
+    // Leave 'other' empty so it doesn't free the arrays
+    other.events = nullptr;
+    other.created_events = false;
+    other.read_only = false;
+    other.max_event_count = 0;
+    other.current_event_count = 0;
+    other.first_event = 0;
+    other.overwritten_events = 0;
+    other.dropped_events = 0;
+    other.delta_overflows = 0;
+    other.cumulative_ticks = nullptr;
+    other.indexed_event_count = 0;
+    other.indexed_overwritten_events = 0;
+    return *this;
+}
+
+void BusTrace::release() {
     if (created_events && events) {
         delete[] events;
-        events = nullptr;
+    }
+    events = nullptr;
+    created_events = false;
+    delete[] cumulative_ticks;
+    cumulative_ticks = nullptr;
+}
+
+bool BusTrace::reserve(size_t new_max_event_count) {
+    if (!created_events) {
+        return false;
+    }
+    if (new_max_event_count > max_event_count) {
+        reallocate(new_max_event_count);
+    }
+    return true;
+}
+
+bool BusTrace::shrink_to_fit() {
+    if (!created_events) {
+        return false;
+    }
+    if (current_event_count < max_event_count) {
+        reallocate(current_event_count);
+    }
+    return true;
+}
+
+void BusTrace::reallocate(size_t new_max_event_count) {
+    auto new_events = new BusEvent[new_max_event_count];
+    for (size_t i = 0; i < current_event_count; ++i) {
+        new_events[i] = events[physical_index(i)];
+    }
+    delete[] events;
+    events = new_events;
+    max_event_count = new_max_event_count;
+    first_event = 0;
+    if (cumulative_ticks) {
+        // The index is rebuilt when it's next used
+        delete[] cumulative_ticks;
+        cumulative_ticks = new uint64_t[max_event_count];
+        indexed_event_count = 0;
     }
 }
 
 const BusEvent* BusTrace::event(size_t index) const {
     if (index + 1 <= current_event_count) {
-        return &events[index];
+        return &events[physical_index(index)];
     }
     return nullptr;
 }
 
 void BusTrace::reset() {
+    if (read_only) {
+        return;
+    }
     current_event_count = 0;
+    first_event = 0;
+    overwritten_events = 0;
+    dropped_events = 0;
+    delta_overflows = 0;
+    indexed_event_count = 0;
+    indexed_overwritten_events = 0;
     set_ticks_start();
 }
 
-class BusTraceIterator {
-public:
-    BusTraceIterator(const BusTrace& trace, bool split_events)
-        : trace(trace), split_events(split_events) {
-    }
+BusTrace BusTrace::to_message(bool merge_sda_edges, bool split_events) const {
+    BusTrace message(clock, MessageIterator::event_count(*this, merge_sda_edges, split_events));
+    to_message(message, merge_sda_edges, split_events);
+    return message;
+}
 
-    size_t event_count() const {
-        if (split_events) {
-            size_t count = 0;
-            for (size_t i = 0; i < trace.event_count(); ++i) {
-                if (is_merged_event(trace.event(i))) {
-                    count += 2;
-                } else {
-                    count++;
-                }
-            }
-            return count;
-        }
-        return trace.event_count();
+size_t BusTrace::to_message(BusTrace& message, bool merge_sda_edges, bool split_events) const {
+    message.reset();
+    size_t count = 0;
+    MessageIterator iter(*this, merge_sda_edges, split_events);
+    while (iter.has_next()) {
+        message.add_event(iter.next());
+        count++;
     }
+    return count;
+}
 
-    bool has_next() const {
-        return get_second_of_pair_next || next_index < trace.event_count();
+bool BusTrace::normalise(bool merge_sda_edges, bool split_events) {
+    if (read_only) {
+        return false;
     }
-
-    BusEvent next() {
-        if (!split_events) {
-            return *trace.event(next_index++);
-        }
-        if (get_second_of_pair_next) {
-            get_second_of_pair_next = false;
-            return second_event_of_pair;
-        }
-        auto event = trace.event(next_index++);
-        if (is_merged_event(event)) {
-            split_event(event, event->flags & SCL_LINE_STATE);
-            get_second_of_pair_next = true;
-            return first_event_of_pair;
-        }
-        return *event;
-    }
-
-private:
-    const BusEventFlags SDA_MASK = SDA_LINE_CHANGED | SDA_LINE_STATE;
-    const BusEventFlags SCL_MASK = SCL_LINE_CHANGED | SCL_LINE_STATE;
-    const BusTrace& trace;
-    bool split_events;
-    bool get_second_of_pair_next = false;
-    BusEvent first_event_of_pair = BusEvent(0, BOTH_LOW_AND_UNCHANGED);
-    BusEvent second_event_of_pair = BusEvent(0, BOTH_LOW_AND_UNCHANGED);
-    size_t next_index = 0;
-
-    static bool is_merged_event(const BusEvent* event) {
+    size_t merged_events = 0;
+    if (split_events) {
         const BusEventFlags both_changed = SDA_LINE_CHANGED | SCL_LINE_CHANGED;
-        return (event->flags & both_changed) == both_changed;
-    }
-
-    void split_event(const BusEvent* event, bool sda_first) {
-        if (sda_first) {
-            BusEventFlags initial_sda_state = event->flags & SDA_MASK;
-            BusEventFlags initial_scl_state = (~event->flags) & SCL_MASK;
-            first_event_of_pair = BusEvent(event->delta_t_in_ticks, initial_sda_state | initial_scl_state);
-            BusEventFlags final_sda_state = event->flags & SDA_LINE_STATE;
-            BusEventFlags final_scl_state = event->flags & SCL_MASK;
-            second_event_of_pair = BusEvent(0, final_sda_state | final_scl_state);
-        } else {
-            BusEventFlags initial_sda_state = (~event->flags) & SDA_MASK;
-            BusEventFlags initial_scl_state = event->flags & SCL_MASK;
-            first_event_of_pair = BusEvent(event->delta_t_in_ticks, initial_sda_state | initial_scl_state);
-            BusEventFlags final_sda_state = event->flags & SDA_MASK;
-            BusEventFlags final_scl_state = event->flags & SCL_LINE_STATE;
-            second_event_of_pair = BusEvent(0, final_sda_state | final_scl_state);
-        }
-    }
-};
-
-BusTrace BusTrace::to_message(bool merge_sda_edges, bool split_events) const {
-    auto sda_changed_while_scl_low = [](BusEventFlags flags) {
-        bool scl_low = (flags & BusEventFlags::SCL_LINE_STATE) != BusEventFlags::SCL_LINE_STATE;
-        bool sda_changed = (flags & BusEventFlags::SDA_LINE_CHANGED) == BusEventFlags::SDA_LINE_CHANGED;
-        return scl_low && sda_changed;
-    };
-    auto only_sda_changed = [](BusEventFlags previous, BusEventFlags next) {
-        BusEventFlags sda_flags = (BusEventFlags::SDA_LINE_STATE | BusEventFlags::SDA_LINE_CHANGED);
-        return (previous | sda_flags) == (next | sda_flags);
-    };
-    BusTraceIterator iter(*this, split_events);
-    BusTrace message(clock, iter.event_count());
-    if (current_event_count > 0) {
-        BusEvent previous = iter.next();
-        bool has_previous = true;
-        while (iter.has_next()) {
-            const BusEvent next = iter.next();
-            bool previous_may_be_spurious = sda_changed_while_scl_low(previous.flags);
-            bool next_may_be_spurious = sda_changed_while_scl_low(next.flags);
-            if (merge_sda_edges && previous_may_be_spurious && next_may_be_spurious && only_sda_changed(previous.flags, next.flags)) {
-                // The two events cancel out. Throw them away.
-                if (iter.has_next()) {
-                    previous = iter.next();
-                } else {
-                    has_previous = false;
-                }
-            } else {
-                message.add_event(previous);
-                previous = next;
+        for (size_t i = 0; i < current_event_count; ++i) {
+            if ((event(i)->flags & both_changed) == both_changed) {
+                merged_events++;
             }
         }
-        if (has_previous) {
-            message.add_event(previous);
-        }
     }
-    return message;
+    if (current_event_count + merged_events > max_event_count) {
+        return false;
+    }
+    // Move the events to the end of the array. The message is written from
+    // the start. Each split adds one event, so the spare slots stop the
+    // message from overwriting events that haven't been read yet.
+    std::rotate(events, events + first_event, events + max_event_count);
+    std::move_backward(events, events + current_event_count, events + max_event_count);
+    const BusTrace unread(events + max_event_count - current_event_count, current_event_count, clock);
+    size_t count = 0;
+    MessageIterator iter(unread, merge_sda_edges, split_events);
+    while (iter.has_next()) {
+        events[count++] = iter.next();
+    }
+    current_event_count = count;
+    first_event = 0;
+    indexed_event_count = 0;
+    return true;
 }
 
 size_t BusTrace::compare_messages(const BusTrace& other) const {
-    return to_message().compare_edges(other.to_message());
+    // Normalise both traces as we go so we can stop at the first
+    // difference without converting the rest of the traces.
+    MessageIterator mine(*this);
+    MessageIterator theirs(other);
+    size_t index = 0;
+    while (mine.has_next() && theirs.has_next()) {
+        if (mine.next().flags != theirs.next().flags) {
+            return index;
+        }
+        index++;
+    }
+    if (mine.has_next() || theirs.has_next()) {
+        return index;
+    }
+    return SIZE_MAX;
 }
 
-size_t BusTrace::compare_bus_events(const BusTrace& other, const std::function<bool(size_t)>& are_equal) const {
+template<typename Equal>
+size_t BusTrace::compare_bus_events(const BusTrace& other, Equal are_equal) const {
     size_t min_count = min(current_event_count, other.event_count());
+    // Walk the arrays directly rather than calling event() which
+    // checks the index every time.
+    size_t mine = first_event;
+    size_t theirs = other.first_event;
     for (size_t i = 0; i < min_count; ++i) {
-        if (!are_equal(i)) {
+        if (!are_equal(events[mine], other.events[theirs])) {
             return i;
         }
+        if (++mine == max_event_count) {
+            mine = 0;
+        }
+        if (++theirs == other.max_event_count) {
+            theirs = 0;
+        }
     }
     if (current_event_count != other.event_count()) {
         return min_count;
@@ -181,33 +249,44 @@ size_t BusTrace::compare_bus_events(const BusTrace& other, const std::function<b
 }
 
 size_t BusTrace::compare_edges(const BusTrace& other) const {
-    return compare_bus_events(other, [this, &other](size_t index) {
-        return this->event(index)->flags == other.event(index)->flags;
+    return compare_bus_events(other, [](const BusEvent& mine, const BusEvent& theirs) {
+        return mine.flags == theirs.flags;
     });
 }
 
 size_t BusTrace::is_identical_to(const BusTrace& other) const {
-    return compare_bus_events(other, [this, &other](size_t index) {
-        return *event(index) == *other.event(index);
+    return compare_bus_events(other, [](const BusEvent& mine, const BusEvent& theirs) {
+        return mine == theirs;
     });
 }
 
 size_t BusTrace::printTo(Print& p) const {
-    String sda("SDA ");
-    String scl("SCL ");
+    size_t count = print_line(p, true);
+    count += print_line(p, false);
+    return count;
+}
+
+size_t BusTrace::print_line(Print& p, bool sda) const {
+    // Print the symbols in small batches rather than building a
+    // String that's as long as the trace.
+    char buffer[64];
+    size_t used = 0;
+    size_t count = p.print(sda ? "SDA " : "SCL ");
     for (size_t i = 0; i < event_count(); ++i) {
-        const BusEvent* e = event(i);
-        append_event_symbol(sda, true, e->flags);
-        append_event_symbol(scl, false, e->flags);
-    }
-    sda.append("\r\n");
-    scl.append("\r\n");
-    size_t count = p.print(sda);
-    count += p.print(scl);
+        buffer[used++] = event_symbol(sda, event(i)->flags);
+        if (used == sizeof(buffer)) {
+            count += p.write((const uint8_t*)buffer, used);
+            used = 0;
+        }
+    }
+    if (used) {
+        count += p.write((const uint8_t*)buffer, used);
+    }
+    count += p.print("\r\n");
     return count;
 }
 
-void BusTrace::append_event_symbol(String& string, bool sda, BusEventFlags flags) {
+char BusTrace::event_symbol(bool sda, BusEventFlags flags) {
     bool level;
     if (sda) {
         level = (flags & BusEventFlags::SDA_LINE_STATE) != BusEventFlags::BOTH_LOW_AND_UNCHANGED;
@@ -223,10 +302,9 @@ void BusTrace::append_event_symbol(String& string, bool sda, BusEventFlags flags
     // It would be nice to use the UTF-8 characters "↑↓_‾" but they're not supported by serial monitor.
     // Stick to ASCII instead.
     if (level) {
-        edge ? string.append('/') : string.append("'");
-    } else {
-        edge ? string.append('\\') : string.append('_');
+        return edge ? '/' : '\'';
     }
+    return edge ? '\\' : '_';
 }
 
 uint32_t BusTrace::nanos_to_previous(size_t index) const {
@@ -235,7 +313,13 @@ uint32_t BusTrace::nanos_to_previous(size_t index) const {
         return UINT32_MAX;
     }
     if (index) {
-        return clock->ticks_to_nanos(events[index].delta_t_in_ticks);
+        uint32_t ticks = events[physical_index(index)].ticks();
+        const BusEvent& previous = events[physical_index(index - 1)];
+        if (previous.is_time_extension()) {
+            // The gap was too long for one event
+            ticks += previous.ticks();
+        }
+        return clock->ticks_to_nanos(ticks);
     }
     // It doesn't make sense to return a value for the first event so return 0.
     // This is mainly to allow us to change BusEvent to hold absolute
@@ -249,13 +333,47 @@ uint32_t BusTrace::nanos_between(size_t to, size_t from) const {
         || !clock) {
         return UINT32_MAX;
     }
+    if (cumulative_ticks) {
+        update_tick_index();
+        return clock->ticks_to_nanos((uint32_t)(cumulative_ticks[to] - cumulative_ticks[from]));
+    }
     uint32_t total_ticks = 0;
     for (size_t i = from + 1; i <= to; ++i) {
-        total_ticks += events[i].delta_t_in_ticks;
+        total_ticks += events[physical_index(i)].ticks();
     }
     return clock->ticks_to_nanos(total_ticks);
 }
 
+void BusTrace::enable_tick_index() {
+    if (!cumulative_ticks) {
+        cumulative_ticks = new uint64_t[max_event_count];
+        indexed_event_count = 0;
+    }
+}
+
+void BusTrace::disable_tick_index() {
+    delete[] cumulative_ticks;
+    cumulative_ticks = nullptr;
+    indexed_event_count = 0;
+}
+
+void BusTrace::update_tick_index() const {
+    if (indexed_overwritten_events != overwritten_events) {
+        // The oldest events have been overwritten, so every
+        // index entry is out of date. Start again.
+        indexed_event_count = 0;
+        indexed_overwritten_events = overwritten_events;
+    }
+    if (indexed_event_count == 0 && current_event_count > 0) {
+        cumulative_ticks[0] = 0;
+        indexed_event_count = 1;
+    }
+    for (size_t i = indexed_event_count; i < current_event_count; ++i) {
+        cumulative_ticks[i] = cumulative_ticks[i - 1] + events[physical_index(i)].ticks();
+    }
+    indexed_event_count = current_event_count;
+}
+
 bool BusTrace::out_of_range(size_t index) const {
     return index >= event_count();
 }
@@ -10,7 +10,6 @@
 #include <bus_trace/bus_event.h>
 #include <bus_trace/bus_event_flags.h>
 #include <common/hal/clock.h>
-#include <functional>
 
 namespace bus_trace {
 
@@ -40,6 +39,14 @@ public:
 
     virtual ~BusTrace();
 
+    // Traces can be moved but not copied. Copying a large trace by
+    // accident would use a lot of RAM. The moved-from trace is left
+    // empty with no space for events.
+    BusTrace(BusTrace&& other) noexcept;
+    BusTrace& operator=(BusTrace&& other) noexcept;
+    BusTrace(const BusTrace&) = delete;
+    BusTrace& operator=(const BusTrace&) = delete;
+
     // Allows you to define the array of events wherever you want. This may
     // be important for large traces.
     // events: an array of BusEvents that will be populated by the trace
@@ -47,48 +54,175 @@ public:
     // Additional events are dropped. Must be less than SIZE_MAX.
     BusTrace(BusEvent* events, size_t max_event_count);
 
+    // As above but with a clock. See BusTrace(const Clock*, size_t)
+    BusTrace(const common::hal::Clock* clock, BusEvent* events, size_t max_event_count);
+
+    // Creates a read-only trace that shows 'event_count' existing events
+    // without copying them. The events must outlive the trace. This lets
+    // you analyse events that are held somewhere else. e.g. by a
+    // MappedBusTrace.
+    // add_event() discards new events and reset() does nothing.
+    BusTrace(const BusEvent* events, size_t event_count, const common::hal::Clock* clock);
+
+    // True if this trace is a view of existing events.
+    inline bool is_read_only() const {
+        return read_only;
+    }
+
     // The number of events we've recorded.
     inline size_t event_count() const {
         return current_event_count;
     }
 
+    // The maximum number of events the trace can hold.
+    inline size_t capacity() const {
+        return max_event_count;
+    }
+
+    // Increases the capacity of the trace to at least 'max_event_count'.
+    // The events are copied to a new array so don't call this while
+    // recording.
+    // Returns false if the trace doesn't own its array of events.
+    // i.e. it was passed to the constructor or the trace is read-only.
+    bool reserve(size_t new_max_event_count);
+
+    // Reduces the capacity of the trace to the number of events it holds.
+    // Use it to save RAM once you've finished recording.
+    // Returns false if the trace doesn't own its array of events.
+    bool shrink_to_fit();
+
+    // The clock used to convert ticks to nanoseconds. May be nullptr.
+    inline const common::hal::Clock* get_clock() const {
+        return clock;
+    }
+
     // Returns a recorded event or nullptr if index is out of range.
+    // Index 0 is always the oldest event in the trace even if the
+    // trace is circular.
     const BusEvent* event(size_t index) const;
 
+    // A circular trace overwrites the oldest event when it's full
+    // instead of discarding the new event. This lets you keep the
+    // events leading up to a fault that occurs long after recording
+    // started.
+    // Traces are not circular by default.
+    inline void set_circular(bool is_circular) {
+        circular = is_circular && !read_only;
+    }
+
+    inline bool is_circular() const {
+        return circular;
+    }
+
+    // The number of events that have been overwritten since the trace
+    // was last reset. Always 0 unless the trace is circular.
+    inline size_t overwritten_event_count() const {
+        return overwritten_events;
+    }
+
+    // The number of events that were discarded because the trace was
+    // full since it was last reset. Always 0 if the trace is circular.
+    // If this isn't 0 then the trace is incomplete.
+    inline size_t dropped_event_count() const {
+        return dropped_events;
+    }
+
+    // The number of events whose delta was too large for a BusEvent
+    // since the trace was last reset. Each of these events was
+    // preceded by a time extension. See BusEvent::time_extension()
+    inline size_t delta_overflow_count() const {
+        return delta_overflows;
+    }
+
     // Returns the time since the previous event in nanoseconds.
     // Returns UINT32_MAX if index is out of range or this trace
     // doesn't have a clock.
     // Returns 0 for the first event.
+    // If the previous event is a time extension, then the result is
+    // the time since the event before that. See BusEvent::time_extension()
     uint32_t nanos_to_previous(size_t index) const;
 
     // Returns the time between the 2 events in nanoseconds.
     // Returns UINT32_MAX if either index is out of range or
     // from > to, or this trace doesn't have a clock.
+    //
+    // Takes time proportional to (to - from) unless the tick index
+    // is enabled. See enable_tick_index()
     uint32_t nanos_between(size_t to, size_t from) const;
 
-    // Removes any existing events and resets the clock
+    // Makes nanos_between() take constant time no matter how far
+    // apart the events are. This is worthwhile if you're analysing
+    // a long trace.
+    //
+    // The index holds the total number of ticks since the first event
+    // for each event in the trace. It takes 8 bytes per event so it's
+    // disabled by default. It's built lazily when nanos_between()
+    // needs it so it doesn't slow down add_event().
+    void enable_tick_index();
+
+    // Frees the tick index if there is one.
+    void disable_tick_index();
+
+    inline bool has_tick_index() const {
+        return cumulative_ticks != nullptr;
+    }
+
+    // Removes any existing events and resets the clock.
+    // Does nothing if the trace is read-only.
     void reset();
 
     // Adds an event to the trace as long as there is space for it.
-    // Discards the event if there's no more space
+    // Discards the event if there's no more space unless the
+    // trace is circular.
     inline void add_event(const BusEvent& event) {
         if (current_event_count == max_event_count) {
-            // We can't take another event. Discard it.
+            if (circular && max_event_count) {
+                // Overwrite the oldest event
+                events[first_event] = event;
+                if (++first_event == max_event_count) {
+                    first_event = 0;
+                }
+                overwritten_events++;
+            } else {
+                // We can't take another event. Discard it.
+                dropped_events++;
+            }
             return;
         }
         events[current_event_count] = event;
         current_event_count++;
     }
 
+    // Adds an event that happened at 'current_tick_count'. If the time
+    // since the previous event is too large for a BusEvent, then a time
+    // extension event is added first. See BusEvent::time_extension()
     inline void add_event(uint32_t current_tick_count, BusEventFlags flags) {
-        add_event(BusEvent(current_tick_count - ticks_start, flags));
+        add_event_with_delta(current_tick_count - ticks_start, flags);
         ticks_start = current_tick_count;
     }
 
+    // Adds an event that happened 'delta' ticks after the previous one.
+    // Adds a time extension event first if 'delta' is too large for
+    // a BusEvent. This is useful if you're importing events from
+    // another source. Both events are dropped unless there's room for
+    // both.
+    inline void add_event_with_delta(uint32_t delta, BusEventFlags flags) {
+        if (delta > UINT16_MAX) {
+            if (!circular && max_event_count - current_event_count < 2) {
+                // Don't leave a time extension without its event
+                dropped_events++;
+                return;
+            }
+            delta_overflows++;
+            add_event(BusEvent::time_extension(delta, flags));
+        }
+        add_event(BusEvent((uint16_t)delta, flags));
+    }
+
     inline void add_event(BusEventFlags flags) {
         uint32_t past = ticks_start;
         set_ticks_start();
-        add_event(BusEvent(ticks_start - past, flags));
+        add_event_with_delta(ticks_start - past, flags);
     }
 
     // Normalises a trace by hiding irrelevant edges and splitting merged edges.
@@ -110,8 +244,29 @@ public:
     // WARNING if the events actually happened in the wrong order then this
     // will disguise an I2C logic error. Set 'split_events' to false to disable
     // splitting.
+    //
+    // Time extension events are removed as they're not part of the message.
+    // The timings of the events that follow them will be wrong.
+    //
+    // The result is a new trace. Use MessageIterator to step through the
+    // message without allocating any memory.
     BusTrace to_message(bool merge_sda_edges = true, bool split_events = true) const;
 
+    // As above but writes the message to 'message' instead of allocating
+    // a new trace. 'message' is reset first. Events are dropped if it's
+    // too small.
+    // Returns the number of events in the message. This is larger than
+    // message.event_count() if any events were dropped.
+    size_t to_message(BusTrace& message, bool merge_sda_edges = true, bool split_events = true) const;
+
+    // Replaces the events in this trace with its message. See to_message().
+    // Doesn't allocate any memory. Splitting merged events makes the message
+    // longer than the trace so the trace needs one spare slot for every
+    // merged event.
+    // Returns false and leaves the trace unchanged if there isn't enough
+    // space or the trace is read-only.
+    bool normalise(bool merge_sda_edges = true, bool split_events = true);
+
     // Returns the index of the first BusEvent that doesn't match
     // or SIZE_MAX if the traces are equivalent.
     //
@@ -129,6 +284,8 @@ public:
     // to be equivalent if merging 2 events in one trace creates a match to
     // the other trace. The order of the 2 merged edges is ignored.
     //
+    // The traces are normalised as they're compared, so the comparison
+    // stops at the first difference and doesn't allocate any memory.
     size_t compare_messages(const BusTrace& other) const;
 
     // Traces are equivalent if their line states and edges match exactly.
@@ -142,7 +299,8 @@ public:
     // respect.
     size_t is_identical_to(const BusTrace& other) const;
 
-    // Prints the trace
+    // Prints the trace as a row of symbols for each line.
+    // See VcdWriter if you want to view a large trace as a waveform.
     size_t printTo(Print& p) const override;
 
 private:
@@ -150,10 +308,40 @@ private:
     uint32_t ticks_start = 0;
     BusEvent* events;               // Array of events
     bool created_events;            // True if we own events. False if it was passed to the constructor.
+    bool read_only = false;         // True if 'events' must not be modified.
     size_t max_event_count;         // Maximum number of items in 'events'
     size_t current_event_count = 0; // Current event count
+    bool circular = false;          // True if new events overwrite the oldest ones when the trace is full
+    size_t first_event = 0;         // Index in 'events' of the oldest event. Only changes if the trace is circular.
+    size_t overwritten_events = 0;  // Number of events lost because the trace is circular
+    size_t dropped_events = 0;      // Number of events discarded because the trace was full
+    size_t delta_overflows = 0;     // Number of events that needed a time extension
+
+    // Optional index for nanos_between(). See enable_tick_index()
+    // cumulative_ticks[i] is the sum of the deltas of events 1 to i.
+    uint64_t* cumulative_ticks = nullptr;
+    mutable size_t indexed_event_count = 0;         // Number of events covered by 'cumulative_ticks'
+    mutable size_t indexed_overwritten_events = 0;  // Value of 'overwritten_events' when the index was built
+
+    // Brings the tick index up to date with the events in the trace
+    void update_tick_index() const;
+
+    // Moves the events to a new array of the given size. The oldest
+    // event ends up at index 0.
+    void reallocate(size_t new_max_event_count);
+
+    // Frees any memory owned by the trace.
+    void release();
+
+    // Converts an index into the trace to an index into 'events'
+    inline size_t physical_index(size_t index) const {
+        size_t i = first_event + index;
+        return i < max_event_count ? i : i - max_event_count;
+    }
+
+    size_t print_line(Print& p, bool sda) const;
 
-    static void append_event_symbol(String& string, bool sda, BusEventFlags flags);
+    static char event_symbol(bool sda, BusEventFlags flags);
 
     bool out_of_range(size_t index) const;
 
@@ -168,7 +356,10 @@ private:
 #endif
     }
 
-    size_t compare_bus_events(const BusTrace& other, const std::function<bool(size_t index)>&) const;
+    // Calls are_equal(const BusEvent&, const BusEvent&) for each pair of
+    // events until it returns false. Defined in bus_trace.cpp.
+    template<typename Equal>
+    size_t compare_bus_events(const BusTrace& other, Equal are_equal) const;
 };
 
 }
@@ -0,0 +1,166 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "bus_trace_decoder.h"
+
+namespace bus_trace {
+
+BusTraceDecoder::BusTraceDecoder(size_t max_field_count)
+    : fields(new DecodedField[max_field_count]), max_field_count(max_field_count), created_fields(true) {
+}
+
+BusTraceDecoder::BusTraceDecoder(DecodedField* fields, size_t max_field_count)
+    : fields(fields), max_field_count(max_field_count), created_fields(false) {
+}
+
+BusTraceDecoder::~BusTraceDecoder() {
+    if (created_fields && fields) {
+        delete[] fields;
+        fields = nullptr;
+    }
+}
+
+void BusTraceDecoder::decode(const BusTrace& trace) {
+    reset();
+    for (size_t i = 0; i < trace.event_count(); ++i) {
+        add_event(*trace.event(i));
+    }
+}
+
+void BusTraceDecoder::add_event(const BusEvent& event) {
+    size_t index = event_index++;
+    if ((bool)(event.flags & BusEventFlags::SCL_LINE_CHANGED)) {
+        // If SDA changed as well then we assume it changed while SCL
+        // was LOW. i.e. before SCL rose or after it fell.
+        // Either way, it's part of a data bit and can be ignored.
+        if (event.scl_rose()) {
+            on_bit((bool)(event.flags & BusEventFlags::SDA_LINE_STATE), index);
+        }
+    } else if ((bool)(event.flags & BusEventFlags::SCL_LINE_STATE)) {
+        // SDA can only change while SCL is HIGH for START and STOP bits
+        if (event.sda_fell()) {
+            on_start(index);
+        } else if (event.sda_rose()) {
+            on_stop(index);
+        }
+    }
+}
+
+const DecodedField* BusTraceDecoder::field(size_t index) const {
+    if (index < current_field_count) {
+        return &fields[index];
+    }
+    return nullptr;
+}
+
+void BusTraceDecoder::reset() {
+    current_field_count = 0;
+    dropped_fields = 0;
+    state = State::Idle;
+    event_index = 0;
+    bit_count = 0;
+    current_byte = 0;
+    first_bit_index = 0;
+}
+
+void BusTraceDecoder::add_field(const DecodedField& field) {
+    if (current_field_count < max_field_count) {
+        fields[current_field_count++] = field;
+    } else {
+        dropped_fields++;
+    }
+}
+
+void BusTraceDecoder::on_start(size_t index) {
+    if (state == State::Idle) {
+        add_field(DecodedField(DecodedField::Type::Start, index));
+    } else {
+        add_field(DecodedField(DecodedField::Type::RepeatedStart, index));
+    }
+    state = State::Address;
+    bit_count = 0;
+    current_byte = 0;
+}
+
+void BusTraceDecoder::on_stop(size_t index) {
+    if (state != State::Idle) {
+        add_field(DecodedField(DecodedField::Type::Stop, index));
+    }
+    state = State::Idle;
+    bit_count = 0;
+    current_byte = 0;
+}
+
+void BusTraceDecoder::on_bit(bool one, size_t index) {
+    if (state == State::Idle) {
+        return;
+    }
+    if (bit_count < 8) {
+        if (bit_count == 0) {
+            first_bit_index = index;
+        }
+        current_byte = (current_byte << 1) | (one ? 1 : 0);
+        if (++bit_count == 8) {
+            if (state == State::Address) {
+                add_field(DecodedField(DecodedField::Type::Address, first_bit_index, current_byte >> 1, current_byte & 0x01));
+            } else {
+                add_field(DecodedField(DecodedField::Type::Data, first_bit_index, current_byte));
+            }
+        }
+    } else {
+        // The 9th bit is the ACK
+        add_field(DecodedField(one ? DecodedField::Type::Nack : DecodedField::Type::Ack, index));
+        state = State::Data;
+        bit_count = 0;
+        current_byte = 0;
+    }
+}
+
+static size_t print_hex(Print& p, uint8_t value) {
+    const char* digits = "0123456789ABCDEF";
+    char text[5] = {'0', 'x', digits[value >> 4], digits[value & 0x0F], '\0'};
+    return p.print(text);
+}
+
+size_t BusTraceDecoder::printTo(Print& p) const {
+    // Print each field as we go rather than building a String
+    // that holds the whole trace.
+    size_t count = 0;
+    for (size_t i = 0; i < current_field_count; ++i) {
+        const DecodedField& f = fields[i];
+        if (i > 0 && f.type != DecodedField::Type::Start) {
+            count += p.print(" ");
+        }
+        switch (f.type) {
+            case DecodedField::Type::Start:
+                if (i > 0) {
+                    count += p.print("\r\n");
+                }
+                count += p.print("START");
+                break;
+            case DecodedField::Type::RepeatedStart:
+                count += p.print("RESTART");
+                break;
+            case DecodedField::Type::Stop:
+                count += p.print("STOP");
+                break;
+            case DecodedField::Type::Address:
+                count += print_hex(p, f.value);
+                count += p.print(f.read ? " R" : " W");
+                break;
+            case DecodedField::Type::Data:
+                count += print_hex(p, f.value);
+                break;
+            case DecodedField::Type::Ack:
+                count += p.print("ACK");
+                break;
+            case DecodedField::Type::Nack:
+                count += p.print("NACK");
+                break;
+        }
+    }
+    count += p.print("\r\n");
+    return count;
+}
+
+} // bus_trace
@@ -0,0 +1,148 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRACE_DECODER_H
+#define I2C_UNDERNEATH_BUS_TRACE_DECODER_H
+
+#include <Arduino.h>
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+
+namespace bus_trace {
+
+// One part of an I2C message such as a START bit or a data byte.
+struct DecodedField {
+    enum class Type : uint8_t {
+        Start,
+        RepeatedStart,
+        Stop,
+        Address,    // 'value' is the 7 bit address and 'read' is the R/W bit
+        Data,       // 'value' is the byte
+        Ack,
+        Nack
+    };
+
+    DecodedField() = default;
+
+    DecodedField(Type type, size_t event_index, uint8_t value = 0, bool read = false)
+        : type(type), value(value), read(read), event_index(event_index) {
+    }
+
+    Type type = Type::Start;
+
+    // The address or data byte. Always 0 for other field types.
+    uint8_t value = 0;
+
+    // True if the field is the address of a read request.
+    // Always false for other field types.
+    bool read = false;
+
+    // The index of the BusEvent that produced the field. For START and STOP
+    // bits, it's the SDA edge. For bytes, it's the SCL rising edge that
+    // sampled the first bit. For ACK and NACK, it's the SCL rising edge that
+    // sampled the acknowledge bit.
+    size_t event_index = 0;
+};
+
+inline bool operator==(const DecodedField& lhs, const DecodedField& rhs) {
+    return lhs.type == rhs.type &&
+           lhs.value == rhs.value &&
+           lhs.read == rhs.read &&
+           lhs.event_index == rhs.event_index;
+}
+
+inline bool operator!=(const DecodedField& lhs, const DecodedField& rhs) {
+    return !(lhs == rhs);
+}
+
+// Decodes the BusEvents in a trace into START and STOP bits, addresses,
+// data bytes and ACKs. This makes it easy to see what was said on the
+// bus without having to read the edges.
+//
+// The decoder works with raw recordings as well as with the output of
+// BusTrace::to_message(). It ignores SDA edges while SCL is LOW, so
+// spurious edges don't matter. If a single BusEvent contains edges on
+// both lines, it assumes they happened in the right order for a data
+// bit. (See BusTrace::to_message())
+//
+// Nothing is decoded until the first START bit. Incomplete bytes are
+// discarded if they're interrupted by a START or STOP bit.
+// Only 7 bit addresses are supported. The first byte of a 10 bit address
+// is reported as a 7 bit address.
+class BusTraceDecoder : public Printable {
+public:
+    // Creates a decoder.
+    // max_field_count: maximum number of fields that can be stored.
+    // Additional fields are dropped.
+    explicit BusTraceDecoder(size_t max_field_count);
+
+    // Allows you to define the array of fields wherever you want.
+    // fields: an array that will be populated by the decoder.
+    // max_field_count: maximum number of fields that can be stored.
+    // Additional fields are dropped.
+    BusTraceDecoder(DecodedField* fields, size_t max_field_count);
+
+    virtual ~BusTraceDecoder();
+
+    BusTraceDecoder(const BusTraceDecoder&) = delete;
+    BusTraceDecoder& operator=(const BusTraceDecoder&) = delete;
+
+    // Discards any existing fields and decodes every event in 'trace'.
+    // The event indices of the fields match the indices in 'trace'.
+    void decode(const BusTrace& trace);
+
+    // Decodes the next event. This lets you decode events as they
+    // arrive, e.g. from a BusEventQueue. The first event after a reset
+    // has index 0.
+    void add_event(const BusEvent& event);
+
+    // The number of fields decoded so far.
+    inline size_t field_count() const {
+        return current_field_count;
+    }
+
+    // Returns a decoded field or nullptr if index is out of range.
+    const DecodedField* field(size_t index) const;
+
+    // The number of fields that were dropped because there was no room for them.
+    inline size_t dropped_field_count() const {
+        return dropped_fields;
+    }
+
+    // Removes any existing fields and forgets the state of the bus.
+    void reset();
+
+    // Prints the fields. Each message is printed on a separate line.
+    // e.g. "START 0x53 W ACK 0x11 ACK STOP"
+    size_t printTo(Print& p) const override;
+
+private:
+    enum class State : uint8_t {
+        Idle,       // Waiting for a START bit
+        Address,    // Receiving the address byte
+        Data        // Receiving data bytes
+    };
+
+    DecodedField* fields;
+    const size_t max_field_count;
+    const bool created_fields;
+    size_t current_field_count = 0;
+    size_t dropped_fields = 0;
+
+    State state = State::Idle;
+    size_t event_index = 0;     // Index of the next event
+    uint8_t bit_count = 0;      // Bits received in the current byte including the ACK bit
+    uint8_t current_byte = 0;
+    size_t first_bit_index = 0;
+
+    void add_field(const DecodedField& field);
+    void on_start(size_t index);
+    void on_stop(size_t index);
+    void on_bit(bool one, size_t index);
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRACE_DECODER_H
@@ -0,0 +1,94 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <new>
+#include "bus_trace_pool.h"
+
+namespace bus_trace {
+
+BusTracePool::BusTracePool(const common::hal::Clock* clock, size_t trace_count, size_t events_per_trace)
+    : events(new BusEvent[trace_count * events_per_trace]), created_events(true),
+      count(trace_count), max_events(events_per_trace) {
+    create_traces(clock);
+}
+
+BusTracePool::BusTracePool(const common::hal::Clock* clock, BusEvent* events, size_t trace_count, size_t events_per_trace)
+    : events(events), created_events(false),
+      count(trace_count), max_events(events_per_trace) {
+    create_traces(clock);
+}
+
+BusTracePool::~BusTracePool() {
+    for (size_t i = 0; i < count; ++i) {
+        traces[i].~BusTrace();
+    }
+    ::operator delete(traces);
+    delete[] free_traces;
+    delete[] in_use;
+    if (created_events && events) {
+        delete[] events;
+        events = nullptr;
+    }
+}
+
+void BusTracePool::create_traces(const common::hal::Clock* clock) {
+    // BusTrace doesn't have a default constructor so we
+    // can't use new[] to create the array of traces.
+    traces = static_cast<BusTrace*>(::operator new(sizeof(BusTrace) * count));
+    free_traces = new size_t[count];
+    in_use = new bool[count];
+    for (size_t i = 0; i < count; ++i) {
+        new(&traces[i]) BusTrace(clock, events + i * max_events, max_events);
+        // Hand out the first trace first
+        free_traces[i] = count - 1 - i;
+        in_use[i] = false;
+    }
+    free_count = count;
+}
+
+BusTrace* BusTracePool::acquire() {
+    if (free_count == 0) {
+        failed_acquires++;
+        return nullptr;
+    }
+    size_t index = free_traces[--free_count];
+    in_use[index] = true;
+    if (++in_use_count > max_in_use_count) {
+        max_in_use_count = in_use_count;
+    }
+    BusTrace* trace = &traces[index];
+    trace->set_circular(false);
+    trace->disable_tick_index();
+    trace->reset();
+    return trace;
+}
+
+bool BusTracePool::release(BusTrace* trace) {
+    if (trace < traces || trace >= traces + count) {
+        return false;
+    }
+    size_t index = trace - traces;
+    if (!in_use[index]) {
+        return false;
+    }
+    in_use[index] = false;
+    in_use_count--;
+    if (trace->capacity() != max_events) {
+        // The trace has been moved. Don't reuse it.
+        retired_count++;
+        return false;
+    }
+    if (trace->event_count() > max_events_in_trace) {
+        max_events_in_trace = trace->event_count();
+    }
+    free_traces[free_count++] = index;
+    return true;
+}
+
+void BusTracePool::reset_statistics() {
+    max_in_use_count = in_use_count;
+    max_events_in_trace = 0;
+    failed_acquires = 0;
+}
+
+} // bus_trace
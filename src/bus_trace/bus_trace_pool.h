@@ -0,0 +1,121 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRACE_POOL_H
+#define I2C_UNDERNEATH_BUS_TRACE_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+#include "common/hal/clock.h"
+
+namespace bus_trace {
+
+// A fixed number of traces of the same size that can be used over and
+// over again. Use it instead of creating a new BusTrace for every
+// recording. Repeatedly allocating and freeing large traces fragments
+// the heap until a large allocation fails.
+//
+// All the memory is allocated when the pool is created. You can supply
+// the memory for the events yourself. This lets you put them in a
+// particular memory region. e.g. on a Teensy 4.1
+//   EXTMEM BusEvent events[8 * 10'000];
+//   BusTracePool pool(&clock, events, 8, 10'000);
+//
+// acquire() and release() take constant time. They must not be called
+// from an interrupt handler while they're running in the main program.
+//
+// Use BusTrace::to_message(BusTrace&) to convert traces to messages
+// without allocating memory.
+class BusTracePool {
+public:
+    // Creates a pool of 'trace_count' traces that can each hold
+    // 'events_per_trace' events.
+    // 'clock' is given to every trace. It may be nullptr.
+    BusTracePool(const common::hal::Clock* clock, size_t trace_count, size_t events_per_trace);
+
+    // As above but the events are stored in 'events', which must hold
+    // at least trace_count * events_per_trace events.
+    BusTracePool(const common::hal::Clock* clock, BusEvent* events, size_t trace_count, size_t events_per_trace);
+
+    virtual ~BusTracePool();
+
+    BusTracePool(const BusTracePool&) = delete;
+    BusTracePool& operator=(const BusTracePool&) = delete;
+
+    // Returns an empty trace or nullptr if every trace is in use.
+    // The trace isn't circular and doesn't have a tick index.
+    // Don't move from or move to a pooled trace. See release()
+    BusTrace* acquire();
+
+    // Returns a trace to the pool. The trace must not be used afterwards.
+    // Returns false if the trace didn't come from this pool, has
+    // already been released or no longer uses the pool's events. e.g.
+    // because it was moved from. A trace that's rejected for that
+    // reason is retired. It's no longer in use but it's never handed
+    // out again. See retired_trace_count()
+    bool release(BusTrace* trace);
+
+    inline size_t trace_count() const {
+        return count;
+    }
+
+    inline size_t events_per_trace() const {
+        return max_events;
+    }
+
+    // The number of traces that have been acquired but not released.
+    inline size_t traces_in_use() const {
+        return in_use_count;
+    }
+
+    // The number of traces that were moved from before they were released.
+    // The pool has this many fewer traces to hand out.
+    inline size_t retired_trace_count() const {
+        return retired_count;
+    }
+
+    // The largest number of traces that have been in use at once.
+    // Use it to check that the pool isn't bigger than it needs to be.
+    inline size_t max_traces_in_use() const {
+        return max_in_use_count;
+    }
+
+    // The largest number of events in a trace when it was released.
+    // If this equals events_per_trace() then a trace may have filled
+    // up and dropped events.
+    inline size_t max_events_used() const {
+        return max_events_in_trace;
+    }
+
+    // The number of times acquire() failed because every trace was in use.
+    inline size_t failed_acquire_count() const {
+        return failed_acquires;
+    }
+
+    // Clears the statistics. Doesn't affect the traces in use.
+    void reset_statistics();
+
+private:
+    BusEvent* events;
+    bool created_events;
+    size_t count;
+    size_t max_events;
+    BusTrace* traces;           // The traces. Constructed in place.
+    size_t* free_traces;        // Stack of indices into 'traces'
+    size_t free_count;
+    bool* in_use;               // in_use[i] is true if traces[i] has been acquired
+
+    size_t in_use_count = 0;
+    size_t retired_count = 0;
+    size_t max_in_use_count = 0;
+    size_t max_events_in_trace = 0;
+    size_t failed_acquires = 0;
+
+    void create_traces(const common::hal::Clock* clock);
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRACE_POOL_H
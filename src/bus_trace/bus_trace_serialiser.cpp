@@ -0,0 +1,117 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <cstring>
+#include "bus_trace_serialiser.h"
+
+namespace bus_trace {
+
+// Events are written and read in batches to avoid calling
+// Print::write() and Stream::readBytes() for every event.
+static const size_t EVENTS_PER_BATCH = 64;
+static const uint8_t MAGIC[4] = {'I', '2', 'C', 'T'};
+
+static void put_uint32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get_uint32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+size_t BusTraceSerialiser::write(const BusTrace& trace, Print& output, uint8_t flags) {
+    uint8_t buffer[EVENTS_PER_BATCH * EVENT_SIZE];
+    memcpy(buffer, MAGIC, sizeof(MAGIC));
+    buffer[4] = VERSION;
+    buffer[5] = flags;
+    buffer[6] = 0;
+    buffer[7] = 0;
+    put_uint32(buffer + 8, ticks_per_second(trace));
+    put_uint32(buffer + 12, (uint32_t)trace.event_count());
+    size_t count = output.write(buffer, HEADER_SIZE);
+
+    size_t used = 0;
+    for (size_t i = 0; i < trace.event_count(); ++i) {
+        const BusEvent* event = trace.event(i);
+        uint8_t* out = buffer + used;
+        out[0] = (uint8_t)event->delta_t_in_ticks;
+        out[1] = (uint8_t)(event->delta_t_in_ticks >> 8);
+        out[2] = event->flags;
+        out[3] = 0;
+        used += EVENT_SIZE;
+        if (used == sizeof(buffer)) {
+            count += output.write(buffer, used);
+            used = 0;
+        }
+    }
+    if (used) {
+        count += output.write(buffer, used);
+    }
+    return count;
+}
+
+bool BusTraceSerialiser::read_header(const uint8_t* data, size_t size, BusTraceHeader& header) {
+    if (size < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || data[4] != VERSION) {
+        return false;
+    }
+    header.version = data[4];
+    header.flags = data[5];
+    header.ticks_per_second = get_uint32(data + 8);
+    header.event_count = get_uint32(data + 12);
+    return true;
+}
+
+bool BusTraceSerialiser::read(const uint8_t* data, size_t size, BusTrace& trace, BusTraceHeader* header) {
+    BusTraceHeader h;
+    if (!read_header(data, size, h)) {
+        return false;
+    }
+    if (header) {
+        *header = h;
+    }
+    if ((size - HEADER_SIZE) / EVENT_SIZE < h.event_count) {
+        return false;
+    }
+    const uint8_t* in = data + HEADER_SIZE;
+    for (uint32_t i = 0; i < h.event_count; ++i) {
+        trace.add_event(decode_event(in));
+        in += EVENT_SIZE;
+    }
+    return true;
+}
+
+bool BusTraceSerialiser::read(Stream& input, BusTrace& trace, BusTraceHeader* header) {
+    uint8_t buffer[EVENTS_PER_BATCH * EVENT_SIZE];
+    size_t size = input.readBytes((char*)buffer, HEADER_SIZE);
+    BusTraceHeader h;
+    if (!read_header(buffer, size, h)) {
+        return false;
+    }
+    if (header) {
+        *header = h;
+    }
+    uint32_t remaining = h.event_count;
+    while (remaining) {
+        size_t batch = min((size_t)remaining, EVENTS_PER_BATCH);
+        size_t bytes = input.readBytes((char*)buffer, batch * EVENT_SIZE);
+        for (size_t i = 0; i + EVENT_SIZE <= bytes; i += EVENT_SIZE) {
+            trace.add_event(decode_event(buffer + i));
+        }
+        if (bytes != batch * EVENT_SIZE) {
+            // The stream ended early
+            return false;
+        }
+        remaining -= batch;
+    }
+    return true;
+}
+
+uint32_t BusTraceSerialiser::ticks_per_second(const BusTrace& trace) {
+    const common::hal::Clock* clock = trace.get_clock();
+    return clock ? clock->ticks_per_second() : 0;
+}
+
+} // bus_trace
@@ -0,0 +1,93 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRACE_SERIALISER_H
+#define I2C_UNDERNEATH_BUS_TRACE_SERIALISER_H
+
+#include <Arduino.h>
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+
+namespace bus_trace {
+
+// Describes a serialised trace.
+struct BusTraceHeader {
+    // Set in 'flags' if the trace was recorded by a system that was
+    // driving the bus pins. i.e. the events may include pin changes.
+    static const uint8_t PIN_EVENTS = 0x01;
+
+    uint8_t version = 0;
+    uint8_t flags = 0;
+
+    // The rate of the clock that recorded the events. 0 if unknown.
+    uint32_t ticks_per_second = 0;
+
+    uint32_t event_count = 0;
+
+    inline bool has_pin_events() const {
+        return flags & PIN_EVENTS;
+    }
+};
+
+// Writes BusTraces in a compact binary format and reads them back again.
+// This is much faster than printing a trace and preserves every detail
+// including the timings. Use it to copy traces off the device so you
+// can analyse them with the host build.
+//
+// FORMAT
+// All values are little endian.
+//
+// Header (16 bytes)
+// Offset Size Value
+//   0     4   Magic number. The ASCII characters "I2CT"
+//   4     1   Format version. Currently 1
+//   5     1   Flags. See BusTraceHeader
+//   6     2   Reserved. Always 0
+//   8     4   Clock rate in ticks per second. 0 if unknown
+//  12     4   Number of events
+//
+// Events (4 bytes each)
+// Offset Size Value
+//   0     2   BusEvent::delta_t_in_ticks
+//   2     1   BusEvent::flags
+//   3     1   Reserved. Always 0
+class BusTraceSerialiser {
+public:
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 16;
+    static const size_t EVENT_SIZE = 4;
+
+    // Writes 'trace' to 'output' without allocating any memory.
+    // 'flags' are copied to the header. See BusTraceHeader.
+    // The header stores the trace's clock->ticks_per_second() or 0 if
+    // the trace doesn't have a clock.
+    // Returns the number of bytes written.
+    static size_t write(const BusTrace& trace, Print& output, uint8_t flags = 0);
+
+    // Parses the header at the start of 'data'.
+    // Returns false if 'data' is too short or isn't a serialised trace.
+    static bool read_header(const uint8_t* data, size_t size, BusTraceHeader& header);
+
+    // Adds the events from a serialised trace to 'trace'. Events are
+    // dropped if 'trace' is too small. See BusTrace::add_event()
+    // Copies the header to 'header' if it's not nullptr.
+    // Returns false if the data is invalid or incomplete.
+    static bool read(const uint8_t* data, size_t size, BusTrace& trace, BusTraceHeader* header = nullptr);
+
+    // As above but reads the serialised trace from a Stream such as a file.
+    static bool read(Stream& input, BusTrace& trace, BusTraceHeader* header = nullptr);
+
+    // Converts 4 serialised bytes to a BusEvent.
+    static inline BusEvent decode_event(const uint8_t* data) {
+        return BusEvent((uint16_t)(data[0] | (data[1] << 8)), (BusEventFlags)data[2]);
+    }
+
+private:
+    static uint32_t ticks_per_second(const BusTrace& trace);
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRACE_SERIALISER_H
@@ -0,0 +1,42 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "bus_trigger.h"
+
+namespace bus_trace {
+
+BusTrigger& BusTrigger::on_start() {
+    conditions |= START;
+    return *this;
+}
+
+BusTrigger& BusTrigger::on_address(uint8_t address_to_match) {
+    conditions |= ADDRESS;
+    address = address_to_match;
+    return *this;
+}
+
+BusTrigger& BusTrigger::on_nack() {
+    conditions |= NACK;
+    return *this;
+}
+
+BusTrigger& BusTrigger::on_scl_held_low(uint32_t nanos, uint32_t ticks_per_second) {
+    conditions |= SCL_HELD_LOW;
+    min_scl_low_ticks = (uint32_t)(((uint64_t)nanos * ticks_per_second + 999'999'999) / 1'000'000'000);
+    return *this;
+}
+
+BusTrigger& BusTrigger::on_glitch() {
+    conditions |= GLITCH;
+    return *this;
+}
+
+void BusTrigger::reset() {
+    decoder.reset();
+    previous_changed = BOTH_LOW_AND_UNCHANGED;
+    scl_low = false;
+    scl_low_ticks = 0;
+}
+
+} // bus_trace
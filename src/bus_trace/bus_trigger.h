@@ -0,0 +1,120 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRIGGER_H
+#define I2C_UNDERNEATH_BUS_TRIGGER_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event_flags.h"
+#include "byte_decoder.h"
+
+namespace bus_trace {
+
+// Watches bus events as they happen and fires when one of its
+// conditions is met. Like the trigger on a logic analyser.
+// e.g. to trigger on any NACK or on a message to address 0x53
+//   BusTrigger trigger;
+//   trigger.on_nack().on_address(0x53);
+//
+// Each event is checked as it arrives so a condition can only fire on
+// an edge. For example, if SCL is held LOW forever then on_scl_held_low()
+// never fires because SCL never rises again.
+//
+// It's fast enough to be called from the BusRecorder interrupt service
+// routine. See TriggeredTrace.
+class BusTrigger {
+public:
+    BusTrigger() = default;
+
+    // Fires on every START and repeated START.
+    BusTrigger& on_start();
+
+    // Fires on the ACK or NACK bit after the 7 bit 'address'.
+    BusTrigger& on_address(uint8_t address);
+
+    // Fires when an address or data byte is NACKed.
+    BusTrigger& on_nack();
+
+    // Fires when SCL rises after being LOW for at least 'nanos'.
+    // 'ticks_per_second' is the rate of the clock used for the event deltas.
+    BusTrigger& on_scl_held_low(uint32_t nanos, uint32_t ticks_per_second);
+
+    // Fires when the recorder records a glitch. i.e. a pulse that was
+    // too short to time. See BusRecorder.
+    BusTrigger& on_glitch();
+
+    // Checks the next event. 'delta' is the number of ticks since the
+    // previous event. Returns true if any condition is met.
+    inline bool add_event(uint32_t delta, BusEventFlags flags) {
+        bool fired = false;
+        const BusEventFlags changed = flags & (SDA_LINE_CHANGED | SCL_LINE_CHANGED);
+
+        if (conditions & GLITCH) {
+            fired |= (delta == 0 && changed && changed == previous_changed);
+        }
+        previous_changed = changed;
+
+        if (conditions & SCL_HELD_LOW) {
+            scl_low_ticks += delta;
+            if (scl_low_ticks < delta) {
+                scl_low_ticks = UINT32_MAX;   // Saturate
+            }
+            if (flags & SCL_LINE_CHANGED) {
+                if (flags & SCL_LINE_STATE) {
+                    fired |= scl_low && scl_low_ticks >= min_scl_low_ticks;
+                    scl_low = false;
+                } else {
+                    scl_low = true;
+                    scl_low_ticks = 0;
+                }
+            }
+        }
+
+        if (conditions & (START | ADDRESS | NACK)) {
+            const DecodedByte::Type type = decoder.add_event(flags);
+            switch (type) {
+                case DecodedByte::Type::Start:
+                case DecodedByte::Type::RepeatedStart:
+                    fired |= (conditions & START) != 0;
+                    break;
+                case DecodedByte::Type::AddressAck:
+                case DecodedByte::Type::AddressNack:
+                    fired |= (conditions & ADDRESS) && (decoder.last_value() >> 1) == address;
+                    fired |= (conditions & NACK) && type == DecodedByte::Type::AddressNack;
+                    break;
+                case DecodedByte::Type::DataNack:
+                    fired |= (conditions & NACK) != 0;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return fired;
+    }
+
+    // Forgets the state of the bus. Keeps the conditions.
+    void reset();
+
+private:
+    static const uint8_t START = 1 << 0;
+    static const uint8_t ADDRESS = 1 << 1;
+    static const uint8_t NACK = 1 << 2;
+    static const uint8_t SCL_HELD_LOW = 1 << 3;
+    static const uint8_t GLITCH = 1 << 4;
+
+    uint8_t conditions = 0;
+    uint8_t address = 0;
+    uint32_t min_scl_low_ticks = 0;
+
+    // The decoder doesn't keep any bytes. We just want to know
+    // when each byte is completed.
+    ByteDecoder decoder{nullptr, 0};
+    BusEventFlags previous_changed = BOTH_LOW_AND_UNCHANGED;
+    bool scl_low = false;
+    uint32_t scl_low_ticks = 0;
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRIGGER_H
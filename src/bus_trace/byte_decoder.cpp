@@ -0,0 +1,39 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "byte_decoder.h"
+
+namespace bus_trace {
+
+const ByteDecoder::TransitionTable ByteDecoder::transitions = build_transitions();
+
+ByteDecoder::ByteDecoder(size_t max_byte_count)
+    : bytes(new DecodedByte[max_byte_count]), max_byte_count(max_byte_count), created_bytes(true) {
+}
+
+ByteDecoder::ByteDecoder(DecodedByte* bytes, size_t max_byte_count)
+    : bytes(bytes), max_byte_count(max_byte_count), created_bytes(false) {
+}
+
+ByteDecoder::~ByteDecoder() {
+    if (created_bytes && bytes) {
+        delete[] bytes;
+        bytes = nullptr;
+    }
+}
+
+const DecodedByte* ByteDecoder::byte(size_t index) const {
+    if (index < current_byte_count) {
+        return &bytes[index];
+    }
+    return nullptr;
+}
+
+void ByteDecoder::reset() {
+    current_byte_count = 0;
+    dropped_bytes = 0;
+    state = IDLE;
+    current_byte = 0;
+}
+
+} // bus_trace
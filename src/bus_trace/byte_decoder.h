@@ -0,0 +1,181 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BYTE_DECODER_H
+#define I2C_UNDERNEATH_BYTE_DECODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event_flags.h"
+
+namespace bus_trace {
+
+// A byte decoded by ByteDecoder. Takes 2 bytes of RAM.
+struct DecodedByte {
+    enum class Type : uint8_t {
+        None,           // Used internally. Never recorded.
+        Start,
+        RepeatedStart,
+        Stop,
+        AddressAck,     // An address byte followed by an ACK.
+        AddressNack,    // An address byte followed by a NACK.
+        DataAck,        // A data byte followed by an ACK.
+        DataNack        // A data byte followed by a NACK.
+    };
+
+    Type type;
+
+    // The byte that was sent on the bus. For addresses, this is the
+    // address shifted left 1 bit plus the R/W bit.
+    // Always 0 for START and STOP bits.
+    uint8_t value;
+};
+
+// Decodes bus events into bytes as they happen. It's fast enough to
+// be called from the BusRecorder interrupt service routine.
+//
+// Decoding while recording saves a lot of RAM. A byte is recorded in a
+// 2 byte DecodedByte instead of about 28 BusEvents. The downside is that
+// you lose all the timing information and any edges that aren't part
+// of a valid I2C message.
+//
+// Each event costs one lookup in a transition table that's built at
+// compile time. The table is indexed by the current state and the
+// line flags of the event. Like BusTraceDecoder, it ignores everything
+// before the first START and assumes that merged edges happened in the
+// correct order for a data bit. Use BusTraceDecoder if you've already
+// got a BusTrace and you need to know which events produced each field.
+class ByteDecoder {
+public:
+    // Creates a decoder.
+    // max_byte_count: maximum number of bytes that can be stored.
+    // Additional bytes are dropped.
+    explicit ByteDecoder(size_t max_byte_count);
+
+    // Allows you to define the array of bytes wherever you want.
+    // bytes: an array that will be populated by the decoder.
+    // max_byte_count: maximum number of bytes that can be stored.
+    // Additional bytes are dropped.
+    ByteDecoder(DecodedByte* bytes, size_t max_byte_count);
+
+    virtual ~ByteDecoder();
+
+    ByteDecoder(const ByteDecoder&) = delete;
+    ByteDecoder& operator=(const ByteDecoder&) = delete;
+
+    // Decodes the next event. Returns the type of byte that the event
+    // completed or DecodedByte::Type::None. See last_value()
+    inline DecodedByte::Type add_event(BusEventFlags flags) {
+        const Transition& transition = transitions.next[state][flags & LINE_FLAGS];
+        state = transition.next_state;
+        current_byte = (uint8_t)((current_byte << transition.shift) | transition.bit);
+        if (transition.output != DecodedByte::Type::None) {
+            add_byte(transition.output);
+        }
+        return transition.output;
+    }
+
+    // The value of the byte that was completed by the last call to
+    // add_event(). Only meaningful for addresses and data.
+    inline uint8_t last_value() const {
+        return current_byte;
+    }
+
+    // The number of bytes decoded since the decoder was created or reset.
+    inline size_t byte_count() const {
+        return current_byte_count;
+    }
+
+    // Returns a decoded byte or nullptr if index is out of range.
+    const DecodedByte* byte(size_t index) const;
+
+    // The number of bytes that were dropped because there was no room for them.
+    inline size_t dropped_byte_count() const {
+        return dropped_bytes;
+    }
+
+    // Removes any existing bytes and forgets the state of the bus.
+    void reset();
+
+private:
+    // SDA_LINE_CHANGED | SCL_LINE_CHANGED | SDA_LINE_STATE | SCL_LINE_STATE
+    static const uint8_t LINE_FLAGS = 0x0F;
+    static const uint8_t IDLE = 0;              // Waiting for a START bit
+    static const uint8_t FIRST_ADDRESS_BIT = 1; // States 1 to 9 receive the address and ACK
+    static const uint8_t FIRST_DATA_BIT = 10;   // States 10 to 18 receive a data byte and ACK
+    static const uint8_t STATE_COUNT = 19;
+
+    struct Transition {
+        uint8_t next_state;
+        uint8_t shift;      // 1 to shift 'bit' into the current byte. 0 otherwise.
+        uint8_t bit;
+        DecodedByte::Type output;
+    };
+
+    struct TransitionTable {
+        Transition next[STATE_COUNT][LINE_FLAGS + 1];
+    };
+
+    static constexpr Transition transition(uint8_t state, uint8_t flags) {
+        const bool sda_high = flags & SDA_LINE_STATE;
+        const bool scl_high = flags & SCL_LINE_STATE;
+        if (flags & SCL_LINE_CHANGED) {
+            // If SDA changed too then it changed while SCL was LOW.
+            // It doesn't affect the bit.
+            if (!scl_high || state == IDLE) {
+                return Transition{state, 0, 0, DecodedByte::Type::None};
+            }
+            const bool address = state < FIRST_DATA_BIT;
+            const uint8_t bit_index = state - (address ? FIRST_ADDRESS_BIT : FIRST_DATA_BIT);
+            if (bit_index < 8) {
+                return Transition{(uint8_t)(state + 1), 1, sda_high, DecodedByte::Type::None};
+            }
+            // ACK bit
+            DecodedByte::Type output = address ?
+                    (sda_high ? DecodedByte::Type::AddressNack : DecodedByte::Type::AddressAck) :
+                    (sda_high ? DecodedByte::Type::DataNack : DecodedByte::Type::DataAck);
+            return Transition{FIRST_DATA_BIT, 0, 0, output};
+        }
+        if ((flags & SDA_LINE_CHANGED) && scl_high) {
+            if (sda_high) {
+                return Transition{IDLE, 0, 0, state == IDLE ? DecodedByte::Type::None : DecodedByte::Type::Stop};
+            }
+            return Transition{FIRST_ADDRESS_BIT, 0, 0, state == IDLE ? DecodedByte::Type::Start : DecodedByte::Type::RepeatedStart};
+        }
+        return Transition{state, 0, 0, DecodedByte::Type::None};
+    }
+
+    static constexpr TransitionTable build_transitions() {
+        TransitionTable table{};
+        for (uint8_t state = 0; state < STATE_COUNT; state++) {
+            for (uint8_t flags = 0; flags <= LINE_FLAGS; flags++) {
+                table.next[state][flags] = transition(state, flags);
+            }
+        }
+        return table;
+    }
+
+    // Built at compile time. See byte_decoder.cpp
+    static const TransitionTable transitions;
+
+    DecodedByte* bytes;
+    const size_t max_byte_count;
+    const bool created_bytes;
+    size_t current_byte_count = 0;
+    size_t dropped_bytes = 0;
+    uint8_t state = IDLE;
+    uint8_t current_byte = 0;
+
+    inline void add_byte(DecodedByte::Type type) {
+        if (current_byte_count < max_byte_count) {
+            uint8_t value = type >= DecodedByte::Type::AddressAck ? current_byte : 0;
+            bytes[current_byte_count++] = DecodedByte{type, value};
+        } else {
+            dropped_bytes++;
+        }
+    }
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BYTE_DECODER_H
@@ -0,0 +1,122 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "capture_recorder.h"
+
+namespace bus_trace {
+
+using common::hal::EdgeCapture;
+
+CaptureRecorder::CaptureRecorder(EdgeCapture& capture)
+    : capture(capture), counter_mask(capture.counter_mask()) {
+}
+
+void CaptureRecorder::start(BusTrace& trace) {
+    stop(); // Stop the current recording if there is one.
+    stats = RecorderStatistics();
+
+    capture.start();
+    counter_at_drain = capture.read_counter();
+    ticks_at_drain = 0;
+    previous_event_ticks = 0;
+    has_pending_event = false;
+    line_states = BOTH_LOW_AND_UNCHANGED;
+    if (capture.read_line(EdgeCapture::SDA)) {
+        line_states = line_states | SDA_LINE_STATE;
+    }
+    if (capture.read_line(EdgeCapture::SCL)) {
+        line_states = line_states | SCL_LINE_STATE;
+    }
+    current_trace = &trace;
+    trace.reset();
+    trace.add_event_with_delta(0, line_states);
+}
+
+void CaptureRecorder::stop() {
+    if (!current_trace) {
+        return;
+    }
+    drain();
+    capture.stop();
+    stats.dropped_events = current_trace->dropped_event_count();
+    current_trace = nullptr;
+}
+
+size_t CaptureRecorder::drain() {
+    if (!current_trace) {
+        return 0;
+    }
+    // Read the counter before the edges. Every edge we read happened
+    // less than one counter period after the previous drain.
+    const uint32_t counter = capture.read_counter();
+    EdgeCapture::Edge edges[BATCH_SIZE];
+    size_t total = 0;
+    size_t count;
+    do {
+        count = capture.read_edges(edges, BATCH_SIZE);
+        for (size_t i = 0; i < count; ++i) {
+            add_edge(edges[i]);
+        }
+        total += count;
+    } while (count == BATCH_SIZE);
+    flush_pending_event();
+    ticks_at_drain += (counter - counter_at_drain) & counter_mask;
+    counter_at_drain = counter;
+    return total;
+}
+
+RecorderStatistics CaptureRecorder::statistics() const {
+    RecorderStatistics result = stats;
+    if (current_trace) {
+        result.dropped_events = current_trace->dropped_event_count();
+    }
+    return result;
+}
+
+void CaptureRecorder::add_edge(const EdgeCapture::Edge& edge) {
+    const uint32_t ticks = ticks_at_drain + ((edge.count - counter_at_drain) & counter_mask);
+    const BusEventFlags line = (edge.line == EdgeCapture::SDA) ? SDA_LINE_STATE : SCL_LINE_STATE;
+    const auto changed = (BusEventFlags)(line << 2);
+    const BusEventFlags new_state = edge.high ? line : BOTH_LOW_AND_UNCHANGED;
+
+    if ((line_states & line) == new_state) {
+        // The line didn't change so the hardware must have missed an edge.
+        // Record a glitch in its place.
+        stats.missed_edges++;
+        stats.glitches++;
+        flush_pending_event();
+        record(ticks, changed | (line_states ^ line));
+        record(ticks, changed | line_states);
+        return;
+    }
+
+    line_states = (line_states & ~line) | new_state;
+    if (has_pending_event && pending_ticks == ticks) {
+        if (!(pending_flags & changed)) {
+            // Both lines changed at once
+            stats.merged_events++;
+            pending_flags = (pending_flags & (SDA_LINE_CHANGED | SCL_LINE_CHANGED)) | changed | line_states;
+            return;
+        }
+        // The same line changed twice in one tick
+        stats.glitches++;
+    }
+    flush_pending_event();
+    has_pending_event = true;
+    pending_ticks = ticks;
+    pending_flags = changed | line_states;
+}
+
+void CaptureRecorder::flush_pending_event() {
+    if (has_pending_event) {
+        has_pending_event = false;
+        record(pending_ticks, pending_flags);
+    }
+}
+
+void CaptureRecorder::record(uint32_t ticks, BusEventFlags flags) {
+    current_trace->add_event_with_delta(ticks - previous_event_ticks, flags);
+    previous_event_ticks = ticks;
+}
+
+} // bus_trace
@@ -0,0 +1,93 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_CAPTURE_RECORDER_H
+#define I2C_UNDERNEATH_CAPTURE_RECORDER_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+#include "recorder_statistics.h"
+#include "common/hal/edge_capture.h"
+
+namespace bus_trace {
+
+// Records the electrical activity on an I2C bus using timer input capture.
+//
+// BusRecorder timestamps each edge in an interrupt service routine. It
+// loses edges that are closer together than the time it takes to run
+// the ISR. (About 130 nanoseconds.) This recorder lets the hardware
+// timestamp the edges instead. It still takes an interrupt for each
+// edge and it loses an edge if the same line changes twice before the
+// ISR runs. See TeensyEdgeCapture. The edges are buffered and converted
+// to BusEvents in batches by drain(). The timings are accurate to one
+// tick of the capture counter however long drain() takes to run.
+//
+// The trace's deltas are in ticks of the capture counter. Give the trace
+// a clock that runs at capture.ticks_per_second() if you want to convert
+// them to nanoseconds.
+//
+// Edges on both lines with the same count are merged into a single
+// event. If the capture hardware misses an edge then the recorder
+// adds a glitch where it should have been. See RecorderStatistics.
+class CaptureRecorder {
+public:
+    // The number of edges read from the capture hardware at once.
+    static const size_t BATCH_SIZE = 16;
+
+    explicit CaptureRecorder(common::hal::EdgeCapture& capture);
+
+    // Stops any recording that's in progress and then starts recording
+    // to 'trace'. The trace is reset first. Events are dropped when
+    // the trace is full.
+    void start(BusTrace& trace);
+
+    // Drains the remaining edges and then stops recording.
+    void stop();
+
+    inline bool is_recording() const {
+        return current_trace != nullptr;
+    }
+
+    // Adds the captured edges to the trace. Returns the number of edges.
+    //
+    // drain() must be called at least once every counter period, i.e.
+    // every capture.counter_mask() + 1 ticks, even if the bus is idle.
+    // Otherwise the recorder can't tell how many times the counter has
+    // wrapped round. Call it from loop() or from a timer interrupt, but
+    // not from both.
+    size_t drain();
+
+    // Counts the glitches, merged events, missed edges and dropped
+    // events in the current recording or in the last one.
+    RecorderStatistics statistics() const;
+
+private:
+    common::hal::EdgeCapture& capture;
+    const uint32_t counter_mask;
+    BusTrace* current_trace = nullptr;
+    BusEventFlags line_states = BOTH_LOW_AND_UNCHANGED;
+
+    // Extends the counter to 32 bits
+    uint32_t counter_at_drain = 0;  // Raw counter at the start of the last drain
+    uint32_t ticks_at_drain = 0;    // Extended count at the start of the last drain
+    uint32_t previous_event_ticks = 0;
+
+    // An event that may be merged with the next edge
+    bool has_pending_event = false;
+    uint32_t pending_ticks = 0;
+    BusEventFlags pending_flags = BOTH_LOW_AND_UNCHANGED;
+
+    RecorderStatistics stats;
+
+    void add_edge(const common::hal::EdgeCapture::Edge& edge);
+
+    void flush_pending_event();
+
+    void record(uint32_t ticks, BusEventFlags flags);
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_CAPTURE_RECORDER_H
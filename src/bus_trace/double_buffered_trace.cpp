@@ -0,0 +1,49 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "double_buffered_trace.h"
+
+namespace bus_trace {
+
+DoubleBufferedTrace::DoubleBufferedTrace(BusTrace& first, BusTrace& second, TraceFullCallback on_full)
+    : traces{&first, &second}, on_full(on_full), current(&first), spare(&second), full(nullptr) {
+}
+
+void DoubleBufferedTrace::reset(uint32_t current_tick_count) {
+    traces[0]->reset();
+    traces[1]->reset();
+    current = traces[0];
+    spare.store(traces[1], std::memory_order_relaxed);
+    full.store(nullptr, std::memory_order_relaxed);
+    ticks_start = current_tick_count;
+    dropped_events.store(0, std::memory_order_relaxed);
+    swaps.store(0, std::memory_order_release);
+}
+
+bool DoubleBufferedTrace::release(BusTrace& trace) {
+    if (full.load(std::memory_order_acquire) != &trace) {
+        return false;
+    }
+    full.store(nullptr, std::memory_order_relaxed);
+    spare.store(&trace, std::memory_order_release);
+    return true;
+}
+
+bool DoubleBufferedTrace::swap() {
+    BusTrace* next = spare.load(std::memory_order_acquire);
+    if (!next) {
+        return false;
+    }
+    spare.store(nullptr, std::memory_order_relaxed);
+    next->reset();
+    BusTrace* previous = current;
+    current = next;
+    swaps.store(swaps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    full.store(previous, std::memory_order_release);
+    if (on_full) {
+        on_full(*previous);
+    }
+    return true;
+}
+
+} // bus_trace
@@ -0,0 +1,111 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_DOUBLE_BUFFERED_TRACE_H
+#define I2C_UNDERNEATH_DOUBLE_BUFFERED_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+
+namespace bus_trace {
+
+// Records into 2 BusTraces alternately. This lets a BusRecorder record
+// for as long as you like without a gap in the trace.
+//
+// Events are added to the current trace until it's full. The traces are
+// then swapped. The full trace is handed to the application, either by
+// calling 'on_full' or via full_trace(), and recording carries on in the
+// other trace. The application saves the full trace somewhere, e.g. to
+// Serial or an SD card, and then gives it back with release().
+// Joining the traces together in the order they were handed over gives
+// the complete recording. The first event in each trace has the time
+// since the last event in the previous trace.
+//
+// Events are only dropped if both traces are full. i.e. the application
+// didn't release the previous trace before the current one filled up.
+// See dropped_event_count().
+//
+// add_event() is the producer. It's called by the BusRecorder's interrupt
+// service routine. full_trace() and release() are the consumer. They're
+// called by the application's loop(). Neither side has to disable
+// interrupts. reset() must not be called while either side is active.
+class DoubleBufferedTrace {
+public:
+    // Called when a trace is full. 'full' won't be used again until it's
+    // released. WARNING: this is called from the recorder's interrupt
+    // service routine. Keep it short. e.g. set a flag for loop().
+    typedef void (* TraceFullCallback)(BusTrace& full);
+
+    // 'on_full' may be nullptr if you'd rather poll full_trace().
+    DoubleBufferedTrace(BusTrace& first, BusTrace& second, TraceFullCallback on_full = nullptr);
+
+    DoubleBufferedTrace(const DoubleBufferedTrace&) = delete;
+    DoubleBufferedTrace& operator=(const DoubleBufferedTrace&) = delete;
+
+    // Empties both traces and makes the first one current. Sets the time
+    // of the previous event to 'current_tick_count'.
+    // NOT safe to call while the traces are in use.
+    void reset(uint32_t current_tick_count = 0);
+
+    // The trace that's being recorded. Save it after the recording stops
+    // to get the events that were recorded after the last swap.
+    inline BusTrace& current_trace() const {
+        return *current;
+    }
+
+    // The number of events that were discarded because both traces were full.
+    inline size_t dropped_event_count() const {
+        return dropped_events.load(std::memory_order_relaxed);
+    }
+
+    // The number of times the traces have been swapped since the last reset.
+    inline size_t swap_count() const {
+        return swaps.load(std::memory_order_relaxed);
+    }
+
+    // PRODUCER
+    // Adds an event that happened at 'current_tick_count'. Swaps the traces
+    // first if the current trace can't hold the event. Discards the event
+    // if the other trace hasn't been released yet.
+    inline void add_event(uint32_t current_tick_count, BusEventFlags flags) {
+        // We might need 2 slots. One for a time extension and one for the event.
+        if (current->capacity() - current->event_count() < 2 && !swap()) {
+            dropped_events.store(dropped_events.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        current->add_event_with_delta(current_tick_count - ticks_start, flags);
+        ticks_start = current_tick_count;
+    }
+
+    // CONSUMER
+    // Returns the trace that's waiting to be saved or nullptr if there
+    // isn't one.
+    inline BusTrace* full_trace() const {
+        return full.load(std::memory_order_acquire);
+    }
+
+    // Gives a full trace back once it's been saved. It's reused when the
+    // current trace fills up.
+    // Returns false if 'trace' isn't waiting to be saved.
+    bool release(BusTrace& trace);
+
+private:
+    BusTrace* const traces[2];
+    const TraceFullCallback on_full;
+    BusTrace* current;
+    std::atomic<BusTrace*> spare;   // Set by the consumer. Cleared by the producer.
+    std::atomic<BusTrace*> full;    // Set by the producer. Cleared by the consumer.
+    uint32_t ticks_start = 0;
+    std::atomic<size_t> dropped_events{0};
+    std::atomic<size_t> swaps{0};
+
+    // Makes the spare trace current. Returns false if there isn't a spare.
+    bool swap();
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_DOUBLE_BUFFERED_TRACE_H
@@ -0,0 +1,85 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "gpio_sample_decoder.h"
+
+namespace bus_trace {
+
+namespace {
+
+// The number of samples checked for changes at once
+const size_t BLOCK_SIZE = 32;
+
+} // namespace
+
+GpioSampleDecoder::GpioSampleDecoder(BusTrace& trace, uint32_t sda_mask, uint32_t scl_mask, uint32_t ticks_per_sample)
+    : trace(trace), sda_mask(sda_mask), scl_mask(scl_mask), masks(sda_mask | scl_mask),
+      ticks_per_sample(ticks_per_sample) {
+}
+
+void GpioSampleDecoder::reset() {
+    has_previous = false;
+    previous = 0;
+    samples = 0;
+    last_event_sample = 0;
+    merged_events = 0;
+}
+
+void GpioSampleDecoder::skip_samples(size_t count) {
+    samples += count;
+}
+
+void GpioSampleDecoder::add_samples(const uint32_t* data, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    size_t i = 0;
+    if (!has_previous) {
+        has_previous = true;
+        previous = data[0] & masks;
+        last_event_sample = samples;
+        trace.add_event_with_delta(0, line_states(previous));
+        i = 1;
+    }
+    // Adding an event writes to memory that the compiler can't tell apart
+    // from the decoder's fields. Local copies stay in registers.
+    const uint32_t line_masks = masks;
+    const uint64_t first_sample = samples;
+    uint32_t last = previous;
+    uint64_t last_event = last_event_sample;
+    size_t merged = merged_events;
+    while (i < count) {
+        const uint32_t* block = data + i;
+        const size_t block_size = (count - i < BLOCK_SIZE) ? count - i : BLOCK_SIZE;
+
+        // Skip the block if neither line changes. This loop vectorises.
+        uint32_t differences = 0;
+        for (size_t j = 0; j < block_size; ++j) {
+            differences |= block[j] ^ last;
+        }
+        if ((differences & line_masks) == 0) {
+            i += block_size;
+            continue;
+        }
+
+        // Find the changes one sample at a time
+        for (size_t j = 0; j < block_size; ++j) {
+            const uint32_t sample = block[j] & line_masks;
+            if (sample != last) {
+                const uint64_t index = first_sample + i + j;
+                const auto changed = (BusEventFlags)(line_states(sample ^ last) << 2);
+                merged += (changed == (SDA_LINE_CHANGED | SCL_LINE_CHANGED));
+                trace.add_event_with_delta(saturated_delta(index - last_event), changed | line_states(sample));
+                last_event = index;
+                last = sample;
+            }
+        }
+        i += block_size;
+    }
+    previous = last;
+    last_event_sample = last_event;
+    merged_events = merged;
+    samples += count;
+}
+
+} // bus_trace
@@ -0,0 +1,94 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#if defined(I2C_UNDERNEATH_NATIVE)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_bus_trace.h"
+
+namespace bus_trace {
+
+// The serialised events are used in place as BusEvents.
+static_assert(sizeof(BusEvent) == BusTraceSerialiser::EVENT_SIZE, "BusEvent doesn't match the serialised format");
+static_assert(offsetof(BusEvent, flags) == 2, "BusEvent doesn't match the serialised format");
+
+MappedBusTrace::~MappedBusTrace() {
+    close();
+}
+
+bool MappedBusTrace::open(const char* path, const common::hal::Clock* trace_clock) {
+    close();
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    // The deltas are little endian
+    return false;
+#endif
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status = {};
+    if (fstat(fd, &status) != 0 || (size_t)status.st_size < BusTraceSerialiser::HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = (size_t)status.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file open
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    BusTraceHeader header;
+    const uint8_t* bytes = (const uint8_t*)data;
+    if (!BusTraceSerialiser::read_header(bytes, size, header) ||
+        (size - BusTraceSerialiser::HEADER_SIZE) / BusTraceSerialiser::EVENT_SIZE < header.event_count) {
+        munmap(data, size);
+        return false;
+    }
+    // Analysers usually read the events in order
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+    mapping = data;
+    mapping_size = size;
+    file_header = header;
+    events = (const BusEvent*)(bytes + BusTraceSerialiser::HEADER_SIZE);
+    if (trace_clock) {
+        clock = trace_clock;
+    } else if (header.ticks_per_second) {
+        header_clock = new common::hal::FixedRateClock(header.ticks_per_second);
+        clock = header_clock;
+    }
+    view = new BusTrace(events, event_count(), clock);
+    return true;
+}
+
+void MappedBusTrace::close() {
+    delete view;
+    view = nullptr;
+    delete header_clock;
+    header_clock = nullptr;
+    clock = nullptr;
+    events = nullptr;
+    file_header = BusTraceHeader();
+    if (mapping) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+}
+
+BusTrace MappedBusTrace::chunk(size_t first, size_t count) const {
+    if (first > event_count()) {
+        first = event_count();
+    }
+    if (count > event_count() - first) {
+        count = event_count() - first;
+    }
+    return BusTrace(events + first, count, clock);
+}
+
+} // bus_trace
+
+#endif // I2C_UNDERNEATH_NATIVE
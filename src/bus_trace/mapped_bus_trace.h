@@ -0,0 +1,127 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_MAPPED_BUS_TRACE_H
+#define I2C_UNDERNEATH_MAPPED_BUS_TRACE_H
+
+#if defined(I2C_UNDERNEATH_NATIVE)
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+#include "bus_trace_serialiser.h"
+#include "common/hal/fixed_rate_clock.h"
+
+namespace bus_trace {
+
+// A read-only view of a file written by BusTraceSerialiser.
+//
+// The file is memory mapped rather than loaded, so it can be much larger
+// than the available RAM. The operating system pages the events in as
+// they're used. The serialised events have the same layout as BusEvent,
+// so event() returns a pointer into the file and trace() gives a
+// BusTrace that can be passed to I2CTimingAnalyser, compare_messages()
+// etc. without copying anything.
+//
+// Operations that make a new trace, such as to_message(), still need
+// enough RAM for the result. Use for_each_chunk() to process a large
+// file a piece at a time.
+//
+// Host build only. Requires POSIX mmap() and a little endian machine.
+class MappedBusTrace {
+public:
+    MappedBusTrace() = default;
+
+    virtual ~MappedBusTrace();
+
+    MappedBusTrace(const MappedBusTrace&) = delete;
+    MappedBusTrace& operator=(const MappedBusTrace&) = delete;
+
+    // Maps the file at 'path'. Closes the current file first.
+    // 'clock' converts the ticks to nanoseconds. If it's nullptr then
+    // the clock rate in the file's header is used instead.
+    // Returns false if the file can't be mapped or if it isn't a
+    // complete serialised trace.
+    bool open(const char* path, const common::hal::Clock* clock = nullptr);
+
+    // Unmaps the file. Invalidates any traces and events that came
+    // from it.
+    void close();
+
+    inline bool is_open() const {
+        return mapping != nullptr;
+    }
+
+    inline const BusTraceHeader& header() const {
+        return file_header;
+    }
+
+    inline size_t event_count() const {
+        return file_header.event_count;
+    }
+
+    // Returns an event in the file or nullptr if index is out of range.
+    inline const BusEvent* event(size_t index) const {
+        return index < event_count() ? &events[index] : nullptr;
+    }
+
+    // A read-only trace that contains every event in the file.
+    // Must not be called unless the file is open.
+    inline BusTrace& trace() {
+        return *view;
+    }
+
+    inline const BusTrace& trace() const {
+        return *view;
+    }
+
+    // Returns a read-only trace that shows 'count' events starting at
+    // 'first'. The range is reduced if it goes past the end of the file.
+    // The first event in the chunk gives the initial state of the lines.
+    BusTrace chunk(size_t first, size_t count) const;
+
+    // Calls 'f(const BusTrace& chunk)' for consecutive chunks of up to
+    // 'events_per_chunk' events. Each chunk after the first starts with
+    // the last event of the previous chunk. This gives the initial state
+    // of the lines so no edges are lost at the chunk boundaries.
+    // A chunk never ends with a time extension so extensions stay with
+    // the events they apply to. A chunk holds one extra event if that's
+    // the only way to do this.
+    // Returns false and does nothing if 'events_per_chunk' is less than 2.
+    template<typename F>
+    bool for_each_chunk(size_t events_per_chunk, F f) const {
+        if (events_per_chunk < 2) {
+            return false;
+        }
+        const size_t total = event_count();
+        size_t first = 0;
+        while (first < total) {
+            size_t end = (total - first > events_per_chunk) ? first + events_per_chunk : total;
+            if (end < total && events[end - 1].is_time_extension()) {
+                // Each chunk must add at least one event to the previous one.
+                end = (end - 1 >= first + 2) ? end - 1 : end + 1;
+            }
+            const BusTrace piece = chunk(first, end - first);
+            f(piece);
+            if (end == total) {
+                break;
+            }
+            first = end - 1;
+        }
+        return true;
+    }
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    BusTraceHeader file_header;
+    const BusEvent* events = nullptr;
+    common::hal::FixedRateClock* header_clock = nullptr;
+    const common::hal::Clock* clock = nullptr;
+    BusTrace* view = nullptr;
+};
+
+} // bus_trace
+
+#endif // I2C_UNDERNEATH_NATIVE
+#endif //I2C_UNDERNEATH_MAPPED_BUS_TRACE_H
@@ -0,0 +1,123 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "message_iterator.h"
+#include "bus_trace.h"
+
+namespace bus_trace {
+
+static const BusEventFlags SDA_MASK = SDA_LINE_CHANGED | SDA_LINE_STATE;
+static const BusEventFlags SCL_MASK = SCL_LINE_CHANGED | SCL_LINE_STATE;
+
+static inline bool is_merged_event(const BusEvent& event) {
+    const BusEventFlags both_changed = SDA_LINE_CHANGED | SCL_LINE_CHANGED;
+    return (event.flags & both_changed) == both_changed;
+}
+
+static inline bool sda_changed_while_scl_low(BusEventFlags flags) {
+    bool scl_low = (flags & BusEventFlags::SCL_LINE_STATE) != BusEventFlags::SCL_LINE_STATE;
+    bool sda_changed = (flags & BusEventFlags::SDA_LINE_CHANGED) == BusEventFlags::SDA_LINE_CHANGED;
+    return scl_low && sda_changed;
+}
+
+static inline bool only_sda_changed(BusEventFlags previous, BusEventFlags next) {
+    BusEventFlags sda_flags = (BusEventFlags::SDA_LINE_STATE | BusEventFlags::SDA_LINE_CHANGED);
+    return (previous | sda_flags) == (next | sda_flags);
+}
+
+MessageIterator::EventIterator::EventIterator(const BusTrace& trace, bool split_events)
+    : trace(trace), split_events(split_events) {
+    skip_time_extensions();
+}
+
+bool MessageIterator::EventIterator::has_next() const {
+    return get_second_of_pair_next || next_index < trace.event_count();
+}
+
+BusEvent MessageIterator::EventIterator::next() {
+    if (get_second_of_pair_next) {
+        get_second_of_pair_next = false;
+        return second_event_of_pair;
+    }
+    const BusEvent event = *trace.event(next_index++);
+    skip_time_extensions();
+    if (split_events && is_merged_event(event)) {
+        // Assume the edges happened in the right order for a data bit.
+        // i.e. SDA changes before SCL rises and after SCL falls.
+        get_second_of_pair_next = true;
+        if (event.flags & SCL_LINE_STATE) {
+            BusEventFlags initial_sda_state = event.flags & SDA_MASK;
+            BusEventFlags initial_scl_state = (~event.flags) & SCL_MASK;
+            BusEventFlags final_sda_state = event.flags & SDA_LINE_STATE;
+            BusEventFlags final_scl_state = event.flags & SCL_MASK;
+            second_event_of_pair = BusEvent(0, final_sda_state | final_scl_state);
+            return BusEvent(event.delta_t_in_ticks, initial_sda_state | initial_scl_state);
+        } else {
+            BusEventFlags initial_sda_state = (~event.flags) & SDA_MASK;
+            BusEventFlags initial_scl_state = event.flags & SCL_MASK;
+            BusEventFlags final_sda_state = event.flags & SDA_MASK;
+            BusEventFlags final_scl_state = event.flags & SCL_LINE_STATE;
+            second_event_of_pair = BusEvent(0, final_sda_state | final_scl_state);
+            return BusEvent(event.delta_t_in_ticks, initial_sda_state | initial_scl_state);
+        }
+    }
+    return event;
+}
+
+void MessageIterator::EventIterator::skip_time_extensions() {
+    while (next_index < trace.event_count() && trace.event(next_index)->is_time_extension()) {
+        next_index++;
+    }
+}
+
+MessageIterator::MessageIterator(const BusTrace& trace, bool merge_sda_edges, bool split_events)
+    : events(trace, split_events), merge_sda_edges(merge_sda_edges), has_previous(events.has_next()) {
+    if (has_previous) {
+        previous = events.next();
+    }
+    fetch();
+}
+
+BusEvent MessageIterator::next() {
+    BusEvent result = output;
+    fetch();
+    return result;
+}
+
+void MessageIterator::fetch() {
+    while (has_previous) {
+        if (!events.has_next()) {
+            output = previous;
+            has_previous = false;
+            has_output = true;
+            return;
+        }
+        const BusEvent next = events.next();
+        if (merge_sda_edges && sda_changed_while_scl_low(previous.flags) &&
+            sda_changed_while_scl_low(next.flags) && only_sda_changed(previous.flags, next.flags)) {
+            // The two events cancel out. Throw them away.
+            has_previous = events.has_next();
+            if (has_previous) {
+                previous = events.next();
+            }
+        } else {
+            output = previous;
+            previous = next;
+            has_output = true;
+            return;
+        }
+    }
+    has_output = false;
+}
+
+size_t MessageIterator::event_count(const BusTrace& trace, bool merge_sda_edges, bool split_events) {
+    size_t count = 0;
+    MessageIterator iter(trace, merge_sda_edges, split_events);
+    while (iter.has_next()) {
+        iter.next();
+        count++;
+    }
+    return count;
+}
+
+} // bus_trace
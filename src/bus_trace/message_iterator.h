@@ -0,0 +1,77 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_MESSAGE_ITERATOR_H
+#define I2C_UNDERNEATH_MESSAGE_ITERATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_event_flags.h"
+
+namespace bus_trace {
+
+class BusTrace;
+
+// Steps through the events of the message in a trace without making a
+// copy of it. It gives exactly the same events as BusTrace::to_message()
+// with the same options but doesn't allocate any memory. The events are
+// normalised as they're read.
+//
+// The trace must not change while the iterator is in use.
+//
+// Usage:
+//   MessageIterator iter(trace);
+//   while (iter.has_next()) {
+//       BusEvent event = iter.next();
+//   }
+class MessageIterator {
+public:
+    // See BusTrace::to_message() for the meaning of the options.
+    explicit MessageIterator(const BusTrace& trace, bool merge_sda_edges = true, bool split_events = true);
+
+    inline bool has_next() const {
+        return has_output;
+    }
+
+    // Returns the next event in the message. Must not be called
+    // unless has_next() is true.
+    BusEvent next();
+
+    // Counts the events in the message. Reads the whole trace.
+    static size_t event_count(const BusTrace& trace, bool merge_sda_edges = true, bool split_events = true);
+
+private:
+    // Splits merged events and skips time extensions.
+    class EventIterator {
+    public:
+        EventIterator(const BusTrace& trace, bool split_events);
+
+        bool has_next() const;
+
+        BusEvent next();
+
+    private:
+        const BusTrace& trace;
+        bool split_events;
+        bool get_second_of_pair_next = false;
+        BusEvent second_event_of_pair = BusEvent(0, BOTH_LOW_AND_UNCHANGED);
+        size_t next_index = 0;
+
+        void skip_time_extensions();
+    };
+
+    EventIterator events;
+    bool merge_sda_edges;
+    bool has_previous;
+    BusEvent previous = BusEvent(0, BOTH_LOW_AND_UNCHANGED);
+    bool has_output = false;
+    BusEvent output = BusEvent(0, BOTH_LOW_AND_UNCHANGED);
+
+    // Works out the event that next() will return
+    void fetch();
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_MESSAGE_ITERATOR_H
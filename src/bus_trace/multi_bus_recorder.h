@@ -0,0 +1,231 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_MULTI_BUS_RECORDER_H
+#define I2C_UNDERNEATH_MULTI_BUS_RECORDER_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+#include "recorder_statistics.h"
+#include "common/hal/clock.h"
+#include "common/hal/gpio_port.h"
+
+namespace bus_trace {
+
+// Records several I2C buses whose pins share a single GPIO interrupt.
+// e.g. 3 buses on pins 14 to 19. You can't do that with BusRecorder
+// because each recorder needs an interrupt of its own.
+//
+// The ISR reads the port once and checks each bus in turn. Each bus is
+// recorded to its own trace. All the traces start at the same tick so
+// you can compare the times of events on different buses. See
+// nanos_since_start().
+//
+// Works in the same way as BusRecorder and has the same limitations.
+// The ISR takes longer because it handles every bus. The time it takes
+// is shared by all the buses so it's best suited to Standard-mode and
+// Fast-mode buses.
+//
+// 'Port' and 'ClockType' are the concrete GpioPort and Clock classes.
+// e.g. on a Teensy 4
+//   TeensyGpioPort port(16);
+//   TeensyClock clock;
+//   MultiBusRecorder<TeensyGpioPort, TeensyClock> recorder(port, clock);
+// The ISR calls them directly so the compiler can inline the register
+// reads. They must be final classes or the calls stay virtual.
+template<typename Port, typename ClockType>
+class MultiBusRecorder {
+public:
+    static const size_t MAX_BUSES = 4;
+
+    MultiBusRecorder(Port& port, const ClockType& clock)
+        : port(port), clock(clock) {
+    }
+
+    // Adds a bus. Returns false if either pin isn't part of the port,
+    // if the pins are already in use or if there are already MAX_BUSES.
+    // Buses are numbered from 0 in the order they're added.
+    bool add_bus(uint8_t pin_sda, uint8_t pin_scl);
+
+    inline size_t bus_count() const {
+        return buses;
+    }
+
+    // Sets up the interrupt service routine (ISR). e.g.
+    // recorder.set_callback([]() { recorder.add_event(); });
+    void set_callback(void (* on_change)());
+
+    // Stops any recording that's in progress and then starts recording.
+    // 'traces' holds one trace for each bus in the order the buses were
+    // added. Events are dropped when a trace is full.
+    // Returns false if the number of traces is wrong or set_callback()
+    // hasn't been called.
+    bool start(BusTrace* const* traces, size_t trace_count);
+
+    // Stops recording
+    void stop();
+
+    inline bool is_recording() const {
+        return recording;
+    }
+
+    // The time between the start of the recording and event 'index' of
+    // 'trace'. This is comparable across all the buses. 'trace' must
+    // have been recorded by this recorder and must not be circular.
+    // It must use a clock with the same rate as the recorder's clock.
+    // Returns UINT32_MAX if 'index' is out of range or the trace doesn't
+    // have a clock. See BusTrace::nanos_between()
+    inline uint32_t nanos_since_start(const BusTrace& trace, size_t index) const {
+        return trace.nanos_between(index, 0);
+    }
+
+    // Counts the glitches, merged events and dropped events on 'bus'
+    // in the current recording or in the last one.
+    RecorderStatistics statistics(size_t bus) const;
+
+    // Adds events to the traces. DON'T call this method directly.
+    // Use set_callback() to fire it automatically when the pins
+    // detect a rising or falling edge.
+    inline void add_event() {
+        // Get the timestamp as soon as possible
+        const uint32_t tick = clock.get_system_tick();
+        const uint32_t pin_states = port.read_pins() & all_masks;
+        const uint32_t interrupt_pins = port.read_interrupt_flags() & all_masks;
+        port.clear_interrupt_flags(all_masks);
+        if (!recording) return;
+
+        for (size_t i = 0; i < buses; ++i) {
+            Bus& bus = bus_list[i];
+            if ((pin_states ^ previous_pin_states) & bus.masks) {
+                const BusEventFlags previous_line_states = bus.line_states;
+                bus.line_states = bus.to_line_states(pin_states);
+                auto changed_flags = (BusEventFlags)((bus.line_states ^ previous_line_states) << 2);
+                if (changed_flags == (SDA_LINE_CHANGED | SCL_LINE_CHANGED)) {
+                    bus.stats.merged_events++;
+                }
+                bus.record(tick, changed_flags | bus.line_states);
+            } else if (interrupt_pins & bus.masks) {
+                // A line has glitched. i.e. changed state and then changed back
+                bus.stats.glitches++;
+                const BusEventFlags glitch_lines = bus.to_line_states(interrupt_pins);
+                auto changed_flags = (BusEventFlags)(glitch_lines << 2);
+                bus.record(tick, changed_flags | (glitch_lines ^ bus.line_states));
+                bus.record(tick, changed_flags | bus.line_states);
+            }
+        }
+        previous_pin_states = pin_states;
+    }
+
+private:
+    struct Bus {
+        uint32_t sda_mask = 0;
+        uint32_t scl_mask = 0;
+        uint32_t masks = 0;
+        BusTrace* trace = nullptr;
+        uint32_t previous_tick = 0;
+        BusEventFlags line_states = BOTH_LOW_AND_UNCHANGED;
+        RecorderStatistics stats;
+
+        inline BusEventFlags to_line_states(uint32_t pin_states) const {
+            BusEventFlags sda = (pin_states & sda_mask) ? SDA_LINE_STATE : BOTH_LOW_AND_UNCHANGED;
+            BusEventFlags scl = (pin_states & scl_mask) ? SCL_LINE_STATE : BOTH_LOW_AND_UNCHANGED;
+            return sda | scl;
+        }
+
+        inline void record(uint32_t tick, BusEventFlags flags) {
+            trace->add_event_with_delta(tick - previous_tick, flags);
+            previous_tick = tick;
+        }
+    };
+
+    Port& port;
+    const ClockType& clock;
+    void (* isr)() = nullptr;
+    Bus bus_list[MAX_BUSES];
+    size_t buses = 0;
+    uint32_t all_masks = 0;
+    uint32_t previous_pin_states = 0;
+    volatile bool recording = false;
+};
+
+template<typename Port, typename ClockType>
+bool MultiBusRecorder<Port, ClockType>::add_bus(uint8_t pin_sda, uint8_t pin_scl) {
+    const uint32_t sda_mask = port.pin_mask(pin_sda);
+    const uint32_t scl_mask = port.pin_mask(pin_scl);
+    if (buses == MAX_BUSES || !sda_mask || !scl_mask || sda_mask == scl_mask
+        || ((sda_mask | scl_mask) & all_masks)) {
+        return false;
+    }
+    Bus& bus = bus_list[buses++];
+    bus.sda_mask = sda_mask;
+    bus.scl_mask = scl_mask;
+    bus.masks = sda_mask | scl_mask;
+    all_masks |= bus.masks;
+    return true;
+}
+
+template<typename Port, typename ClockType>
+void MultiBusRecorder<Port, ClockType>::set_callback(void (* on_change)()) {
+    isr = on_change;
+}
+
+template<typename Port, typename ClockType>
+bool MultiBusRecorder<Port, ClockType>::start(BusTrace* const* traces, size_t trace_count) {
+    if (!isr || trace_count != buses || buses == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < buses; ++i) {
+        if (!traces[i]) {
+            return false;
+        }
+    }
+
+    stop(); // Stop the current recording if there is one.
+
+    port.disable_interrupts();
+    previous_pin_states = port.read_pins() & all_masks;
+    // Every trace starts at the same tick
+    const uint32_t tick = clock.get_system_tick();
+    for (size_t i = 0; i < buses; ++i) {
+        Bus& bus = bus_list[i];
+        bus.trace = traces[i];
+        bus.previous_tick = tick;
+        bus.stats = RecorderStatistics();
+        bus.line_states = bus.to_line_states(previous_pin_states);
+        bus.trace->reset();
+        bus.record(tick, bus.line_states);
+    }
+    recording = true;
+    port.enable_interrupts(all_masks, isr);
+    return true;
+}
+
+template<typename Port, typename ClockType>
+void MultiBusRecorder<Port, ClockType>::stop() {
+    if (!recording) {
+        return;
+    }
+    port.disable_interrupts();
+    recording = false;
+    for (size_t i = 0; i < buses; ++i) {
+        bus_list[i].stats.dropped_events = bus_list[i].trace->dropped_event_count();
+    }
+}
+
+template<typename Port, typename ClockType>
+RecorderStatistics MultiBusRecorder<Port, ClockType>::statistics(size_t bus) const {
+    if (bus >= buses) {
+        return RecorderStatistics();
+    }
+    RecorderStatistics result = bus_list[bus].stats;
+    if (recording) {
+        result.dropped_events = bus_list[bus].trace->dropped_event_count();
+    }
+    return result;
+}
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_MULTI_BUS_RECORDER_H
@@ -0,0 +1,83 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "packed_bus_trace.h"
+
+namespace bus_trace {
+
+PackedBusTrace::PackedBusTrace(size_t max_byte_count)
+    : buffer(new uint8_t[max_byte_count]), max_byte_count(max_byte_count), created_buffer(true) {
+}
+
+PackedBusTrace::PackedBusTrace(uint8_t* buffer, size_t max_byte_count)
+    : buffer(buffer), max_byte_count(max_byte_count), created_buffer(false) {
+}
+
+PackedBusTrace::~PackedBusTrace() {
+    if (created_buffer && buffer) {
+        delete[] buffer;
+        buffer = nullptr;
+    }
+}
+
+void PackedBusTrace::reset(uint32_t current_tick_count) {
+    current_byte_count = 0;
+    current_event_count = 0;
+    dropped_events = 0;
+    delta_overflows = 0;
+    ticks_start = current_tick_count;
+    for (auto& delta : previous_deltas) {
+        delta = 0;
+    }
+}
+
+void PackedBusTrace::pack(const BusTrace& trace) {
+    for (size_t i = 0; i < trace.event_count(); ++i) {
+        add_event(*trace.event(i));
+    }
+}
+
+void PackedBusTrace::unpack(BusTrace& trace) const {
+    for (const BusEvent& event : *this) {
+        trace.add_event(event);
+    }
+}
+
+PackedBusTrace::Iterator::Iterator(const uint8_t* position, const uint8_t* end)
+    : position(position), next(position), end(end), current(0, BusEventFlags::BOTH_LOW_AND_UNCHANGED) {
+    decode();
+}
+
+PackedBusTrace::Iterator& PackedBusTrace::Iterator::operator++() {
+    position = next;
+    decode();
+    return *this;
+}
+
+void PackedBusTrace::Iterator::decode() {
+    if (position == end) {
+        return;
+    }
+    const uint8_t* in = position;
+    uint8_t header = *in++;
+    uint8_t nibble = header & LINE_FLAGS;
+    uint32_t zigzag = (header >> 4) & 0x07;
+    uint8_t shift = 3;
+    bool more = header & 0x80;
+    while (more) {
+        uint8_t b = *in++;
+        zigzag |= (uint32_t)(b & 0x7F) << shift;
+        shift += 7;
+        more = b & 0x80;
+    }
+    uint16_t delta = (uint16_t)(previous_deltas[nibble] + zigzag_decode(zigzag));
+    previous_deltas[nibble] = delta;
+    BusEventFlags flags = (BusEventFlags)nibble;
+    if (nibble == 0) {
+        flags = (BusEventFlags)*in++;
+    }
+    current = BusEvent(delta, flags);
+    next = in;
+}
+
+} // bus_trace
@@ -0,0 +1,215 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_PACKED_BUS_TRACE_H
+#define I2C_UNDERNEATH_PACKED_BUS_TRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include "bus_event.h"
+#include "bus_trace.h"
+
+namespace bus_trace {
+
+// A list of BusEvents stored in a compressed form. It holds several
+// times as many events as a BusTrace of the same size. Use it to
+// record long periods of bus activity.
+//
+// Events can only be read in order. Use begin() and end() to iterate
+// over them or copy them into a BusTrace with unpack().
+//
+// ENCODING
+// Each event starts with a header byte. The low nibble holds the line
+// flags. The high nibble holds the start of the delta and a continuation
+// bit. The rest of the delta follows as a varint with 7 bits per byte.
+//
+// I2C is clocked so the time between similar events is usually very
+// similar. Rather than storing each delta, we store the difference
+// between the delta and the delta of the last event with the same line
+// flags. This difference is usually tiny so most events take 1 or 2 bytes.
+//
+// Events with pin flags or without any line changes are very rare. We
+// store them with a 0 nibble and put the full flags in an extra byte
+// after the delta.
+class PackedBusTrace {
+public:
+    // The most bytes that a single event can take.
+    // Header + 2 bytes for the rest of the delta + flags
+    static const size_t MAX_BYTES_PER_EVENT = 4;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = BusEvent;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const BusEvent*;
+        using reference = const BusEvent&;
+
+        inline const BusEvent& operator*() const {
+            return current;
+        }
+
+        inline const BusEvent* operator->() const {
+            return &current;
+        }
+
+        Iterator& operator++();
+
+        inline bool operator==(const Iterator& other) const {
+            return position == other.position;
+        }
+
+        inline bool operator!=(const Iterator& other) const {
+            return position != other.position;
+        }
+
+    private:
+        friend class PackedBusTrace;
+
+        Iterator(const uint8_t* position, const uint8_t* end);
+
+        const uint8_t* position;
+        const uint8_t* next;
+        const uint8_t* end;
+        uint16_t previous_deltas[16] = {};
+        BusEvent current;
+
+        void decode();
+    };
+
+    // Creates a trace.
+    // max_byte_count: size of the buffer in bytes. Events take between
+    // 1 and MAX_BYTES_PER_EVENT bytes each.
+    explicit PackedBusTrace(size_t max_byte_count);
+
+    // Allows you to put the buffer wherever you want. e.g. in PSRAM.
+    // buffer: memory that will be populated by the trace
+    // max_byte_count: size of 'buffer' in bytes.
+    PackedBusTrace(uint8_t* buffer, size_t max_byte_count);
+
+    virtual ~PackedBusTrace();
+
+    PackedBusTrace(const PackedBusTrace&) = delete;
+    PackedBusTrace& operator=(const PackedBusTrace&) = delete;
+
+    // The number of events we've recorded.
+    inline size_t event_count() const {
+        return current_event_count;
+    }
+
+    // The number of bytes used to store the events.
+    inline size_t byte_count() const {
+        return current_byte_count;
+    }
+
+    // The number of events that were discarded because the trace was
+    // full since it was last reset.
+    inline size_t dropped_event_count() const {
+        return dropped_events;
+    }
+
+    // The number of stored events that needed a time extension since
+    // the trace was last reset. See BusTrace::delta_overflow_count()
+    inline size_t delta_overflow_count() const {
+        return delta_overflows;
+    }
+
+    // Removes any existing events. 'current_tick_count' is the time
+    // used to calculate the delta for the next call to
+    // add_event(uint32_t, BusEventFlags).
+    void reset(uint32_t current_tick_count = 0);
+
+    // Adds an event to the trace as long as there is space for it.
+    // The event is discarded if there are fewer than
+    // MAX_BYTES_PER_EVENT bytes left. Once an event has been discarded,
+    // every later event is discarded too until the trace is reset.
+    // This stops the trace from having gaps in the middle.
+    inline void add_event(const BusEvent& event) {
+        if (dropped_events || max_byte_count - current_byte_count < MAX_BYTES_PER_EVENT) {
+            dropped_events++;
+            return;
+        }
+        uint8_t* out = buffer + current_byte_count;
+        uint8_t nibble = event.flags & LINE_FLAGS;
+        bool long_form = (event.flags & ~LINE_FLAGS) || !(event.flags & LINE_CHANGED_FLAGS);
+        if (long_form) {
+            nibble = 0;
+        }
+        uint32_t zigzag = zigzag_encode((int32_t)event.delta_t_in_ticks - previous_deltas[nibble]);
+        previous_deltas[nibble] = event.delta_t_in_ticks;
+        *out = (uint8_t)(nibble | ((zigzag & 0x07) << 4));
+        zigzag >>= 3;
+        while (zigzag) {
+            *out++ |= 0x80;
+            *out = zigzag & 0x7F;
+            zigzag >>= 7;
+        }
+        out++;
+        if (long_form) {
+            *out++ = event.flags;
+        }
+        current_byte_count = out - buffer;
+        current_event_count++;
+    }
+
+    // Adds an event that happened at 'current_tick_count'. If the time
+    // since the previous event is too large for a BusEvent, then a time
+    // extension event is added first. See BusEvent::time_extension()
+    // Both events are dropped unless there's room for both.
+    inline void add_event(uint32_t current_tick_count, BusEventFlags flags) {
+        const uint32_t delta = current_tick_count - ticks_start;
+        ticks_start = current_tick_count;
+        if (delta > UINT16_MAX) {
+            if (dropped_events || max_byte_count - current_byte_count < 2 * MAX_BYTES_PER_EVENT) {
+                dropped_events++;
+                return;
+            }
+            delta_overflows++;
+            add_event(BusEvent::time_extension(delta, flags));
+        }
+        add_event(BusEvent((uint16_t)delta, flags));
+    }
+
+    // Adds every event in 'trace'. Events are dropped if there isn't room.
+    void pack(const BusTrace& trace);
+
+    // Adds every event in this trace to 'trace'.
+    void unpack(BusTrace& trace) const;
+
+    inline Iterator begin() const {
+        return Iterator(buffer, buffer + current_byte_count);
+    }
+
+    inline Iterator end() const {
+        const uint8_t* last = buffer + current_byte_count;
+        return Iterator(last, last);
+    }
+
+private:
+    static const uint8_t LINE_FLAGS = 0x0F;
+    static const uint8_t LINE_CHANGED_FLAGS = 0x0C;  // SDA_LINE_CHANGED | SCL_LINE_CHANGED
+
+    uint8_t* buffer;
+    const size_t max_byte_count;
+    const bool created_buffer;
+    size_t current_byte_count = 0;
+    size_t current_event_count = 0;
+    size_t dropped_events = 0;
+    size_t delta_overflows = 0;
+    uint32_t ticks_start = 0;
+    uint16_t previous_deltas[16] = {};
+
+    // Maps signed differences onto small unsigned numbers. 0, -1, 1, -2 ... => 0, 1, 2, 3 ...
+    static inline uint32_t zigzag_encode(int32_t value) {
+        return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    }
+
+    static inline int32_t zigzag_decode(uint32_t value) {
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_PACKED_BUS_TRACE_H
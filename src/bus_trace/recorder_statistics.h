@@ -0,0 +1,42 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_RECORDER_STATISTICS_H
+#define I2C_UNDERNEATH_RECORDER_STATISTICS_H
+
+#include <cstddef>
+
+namespace bus_trace {
+
+// Counts the things that stop a recording from being an exact copy
+// of the bus. Check them before you trust a trace. e.g. raise an
+// alarm if is_complete() is false.
+struct RecorderStatistics {
+    // Pulses that were too short to record as they happened. Each one
+    // is recorded as 2 events with the same timestamp.
+    size_t glitches = 0;
+
+    // Events where both lines changed before the recorder could record
+    // them separately. We can't tell which line changed first.
+    size_t merged_events = 0;
+
+    // Events that were discarded because the trace or queue was full.
+    size_t dropped_events = 0;
+
+    // Edges that the capture hardware didn't see. Only CaptureRecorder
+    // can detect these. Each one is recorded as a glitch.
+    size_t missed_edges = 0;
+
+    // Samples that were overwritten before they were decoded. Only
+    // SamplingRecorder has samples. Any edges in them are lost.
+    size_t lost_samples = 0;
+
+    // True if every event was recorded.
+    inline bool is_complete() const {
+        return dropped_events == 0 && missed_edges == 0 && lost_samples == 0;
+    }
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_RECORDER_STATISTICS_H
@@ -0,0 +1,159 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <new>
+#include "sampling_recorder.h"
+
+namespace bus_trace {
+
+#define DEFAULT_IRQ_PRIORITY 128
+#define MAX_PIT_TRIGGERED_DMA_CHANNEL 3
+
+SamplingRecorder::SamplingRecorder(uint8_t pin_sda, uint8_t pin_scl,
+                                   uint32_t* buffer, size_t buffer_size, uint32_t samples_per_second)
+    : sda_mask(getPortBitmask(pin_sda)), scl_mask(getPortBitmask(pin_scl)),
+      gpio(getSlowGPIO(pin_sda)),
+      irq(getSlowIRQ(pin_sda)), irq_scl(getSlowIRQ(pin_scl)),
+      buffer(buffer), half_size(buffer_size / 2),
+      pit_ticks_per_sample(samples_per_second ? PIT_TICKS_PER_SECOND / samples_per_second : 0) {
+    dma.begin(true);
+}
+
+SamplingRecorder::~SamplingRecorder() {
+    stop();
+}
+
+void SamplingRecorder::set_callback(void (* on_dma_interrupt)()) {
+    isr = on_dma_interrupt;
+}
+
+bool SamplingRecorder::can_start() const {
+    if (irq_scl != irq) {
+        Serial.println("ERROR: Cannot start SamplingRecorder. SDA and SCL pins are on different GPIO ports.");
+        return false;
+    }
+    if (!isr) {
+        Serial.println("ERROR: Cannot start SamplingRecorder. You must call set_callback() before start()");
+        return false;
+    }
+    if (dma.channel > MAX_PIT_TRIGGERED_DMA_CHANNEL) {
+        Serial.println("ERROR: Cannot start SamplingRecorder. Its DMA channel can't be triggered by a PIT.");
+        return false;
+    }
+    if (half_size == 0 || pit_ticks_per_sample == 0) {
+        Serial.println("ERROR: Cannot start SamplingRecorder. The buffer is too small or the sample rate is too high.");
+        return false;
+    }
+    return true;
+}
+
+bool SamplingRecorder::start(BusTrace& trace) {
+    if (!can_start()) {
+        return false;
+    }
+
+    stop(); // Stop the current recording if there is one.
+
+    // Start a new trace
+    stats = RecorderStatistics();
+    current_trace = &trace;
+    trace.reset();
+    const uint32_t cycles_per_sample = (uint32_t)((uint64_t)F_CPU_ACTUAL * pit_ticks_per_sample / PIT_TICKS_PER_SECOND);
+    decoder = new(decoder_storage) GpioSampleDecoder(trace, sda_mask, scl_mask, cycles_per_sample);
+    halves_completed = 0;
+    halves_processed = 0;
+
+    // Copy the PSR to the buffer every sample period.
+    // The DMA wraps round to the start of the buffer when it's full.
+    dma.disable();
+    dma.source(gpio->PSR);
+    dma.destinationBuffer(buffer, 2 * half_size * sizeof(uint32_t));
+    dma.interruptAtHalf();
+    dma.interruptAtCompletion();
+    dma.attachInterrupt(isr, DEFAULT_IRQ_PRIORITY);
+    start_sample_clock();
+    dma.enable();
+
+    return true;
+}
+
+void SamplingRecorder::stop() {
+    if (!current_trace) {
+        return;
+    }
+    dma.disable();
+    stop_sample_clock();
+    process();
+    // Decode the samples in the half that wasn't finished
+    const uint32_t remaining = half_size - (dma.TCD->CITER % half_size);
+    if (remaining < half_size) {
+        uint32_t* half = buffer + (halves_processed % 2) * half_size;
+        arm_dcache_delete(half, remaining * sizeof(uint32_t));
+        decoder->add_samples(half, remaining);
+    }
+    stats = statistics();
+    current_trace = nullptr;
+    decoder = nullptr;
+}
+
+size_t SamplingRecorder::process() {
+    if (!current_trace) {
+        return 0;
+    }
+    size_t decoded = 0;
+    const uint32_t completed = halves_completed;
+    if (completed - halves_processed > 1) {
+        // We fell behind and the DMA has overwritten some halves.
+        // The most recent one might be overwritten too so skip them all.
+        const uint32_t lost = completed - halves_processed;
+        decoder->skip_samples(lost * half_size);
+        stats.lost_samples += lost * half_size;
+        halves_processed = completed;
+    }
+    if (completed != halves_processed) {
+        decode_half(halves_processed % 2);
+        halves_processed++;
+        decoded = half_size;
+    }
+    return decoded;
+}
+
+RecorderStatistics SamplingRecorder::statistics() const {
+    RecorderStatistics result = stats;
+    if (current_trace) {
+        result.merged_events = decoder->merged_event_count();
+        result.dropped_events = current_trace->dropped_event_count();
+    }
+    return result;
+}
+
+void SamplingRecorder::decode_half(uint32_t half) {
+    uint32_t* samples = buffer + half * half_size;
+    // The DMA bypasses the cache
+    arm_dcache_delete(samples, half_size * sizeof(uint32_t));
+    decoder->add_samples(samples, half_size);
+}
+
+void SamplingRecorder::start_sample_clock() {
+    // The DMAMUX can trigger DMA channels 0 to 3 from PIT channels 0 to 3.
+    CCM_CCGR1 |= CCM_CCGR1_PIT(CCM_CCGR_ON);
+    PIT_MCR = 0;
+    IMXRT_PIT_CHANNEL_t* pit = IMXRT_PIT_CHANNELS + dma.channel;
+    pit->TCTRL = 0;
+    pit->LDVAL = pit_ticks_per_sample - 1;
+    pit->TFLG = 1;
+
+    volatile uint32_t* mux = &DMAMUX_CHCFG0 + dma.channel;
+    *mux = 0;
+    *mux = DMAMUX_SOURCE_ALWAYS_ON | DMAMUX_CHCFG_TRIG | DMAMUX_CHCFG_ENBL;
+    pit->TCTRL = PIT_TCTRL_TEN;
+}
+
+void SamplingRecorder::stop_sample_clock() {
+    IMXRT_PIT_CHANNEL_t* pit = IMXRT_PIT_CHANNELS + dma.channel;
+    pit->TCTRL = 0;
+    volatile uint32_t* mux = &DMAMUX_CHCFG0 + dma.channel;
+    *mux = 0;
+}
+
+} // bus_trace
@@ -0,0 +1,113 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_SAMPLING_RECORDER_H
+#define I2C_UNDERNEATH_SAMPLING_RECORDER_H
+
+#include <Arduino.h>
+#include <DMAChannel.h>
+#include <cstdint>
+#include "bus_trace.h"
+#include "gpio_sample_decoder.h"
+#include "recorder_statistics.h"
+#include "common/hal/teensy/teensy_pin.h"
+
+namespace bus_trace {
+
+// Records an I2C bus by sampling the pins at a fixed rate.
+//
+// A DMA channel copies the GPIO port's pad status register (PSR) into
+// 'buffer' every sample period. The CPU isn't involved at all until half
+// of the buffer is full. process() then extracts the edges with a
+// GpioSampleDecoder. There's no ISR for each edge, unlike BusRecorder.
+// Decoding is quickest when the bus is idle because the decoder skips
+// blocks of samples where neither line changes. The timing resolution is
+// one sample period and pulses shorter than that may be missed.
+// Run sample_decoder_benchmark on the host to see how fast the decoder is.
+//
+// The sample clock is a Periodic Interrupt Timer (PIT) channel running at
+// 24 MHz. The DMA channel must be one of channels 0 to 3 because only those
+// can be triggered by a PIT. The matching PIT channel can't be used by an
+// IntervalTimer. Create the recorder before any other DMA users to be sure
+// of getting a suitable channel. start() fails if it doesn't get one.
+//
+// SDA and SCL must be on the same GPIO port. The rules are the same as
+// BusRecorder's. See bus_recorder.h
+class SamplingRecorder {
+public:
+    // The PIT runs at this rate
+    static const uint32_t PIT_TICKS_PER_SECOND = 24'000'000;
+
+    // 'buffer' holds 'buffer_size' samples. 'buffer_size' must be even.
+    // process() must be called before half of the buffer is overwritten.
+    // 'samples_per_second' is rounded to a whole number of PIT ticks.
+    // If 'buffer' is in DMAMEM then it must be aligned to 32 bytes.
+    SamplingRecorder(uint8_t pin_sda, uint8_t pin_scl,
+                     uint32_t* buffer, size_t buffer_size, uint32_t samples_per_second);
+
+    ~SamplingRecorder();
+
+    // Sets up the DMA interrupt service routine (ISR). e.g.
+    // recorder.set_callback([]() { recorder.on_dma(); });
+    void set_callback(void (* on_dma_interrupt)());
+
+    // Stops any recording that's in progress and then starts recording
+    // to 'trace'. The deltas are in CPU cycles, like BusRecorder's.
+    // Returns false if the recorder can't start. The reason is printed
+    // to Serial.
+    bool start(BusTrace& trace);
+
+    // Decodes the rest of the samples and stops recording.
+    void stop();
+
+    inline bool is_recording() const {
+        return current_trace != nullptr;
+    }
+
+    // Decodes the samples that are ready. Call this from loop().
+    // Returns the number of samples decoded.
+    size_t process();
+
+    // Counts the merged events, dropped events and lost samples in the
+    // current recording or in the last one. Glitches can't be detected.
+    RecorderStatistics statistics() const;
+
+    // Counts completed half buffers. DON'T call this method directly.
+    // Use set_callback() to fire it automatically.
+    inline void on_dma() {
+        dma.clearInterrupt();
+        halves_completed = halves_completed + 1;
+        asm volatile ("dsb");
+    }
+
+private:
+    const uint32_t sda_mask;
+    const uint32_t scl_mask;
+    IMXRT_GPIO_t* const gpio;
+    const IRQ_NUMBER_t irq;
+    const IRQ_NUMBER_t irq_scl;
+    uint32_t* const buffer;
+    const size_t half_size;
+    const uint32_t pit_ticks_per_sample;
+    void (* isr)() = nullptr;
+
+    DMAChannel dma;
+    BusTrace* current_trace = nullptr;
+    GpioSampleDecoder* decoder = nullptr;
+    alignas(GpioSampleDecoder) uint8_t decoder_storage[sizeof(GpioSampleDecoder)];
+    volatile uint32_t halves_completed = 0;    // Written by on_dma()
+    uint32_t halves_processed = 0;
+    RecorderStatistics stats;
+
+    bool can_start() const;
+
+    void start_sample_clock();
+
+    void stop_sample_clock();
+
+    void decode_half(uint32_t half);
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_SAMPLING_RECORDER_H
@@ -0,0 +1,650 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "sigrok_session.h"
+
+#if defined(I2C_UNDERNEATH_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace bus_trace {
+
+// Converts value * numerator / denominator without overflowing
+// for any realistic clock rate and samplerate.
+static uint64_t scale(uint64_t value, uint64_t numerator, uint64_t denominator, bool round_up) {
+    uint64_t whole = value / denominator;
+    uint64_t remainder = value % denominator;
+    uint64_t rounding = round_up ? denominator - 1 : 0;
+    return whole * numerator + (remainder * numerator + rounding) / denominator;
+}
+
+LogicSampleDecoder::LogicSampleDecoder(BusTrace& trace, uint64_t samplerate,
+                                       uint8_t sda_bit, uint8_t scl_bit, uint8_t unit_size)
+        : trace(trace), samplerate(samplerate),
+          sda_byte(sda_bit / 8), sda_mask(1 << (sda_bit % 8)),
+          scl_byte(scl_bit / 8), scl_mask(1 << (scl_bit % 8)),
+          unit_size(unit_size),
+          valid(unit_size > 0 && unit_size <= MAX_UNIT_SIZE && sda_bit < unit_size * 8 && scl_bit < unit_size * 8) {
+    if (!valid) {
+        // Make sure we never index outside a sample or 'partial'.
+        sda_byte = scl_byte = 0;
+        this->unit_size = 1;
+    }
+    const common::hal::Clock* clock = trace.get_clock();
+    ticks_per_second = clock ? clock->ticks_per_second() : 0;
+}
+
+void LogicSampleDecoder::add_samples(const uint8_t* data, size_t size) {
+    if (!valid) {
+        return;
+    }
+    if (partial_size) {
+        // Checking MAX_UNIT_SIZE is redundant but it shows the
+        // compiler that 'partial' can't overflow.
+        while (partial_size < unit_size && partial_size < MAX_UNIT_SIZE && size) {
+            partial[partial_size++] = *data++;
+            size--;
+        }
+        if (partial_size < unit_size) {
+            return;
+        }
+        add_sample(partial);
+        partial_size = 0;
+    }
+    while (size >= unit_size) {
+        add_sample(data);
+        data += unit_size;
+        size -= unit_size;
+    }
+    if (size) {
+        memcpy(partial, data, size);
+        partial_size = size;
+    }
+}
+
+void LogicSampleDecoder::add_sample(const uint8_t* sample) {
+    uint8_t states = BusEventFlags::BOTH_LOW_AND_UNCHANGED;
+    if (sample[sda_byte] & sda_mask) {
+        states |= BusEventFlags::SDA_LINE_STATE;
+    }
+    if (sample[scl_byte] & scl_mask) {
+        states |= BusEventFlags::SCL_LINE_STATE;
+    }
+    if (samples == 0) {
+        trace.add_event(BusEvent(0, (BusEventFlags)states));
+    } else if (states != line_states) {
+        uint64_t tick = sample_to_tick(samples);
+        uint64_t delta = tick - last_event_tick;
+        if (delta > UINT32_MAX) {
+            // Too long for a time extension event
+            delta = UINT32_MAX;
+        }
+        // The LINE_CHANGED flags are 2 bits above the LINE_STATE flags
+        uint8_t changed = (uint8_t)((states ^ line_states) << 2);
+        trace.add_event_with_delta((uint32_t)delta, (BusEventFlags)(states | changed));
+        last_event_tick = tick;
+    }
+    line_states = states;
+    samples++;
+}
+
+uint64_t LogicSampleDecoder::sample_to_tick(uint64_t sample) const {
+    if (ticks_per_second == 0) {
+        return sample;
+    }
+    return scale(sample, ticks_per_second, samplerate, false);
+}
+
+// SESSION FILE
+// A session file is a zip archive that contains:
+//   "version"   - the format version. Always "2"
+//   "metadata"  - an INI file that describes the devices and probes
+//   "logic-1-1" - the samples. Long captures are split into
+//                 several chunks called "logic-1-2", "logic-1-3" etc.
+//
+// Only the parts of the zip format needed for session files are
+// supported. There's no support for ZIP64 so the samples must be
+// smaller than 4 GB.
+static const char* const VERSION_FILE = "version";
+static const char* const METADATA_FILE = "metadata";
+static const char* const SAMPLES_FILE = "logic-1-1";
+static const char SESSION_VERSION[] = "2";
+static const size_t MAX_NAME_LENGTH = 32;
+
+static const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+static const uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+static const uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+static const size_t LOCAL_HEADER_SIZE = 30;
+static const size_t CENTRAL_HEADER_SIZE = 46;
+static const size_t END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+static const uint16_t ZIP_VERSION = 10;         // Version 1.0. Stored files only
+static const uint16_t ZIP_DATE = (1 << 5) | 1;  // 1st January 1980. The earliest possible date
+static const uint16_t STORED = 0;
+static const uint16_t DEFLATED = 8;
+static const uint16_t ENCRYPTED = 0x0001;
+
+static void put_uint16(uint8_t* data, uint16_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+}
+
+static void put_uint32(uint8_t* data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+}
+
+static uint16_t get_uint16(const uint8_t* data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint32_t get_uint32(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// The CRC-32 used by zip files. Processes 4 bits at a time so
+// the table is only 64 bytes.
+static uint32_t update_crc(uint32_t crc, const uint8_t* data, size_t size) {
+    static const uint32_t table[16] = {
+            0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+            0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// Converts an event's line states to a sample.
+// SDA is bit 0 and SCL is bit 1.
+static inline uint8_t to_sample(BusEventFlags flags) {
+    return (uint8_t)(((flags & BusEventFlags::SDA_LINE_STATE) ? 0x01 : 0) |
+                     ((flags & BusEventFlags::SCL_LINE_STATE) ? 0x02 : 0));
+}
+
+// Calls 'run(sample, count)' for each run of identical samples in 'trace'.
+// The first sample is at the time of the first event. The last sample
+// is the first one that shows the final event.
+template<typename Run>
+static void for_each_run(const BusTrace& trace, uint64_t samplerate, uint64_t ticks_per_second, Run& run) {
+    uint8_t sample = to_sample(trace.event(0)->flags);
+    uint64_t ticks = 0;
+    uint64_t samples = 0;
+    for (size_t i = 1; i < trace.event_count(); ++i) {
+        const BusEvent* event = trace.event(i);
+        ticks += event->ticks();
+        if (event->is_time_extension()) {
+            continue;
+        }
+        // The first sample taken at or after the event
+        uint64_t next = scale(ticks, samplerate, ticks_per_second, true);
+        if (next > samples) {
+            run(sample, next - samples);
+            samples = next;
+        }
+        sample = to_sample(event->flags);
+    }
+    run(sample, 1);
+}
+
+// Counts the samples and calculates their CRC.
+class SampleCounter {
+public:
+    uint64_t count = 0;
+    uint32_t crc = 0;
+
+    void operator()(uint8_t sample, uint64_t run_length) {
+        count += run_length;
+        uint8_t samples[64];
+        memset(samples, sample, sizeof(samples));
+        while (run_length) {
+            size_t length = run_length < sizeof(samples) ? (size_t)run_length : sizeof(samples);
+            crc = update_crc(crc, samples, length);
+            run_length -= length;
+        }
+    }
+};
+
+// Writes samples to a Print in batches.
+class SampleWriter {
+public:
+    explicit SampleWriter(Print& output) : output(output) {
+    }
+
+    size_t bytes_written = 0;
+
+    void operator()(uint8_t sample, uint64_t run_length) {
+        while (run_length) {
+            size_t length = sizeof(buffer) - used;
+            if (run_length < length) {
+                length = (size_t)run_length;
+            }
+            memset(buffer + used, sample, length);
+            used += length;
+            run_length -= length;
+            if (used == sizeof(buffer)) {
+                flush();
+            }
+        }
+    }
+
+    void flush() {
+        if (used) {
+            bytes_written += output.write(buffer, used);
+            used = 0;
+        }
+    }
+
+private:
+    Print& output;
+    uint8_t buffer[256] = {};
+    size_t used = 0;
+};
+
+static uint64_t get_ticks_per_second(const BusTrace& trace) {
+    const common::hal::Clock* clock = trace.get_clock();
+    return clock ? clock->ticks_per_second() : 0;
+}
+
+size_t SigrokSession::write_samples(const BusTrace& trace, Print& output, uint64_t samplerate) {
+    uint64_t ticks_per_second = get_ticks_per_second(trace);
+    if (trace.event_count() == 0 || ticks_per_second == 0 || samplerate == 0) {
+        return 0;
+    }
+    SampleWriter writer(output);
+    for_each_run(trace, samplerate, ticks_per_second, writer);
+    writer.flush();
+    return writer.bytes_written;
+}
+
+// Describes a file in the zip archive.
+struct ZipEntry {
+    const char* name;
+    uint32_t crc;
+    uint32_t size;
+    uint32_t offset;    // Offset of the local header from the start of the archive
+};
+
+static size_t write_local_header(Print& output, const ZipEntry& entry) {
+    uint8_t header[LOCAL_HEADER_SIZE] = {};
+    size_t name_length = strlen(entry.name);
+    put_uint32(header, LOCAL_HEADER_SIGNATURE);
+    put_uint16(header + 4, ZIP_VERSION);
+    put_uint16(header + 8, STORED);
+    put_uint16(header + 12, ZIP_DATE);
+    put_uint32(header + 14, entry.crc);
+    put_uint32(header + 18, entry.size);
+    put_uint32(header + 22, entry.size);
+    put_uint16(header + 26, (uint16_t)name_length);
+    size_t count = output.write(header, sizeof(header));
+    return count + output.write((const uint8_t*)entry.name, name_length);
+}
+
+static size_t write_central_header(Print& output, const ZipEntry& entry) {
+    uint8_t header[CENTRAL_HEADER_SIZE] = {};
+    size_t name_length = strlen(entry.name);
+    put_uint32(header, CENTRAL_HEADER_SIGNATURE);
+    put_uint16(header + 4, ZIP_VERSION);
+    put_uint16(header + 6, ZIP_VERSION);
+    put_uint16(header + 10, STORED);
+    put_uint16(header + 14, ZIP_DATE);
+    put_uint32(header + 16, entry.crc);
+    put_uint32(header + 20, entry.size);
+    put_uint32(header + 24, entry.size);
+    put_uint16(header + 28, (uint16_t)name_length);
+    put_uint32(header + 42, entry.offset);
+    size_t count = output.write(header, sizeof(header));
+    return count + output.write((const uint8_t*)entry.name, name_length);
+}
+
+static size_t write_end_of_central_directory(Print& output, uint16_t entries, uint32_t size, uint32_t offset) {
+    uint8_t record[END_OF_CENTRAL_DIRECTORY_SIZE] = {};
+    put_uint32(record, END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+    put_uint16(record + 8, entries);
+    put_uint16(record + 10, entries);
+    put_uint32(record + 12, size);
+    put_uint32(record + 16, offset);
+    return output.write(record, sizeof(record));
+}
+
+// Formats a samplerate the way sigrok does. e.g. "400 kHz"
+static void format_samplerate(char* text, size_t size, uint64_t samplerate) {
+    if (samplerate % 1'000'000'000 == 0) {
+        snprintf(text, size, "%llu GHz", (unsigned long long)(samplerate / 1'000'000'000));
+    } else if (samplerate % 1'000'000 == 0) {
+        snprintf(text, size, "%llu MHz", (unsigned long long)(samplerate / 1'000'000));
+    } else if (samplerate % 1'000 == 0) {
+        snprintf(text, size, "%llu kHz", (unsigned long long)(samplerate / 1'000));
+    } else {
+        snprintf(text, size, "%llu Hz", (unsigned long long)samplerate);
+    }
+}
+
+size_t SigrokSession::write(const BusTrace& trace, Print& output, uint64_t samplerate) {
+    uint64_t ticks_per_second = get_ticks_per_second(trace);
+    if (trace.event_count() == 0 || ticks_per_second == 0 || samplerate == 0) {
+        return 0;
+    }
+    // The headers come before the samples so we have to
+    // generate the samples twice. Once to get the size and CRC
+    // and once to write them.
+    SampleCounter counter;
+    for_each_run(trace, samplerate, ticks_per_second, counter);
+    if (counter.count > UINT32_MAX - 1024) {
+        return 0;
+    }
+
+    char rate[24];
+    format_samplerate(rate, sizeof(rate), samplerate);
+    char metadata[256];
+    int metadata_length = snprintf(metadata, sizeof(metadata),
+            "[global]\n"
+            "sigrok version=0.5.2\n"
+            "\n"
+            "[device 1]\n"
+            "capturefile=logic-1\n"
+            "total probes=2\n"
+            "samplerate=%s\n"
+            "total analog=0\n"
+            "probe%d=SDA\n"
+            "probe%d=SCL\n"
+            "unitsize=1\n",
+            rate, SDA_PROBE, SCL_PROBE);
+
+    ZipEntry entries[3] = {
+            {VERSION_FILE, update_crc(0, (const uint8_t*)SESSION_VERSION, strlen(SESSION_VERSION)), (uint32_t)strlen(SESSION_VERSION), 0},
+            {METADATA_FILE, update_crc(0, (const uint8_t*)metadata, metadata_length), (uint32_t)metadata_length, 0},
+            {SAMPLES_FILE, counter.crc, (uint32_t)counter.count, 0}
+    };
+    size_t count = 0;
+    entries[0].offset = count;
+    count += write_local_header(output, entries[0]);
+    count += output.write((const uint8_t*)SESSION_VERSION, entries[0].size);
+    entries[1].offset = count;
+    count += write_local_header(output, entries[1]);
+    count += output.write((const uint8_t*)metadata, entries[1].size);
+    entries[2].offset = count;
+    count += write_local_header(output, entries[2]);
+    count += write_samples(trace, output, samplerate);
+
+    size_t directory_offset = count;
+    for (const ZipEntry& entry : entries) {
+        count += write_central_header(output, entry);
+    }
+    count += write_end_of_central_directory(output, 3, count - directory_offset, directory_offset);
+    return count;
+}
+
+// A file found in a zip archive.
+struct ZipFile {
+    const uint8_t* data;
+    uint32_t compressed_size;
+    uint32_t size;
+    uint32_t crc;
+    uint16_t method;
+};
+
+// Finds the file called 'name' in the archive.
+static bool find_file(const uint8_t* zip, size_t zip_size, const char* name, ZipFile& file) {
+    if (zip_size < END_OF_CENTRAL_DIRECTORY_SIZE) {
+        return false;
+    }
+    // The end record is followed by a comment of up to 64 kB.
+    // Search backwards for its signature.
+    size_t end = zip_size - END_OF_CENTRAL_DIRECTORY_SIZE;
+    size_t earliest = end > UINT16_MAX ? end - UINT16_MAX : 0;
+    while (get_uint32(zip + end) != END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+        if (end == earliest) {
+            return false;
+        }
+        end--;
+    }
+    uint16_t entries = get_uint16(zip + end + 10);
+    size_t offset = get_uint32(zip + end + 16);
+    size_t name_length = strlen(name);
+    for (uint16_t i = 0; i < entries; ++i) {
+        if (offset + CENTRAL_HEADER_SIZE > end || get_uint32(zip + offset) != CENTRAL_HEADER_SIGNATURE) {
+            return false;
+        }
+        const uint8_t* header = zip + offset;
+        size_t entry_name_length = get_uint16(header + 28);
+        size_t next = offset + CENTRAL_HEADER_SIZE + entry_name_length + get_uint16(header + 30) + get_uint16(header + 32);
+        if (next > end) {
+            return false;
+        }
+        if (entry_name_length == name_length && memcmp(header + CENTRAL_HEADER_SIZE, name, name_length) == 0) {
+            if (get_uint16(header + 8) & ENCRYPTED) {
+                return false;
+            }
+            size_t local = get_uint32(header + 42);
+            if (local + LOCAL_HEADER_SIZE > zip_size || get_uint32(zip + local) != LOCAL_HEADER_SIGNATURE) {
+                return false;
+            }
+            size_t data = local + LOCAL_HEADER_SIZE + get_uint16(zip + local + 26) + get_uint16(zip + local + 28);
+            file.method = get_uint16(header + 10);
+            file.crc = get_uint32(header + 16);
+            file.compressed_size = get_uint32(header + 20);
+            file.size = get_uint32(header + 24);
+            if (data > zip_size || zip_size - data < file.compressed_size) {
+                return false;
+            }
+            file.data = zip + data;
+            return true;
+        }
+        offset = next;
+    }
+    return false;
+}
+
+// Passes the contents of 'file' to 'sink(data, size)' in chunks.
+// Returns false if the file is corrupt or can't be decompressed.
+template<typename Sink>
+static bool extract(const ZipFile& file, Sink& sink) {
+    if (file.method == STORED) {
+        if (file.compressed_size != file.size || update_crc(0, file.data, file.size) != file.crc) {
+            return false;
+        }
+        sink(file.data, file.size);
+        return true;
+    }
+#if defined(I2C_UNDERNEATH_HAVE_ZLIB)
+    if (file.method == DEFLATED) {
+        z_stream stream = {};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            return false;
+        }
+        stream.next_in = (Bytef*)file.data;
+        stream.avail_in = file.compressed_size;
+        uint8_t buffer[4096];
+        uint32_t crc = 0;
+        int result = Z_OK;
+        while (result == Z_OK) {
+            stream.next_out = buffer;
+            stream.avail_out = sizeof(buffer);
+            result = inflate(&stream, Z_NO_FLUSH);
+            size_t length = sizeof(buffer) - stream.avail_out;
+            crc = update_crc(crc, buffer, length);
+            sink(buffer, length);
+        }
+        inflateEnd(&stream);
+        return result == Z_STREAM_END && stream.total_out == file.size && crc == file.crc;
+    }
+#else
+    (void)DEFLATED;
+#endif
+    return false;
+}
+
+static bool equals_ignoring_case(const char* a, const char* b) {
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) {
+            return false;
+        }
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Parses a samplerate such as "1 MHz", "1.5 MHz" or "400000".
+static uint64_t parse_samplerate(const char* text) {
+    uint64_t whole = 0;
+    while (isdigit((unsigned char)*text)) {
+        whole = whole * 10 + (*text++ - '0');
+    }
+    uint64_t fraction = 0;
+    uint64_t fraction_scale = 1;
+    if (*text == '.') {
+        text++;
+        while (isdigit((unsigned char)*text)) {
+            if (fraction_scale < 1'000'000'000) {
+                fraction = fraction * 10 + (*text - '0');
+                fraction_scale *= 10;
+            }
+            text++;
+        }
+    }
+    while (*text == ' ') {
+        text++;
+    }
+    uint64_t multiplier = 1;
+    switch (*text) {
+        case 'k': case 'K': multiplier = 1'000; break;
+        case 'm': case 'M': multiplier = 1'000'000; break;
+        case 'g': case 'G': multiplier = 1'000'000'000; break;
+        default: break;
+    }
+    return whole * multiplier + fraction * multiplier / fraction_scale;
+}
+
+// Parses the metadata file a line at a time. Only reads the first device.
+class MetadataParser {
+public:
+    MetadataParser(const char* sda_name, const char* scl_name)
+            : sda_name(sda_name), scl_name(scl_name) {
+    }
+
+    char capture_file[MAX_NAME_LENGTH] = {};
+    SigrokSessionInfo info;
+
+    void operator()(const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            char c = (char)data[i];
+            if (c == '\n') {
+                end_line();
+            } else if (c != '\r' && line_length < sizeof(line) - 1) {
+                line[line_length++] = c;
+            }
+        }
+    }
+
+    void end_line() {
+        line[line_length] = 0;
+        line_length = 0;
+        if (line[0] == '[') {
+            in_first_device = strcmp(line, "[device 1]") == 0;
+            return;
+        }
+        char* equals = strchr(line, '=');
+        if (!in_first_device || !equals) {
+            return;
+        }
+        *equals = 0;
+        const char* key = line;
+        const char* value = equals + 1;
+        if (strcmp(key, "capturefile") == 0) {
+            strncpy(capture_file, value, sizeof(capture_file) - 1);
+        } else if (strcmp(key, "samplerate") == 0) {
+            info.samplerate = parse_samplerate(value);
+        } else if (strcmp(key, "total probes") == 0) {
+            info.total_probes = (uint8_t)atoi(value);
+        } else if (strcmp(key, "unitsize") == 0) {
+            info.unit_size = (uint8_t)atoi(value);
+        } else if (strncmp(key, "probe", 5) == 0 && isdigit((unsigned char)key[5])) {
+            uint8_t probe = (uint8_t)atoi(key + 5);
+            if (equals_ignoring_case(value, sda_name)) {
+                info.sda_probe = probe;
+            } else if (equals_ignoring_case(value, scl_name)) {
+                info.scl_probe = probe;
+            }
+        }
+    }
+
+private:
+    const char* sda_name;
+    const char* scl_name;
+    char line[128] = {};
+    size_t line_length = 0;
+    bool in_first_device = false;
+};
+
+static bool is_valid(const SigrokSessionInfo& info) {
+    if (info.samplerate == 0 || info.unit_size == 0 || info.unit_size > LogicSampleDecoder::MAX_UNIT_SIZE) {
+        return false;
+    }
+    const size_t max_probe = info.unit_size * 8;
+    return info.sda_probe > 0 && info.sda_probe <= max_probe &&
+           info.scl_probe > 0 && info.scl_probe <= max_probe;
+}
+
+bool SigrokSession::read(const uint8_t* data, size_t size, BusTrace& trace,
+                         SigrokSessionInfo* info, const char* sda_name, const char* scl_name) {
+    ZipFile file = {};
+    char version = 0;
+    auto read_version = [&version](const uint8_t* text, size_t length) {
+        if (length && !version) {
+            version = (char)text[0];
+        }
+    };
+    if (!find_file(data, size, VERSION_FILE, file) || !extract(file, read_version) ||
+        version != SESSION_VERSION[0]) {
+        return false;
+    }
+    MetadataParser metadata(sda_name, scl_name);
+    if (!find_file(data, size, METADATA_FILE, file) || !extract(file, metadata)) {
+        return false;
+    }
+    metadata.end_line();
+    if (!is_valid(metadata.info)) {
+        return false;
+    }
+
+    // Probes are numbered from 1
+    LogicSampleDecoder decoder(trace, metadata.info.samplerate,
+                               metadata.info.sda_probe - 1, metadata.info.scl_probe - 1,
+                               metadata.info.unit_size);
+    auto add_samples = [&decoder](const uint8_t* samples, size_t length) {
+        decoder.add_samples(samples, length);
+    };
+    // The samples are split into chunks. e.g. "logic-1-1", "logic-1-2" ...
+    char name[MAX_NAME_LENGTH + 12];
+    bool found = false;
+    for (uint32_t chunk = 1;; chunk++) {
+        snprintf(name, sizeof(name), "%s-%lu", metadata.capture_file, (unsigned long)chunk);
+        if (!find_file(data, size, name, file)) {
+            break;
+        }
+        if (!extract(file, add_samples)) {
+            return false;
+        }
+        found = true;
+    }
+    if (!found) {
+        return false;
+    }
+    if (info) {
+        *info = metadata.info;
+        info->sample_count = decoder.sample_count();
+    }
+    return true;
+}
+
+} // bus_trace
@@ -0,0 +1,127 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_SIGROK_SESSION_H
+#define I2C_UNDERNEATH_SIGROK_SESSION_H
+
+#include <Arduino.h>
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+
+namespace bus_trace {
+
+// Converts logic analyser samples to BusEvents.
+//
+// Each sample is 'unit_size' bytes long. Bit n of a sample is bit (n % 8)
+// of byte (n / 8). This is the layout used by sigrok. An event is added to
+// the trace whenever SDA or SCL changes. The first sample adds an event
+// with a delta of 0 that gives the initial state of the lines.
+//
+// The event times are converted to ticks of the trace's clock. If the
+// trace doesn't have a clock then each sample is one tick.
+//
+// Samples can be added in chunks of any size. A chunk doesn't have to
+// end on a sample boundary.
+class LogicSampleDecoder {
+public:
+    static const uint8_t MAX_UNIT_SIZE = 8;
+
+    // 'sda_bit' and 'scl_bit' must be less than 8 * 'unit_size'.
+    // 'unit_size' must be between 1 and MAX_UNIT_SIZE.
+    // The decoder ignores all samples if they aren't. See is_valid()
+    LogicSampleDecoder(BusTrace& trace, uint64_t samplerate,
+                       uint8_t sda_bit = 0, uint8_t scl_bit = 1, uint8_t unit_size = 1);
+
+    // False if the constructor's arguments were out of range.
+    inline bool is_valid() const {
+        return valid;
+    }
+
+    // Adds 'size' bytes of samples.
+    void add_samples(const uint8_t* data, size_t size);
+
+    // The number of whole samples added so far.
+    inline uint64_t sample_count() const {
+        return samples;
+    }
+
+private:
+    BusTrace& trace;
+    uint64_t samplerate;
+    uint64_t ticks_per_second;  // 0 if each sample is one tick
+    uint8_t sda_byte;
+    uint8_t sda_mask;
+    uint8_t scl_byte;
+    uint8_t scl_mask;
+    uint8_t unit_size;
+    bool valid;
+    uint8_t partial[MAX_UNIT_SIZE] = {};    // Holds a sample that was split between 2 chunks
+    uint8_t partial_size = 0;
+    uint64_t samples = 0;
+    uint64_t last_event_tick = 0;
+    uint8_t line_states = 0;
+
+    void add_sample(const uint8_t* sample);
+    uint64_t sample_to_tick(uint64_t sample) const;
+};
+
+// Describes a sigrok session file.
+struct SigrokSessionInfo {
+    uint64_t samplerate = 0;    // Samples per second
+    uint64_t sample_count = 0;
+    uint8_t total_probes = 0;
+    uint8_t unit_size = 0;      // Bytes per sample
+    uint8_t sda_probe = 0;      // Probe numbers start at 1
+    uint8_t scl_probe = 0;
+};
+
+// Writes BusTraces as sigrok session files (*.sr) and reads them back
+// again. These are the native files of sigrok-cli and PulseView. This
+// lets you run sigrok's I2C decoder over the same capture as
+// BusTraceDecoder and I2CTimingAnalyser, and lets you analyse existing
+// sigrok captures with the host build.
+//
+// A session file is a zip archive that holds some metadata and the raw
+// logic samples. The trace is converted to samples at the chosen
+// samplerate. Edges that are closer together than the sample period
+// are merged into one sample. Glitches shorter than the sample period
+// disappear.
+//
+// The writer streams the samples without allocating any memory. It
+// stores them without compression so it can run on a Teensy. PulseView
+// compresses the files it saves. The reader can only decompress those
+// files if the host build found zlib. Otherwise it's limited to
+// uncompressed files like the ones written by this class.
+class SigrokSession {
+public:
+    // The probe numbers used by write(). They're numbered from 1 so
+    // SDA is bit 0 of each sample and SCL is bit 1.
+    static const uint8_t SDA_PROBE = 1;
+    static const uint8_t SCL_PROBE = 2;
+
+    // Writes 'trace' to 'output' as a session file with one sample
+    // per byte. The trace must have a clock.
+    // Returns the number of bytes written or 0 if the trace can't be
+    // converted. e.g. it's empty or has more than 4 GB of samples.
+    static size_t write(const BusTrace& trace, Print& output, uint64_t samplerate);
+
+    // As write() but only writes the raw samples. This is the format
+    // that sigrok-cli reads with "-I binary".
+    static size_t write_samples(const BusTrace& trace, Print& output, uint64_t samplerate);
+
+    // Adds the events from a session file to 'trace'. 'data' holds the
+    // whole file. The bus lines are found by their probe names. Only the
+    // first device in the session is read.
+    // Copies the session details to 'info' if it's not nullptr.
+    // Returns false if the file is invalid, if it doesn't have both
+    // probes or if it's compressed and zlib isn't available.
+    static bool read(const uint8_t* data, size_t size, BusTrace& trace,
+                     SigrokSessionInfo* info = nullptr,
+                     const char* sda_name = "SDA", const char* scl_name = "SCL");
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_SIGROK_SESSION_H
@@ -0,0 +1,35 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "triggered_trace.h"
+
+namespace bus_trace {
+
+TriggeredTrace::TriggeredTrace(BusTrace& trace, BusTrigger& trigger, size_t post_trigger_events,
+                               CaptureCompleteCallback on_complete)
+    : trace(trace), trigger(trigger), post_trigger_events(post_trigger_events), on_complete(on_complete) {
+}
+
+void TriggeredTrace::reset(uint32_t current_tick_count) {
+    ticks_start = current_tick_count;
+    rearm();
+}
+
+void TriggeredTrace::rearm() {
+    trace.reset();
+    trace.set_circular(true);
+    trigger.reset();
+    slots_at_trigger = 0;
+    events_after_trigger = 0;
+    triggered = false;
+    complete = false;
+}
+
+size_t TriggeredTrace::trigger_index() const {
+    if (!triggered || trace.overwritten_event_count() >= slots_at_trigger) {
+        return SIZE_MAX;
+    }
+    return (slots_at_trigger - 1) - trace.overwritten_event_count();
+}
+
+} // bus_trace
@@ -0,0 +1,114 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_TRIGGERED_TRACE_H
+#define I2C_UNDERNEATH_TRIGGERED_TRACE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+#include "bus_trigger.h"
+
+namespace bus_trace {
+
+// Records the events around a trigger. Like a logic analyser, it keeps
+// a window of events before the trigger and a fixed number of events
+// after it. This lets you leave a recorder running until something
+// interesting happens without filling the trace with events you don't
+// care about.
+//
+// Until the trigger fires the trace is circular so it always holds the
+// most recent events. Once the trigger fires, 'post_trigger_events'
+// more events are recorded and the capture is complete. Later events
+// are ignored until rearm() is called. The pre-trigger depth is whatever
+// space is left. i.e. trace.capacity() - post_trigger_events - 1 events,
+// less one for each time extension that's needed after the trigger.
+// The trace's capacity must be at least 2 * post_trigger_events + 2 or
+// long gaps after the trigger may overwrite the trigger event.
+//
+// add_event() is called by the BusRecorder's interrupt service routine.
+// Check is_complete() from loop() and read the trace once it's true.
+class TriggeredTrace {
+public:
+    // Called when the capture is complete. WARNING: this is called from
+    // the recorder's interrupt service routine. Keep it short.
+    typedef void (* CaptureCompleteCallback)(TriggeredTrace& capture);
+
+    // 'on_complete' may be nullptr if you'd rather poll is_complete().
+    TriggeredTrace(BusTrace& trace, BusTrigger& trigger, size_t post_trigger_events,
+                   CaptureCompleteCallback on_complete = nullptr);
+
+    TriggeredTrace(const TriggeredTrace&) = delete;
+    TriggeredTrace& operator=(const TriggeredTrace&) = delete;
+
+    // Empties the trace, resets the trigger and arms it. Sets the time
+    // of the previous event to 'current_tick_count'.
+    // NOT safe to call while recording.
+    void reset(uint32_t current_tick_count = 0);
+
+    // Starts another capture, keeping the time of the previous event.
+    // NOT safe to call while recording.
+    void rearm();
+
+    inline BusTrace& get_trace() const {
+        return trace;
+    }
+
+    // True if the trigger has fired since the last reset.
+    inline bool is_triggered() const {
+        return triggered;
+    }
+
+    // True once all the post trigger events have been recorded.
+    inline bool is_complete() const {
+        return complete;
+    }
+
+    // The index in the trace of the event that fired the trigger.
+    // Returns SIZE_MAX if the trigger hasn't fired or the event has
+    // been overwritten.
+    size_t trigger_index() const;
+
+    // Adds an event that happened at 'current_tick_count' and checks
+    // the trigger. Does nothing if the capture is complete.
+    inline void add_event(uint32_t current_tick_count, BusEventFlags flags) {
+        uint32_t delta = current_tick_count - ticks_start;
+        ticks_start = current_tick_count;
+        if (complete) {
+            return;
+        }
+        trace.add_event_with_delta(delta, flags);
+        if (!triggered) {
+            if (!trigger.add_event(delta, flags)) {
+                return;
+            }
+            triggered = true;
+            slots_at_trigger = trace.event_count() + trace.overwritten_event_count();
+        } else {
+            // Don't count time extensions.
+            events_after_trigger++;
+        }
+        if (events_after_trigger >= post_trigger_events) {
+            complete = true;
+            if (on_complete) {
+                on_complete(*this);
+            }
+        }
+    }
+
+private:
+    BusTrace& trace;
+    BusTrigger& trigger;
+    const size_t post_trigger_events;
+    const CaptureCompleteCallback on_complete;
+    uint32_t ticks_start = 0;
+    size_t slots_at_trigger = 0;    // Events and time extensions added up to and including the trigger event
+    size_t events_after_trigger = 0;
+    volatile bool triggered = false;
+    volatile bool complete = false;
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_TRIGGERED_TRACE_H
@@ -0,0 +1,152 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "vcd_writer.h"
+
+namespace bus_trace {
+
+// VCD identifiers for the signals
+static const char SDA_ID = '!';
+static const char SCL_ID = '"';
+
+VcdWriter::VcdWriter(Print& output, const common::hal::Clock* clock)
+    : output(output), clock(clock), max_ticks_before_rebase(rebase_limit(clock)) {
+}
+
+size_t VcdWriter::write(const BusTrace& trace, Print& output) {
+    VcdWriter writer(output, trace.get_clock());
+    writer.write_header();
+    for (size_t i = 0; i < trace.event_count(); ++i) {
+        writer.add_event(*trace.event(i));
+    }
+    writer.flush();
+    return writer.bytes_written();
+}
+
+void VcdWriter::write_header() {
+    append("$version i2c-underneath BusTrace $end\n");
+    if (!clock) {
+        append("$comment Times are in clock ticks not nanoseconds $end\n");
+    }
+    append("$timescale 1ns $end\n");
+    append("$scope module i2c $end\n");
+    append("$var wire 1 ! SDA $end\n");
+    append("$var wire 1 \" SCL $end\n");
+    append("$upscope $end\n");
+    append("$enddefinitions $end\n");
+}
+
+void VcdWriter::add_event(const BusEvent& event) {
+    const bool sda = event.flags & BusEventFlags::SDA_LINE_STATE;
+    const bool scl = event.flags & BusEventFlags::SCL_LINE_STATE;
+    if (first_event) {
+        // The first event gives the initial state of the bus.
+        // Its delta is meaningless.
+        first_event = false;
+        append("#0\n$dumpvars\n");
+        append(sda ? '1' : '0');
+        append(SDA_ID);
+        append('\n');
+        append(scl ? '1' : '0');
+        append(SCL_ID);
+        append("\n$end\n");
+        sda_high = sda;
+        scl_high = scl;
+        return;
+    }
+    add_ticks(event.ticks());
+    if (event.is_time_extension()) {
+        // Nothing happened. Add the time to the next event.
+        return;
+    }
+    if (sda == sda_high && scl == scl_high) {
+        return;
+    }
+    uint64_t now = current_time();
+    if (now != last_time) {
+        append('#');
+        append_number(now);
+        append('\n');
+        last_time = now;
+    }
+    if (sda != sda_high) {
+        append(sda ? '1' : '0');
+        append(SDA_ID);
+        append('\n');
+        sda_high = sda;
+    }
+    if (scl != scl_high) {
+        append(scl ? '1' : '0');
+        append(SCL_ID);
+        append('\n');
+        scl_high = scl;
+    }
+}
+
+void VcdWriter::flush() {
+    if (used) {
+        bytes_written_ += output.write((const uint8_t*)buffer, used);
+        used = 0;
+    }
+}
+
+uint32_t VcdWriter::rebase_limit(const common::hal::Clock* clock) {
+    const uint32_t rate = clock ? clock->ticks_per_second() : 0;
+    if (rate == 0) {
+        return MAX_TICKS_BEFORE_REBASE;
+    }
+    // Leave plenty of headroom for rounding in ticks_to_nanos()
+    uint64_t limit = (uint64_t)(UINT32_MAX / 2) * rate / 1'000'000'000;
+    if (limit == 0) {
+        return 1;
+    }
+    return limit < MAX_TICKS_BEFORE_REBASE ? (uint32_t)limit : MAX_TICKS_BEFORE_REBASE;
+}
+
+void VcdWriter::add_ticks(uint32_t ticks) {
+    // Clock::ticks_to_nanos() returns a uint32_t so we move the base
+    // point forward before ticks_since_base gets too large.
+    while (ticks) {
+        if (ticks_since_base == max_ticks_before_rebase) {
+            base_time = current_time();
+            ticks_since_base = 0;
+        }
+        uint32_t chunk = min(ticks, max_ticks_before_rebase - ticks_since_base);
+        ticks_since_base += chunk;
+        ticks -= chunk;
+    }
+}
+
+uint64_t VcdWriter::current_time() const {
+    if (clock) {
+        return base_time + clock->ticks_to_nanos(ticks_since_base);
+    }
+    return base_time + ticks_since_base;
+}
+
+void VcdWriter::append(const char* text) {
+    while (*text) {
+        append(*text++);
+    }
+}
+
+void VcdWriter::append(char c) {
+    if (used == sizeof(buffer)) {
+        flush();
+    }
+    buffer[used++] = c;
+}
+
+void VcdWriter::append_number(uint64_t value) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (count) {
+        append(digits[--count]);
+    }
+}
+
+} // bus_trace
@@ -0,0 +1,88 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_VCD_WRITER_H
+#define I2C_UNDERNEATH_VCD_WRITER_H
+
+#include <Arduino.h>
+#include <cstdint>
+#include <cstddef>
+#include "bus_event.h"
+#include "bus_trace.h"
+#include "common/hal/clock.h"
+
+namespace bus_trace {
+
+// Writes bus events as a Value Change Dump (VCD) file. VCD files can
+// be viewed with waveform viewers such as GTKWave or PulseView.
+//
+// The file contains 2 signals, SDA and SCL, with a timescale of 1 ns.
+// The writer only holds one small buffer, so it can write a trace of
+// any size and can be fed events as they're recorded. e.g. from a
+// BusEventQueue.
+//
+// Usage:
+//   VcdWriter writer(file, trace.get_clock());
+//   writer.write_header();
+//   for (each event) writer.add_event(event);
+//   writer.flush();
+// or just call VcdWriter::write(trace, file);
+class VcdWriter {
+public:
+    // 'clock' converts the event deltas to nanoseconds. It must be the
+    // clock that was used to record the events. If 'clock' is nullptr
+    // then the times in the file are in ticks rather than nanoseconds.
+    VcdWriter(Print& output, const common::hal::Clock* clock);
+
+    // Writes the whole of 'trace' to 'output'.
+    // Returns the number of bytes written.
+    static size_t write(const BusTrace& trace, Print& output);
+
+    // Writes the VCD header. Call this before adding any events.
+    void write_header();
+
+    // Writes the next event. The first event gives the initial state
+    // of the bus at time 0.
+    void add_event(const BusEvent& event);
+
+    // Writes any buffered output. Call this when you've finished.
+    void flush();
+
+    // The number of bytes passed to 'output' so far.
+    inline size_t bytes_written() const {
+        return bytes_written_;
+    }
+
+private:
+    // The most ticks we convert at once. Slow clocks use less so
+    // that ticks_to_nanos() doesn't overflow.
+    static const uint32_t MAX_TICKS_BEFORE_REBASE = 1U << 24;
+
+    Print& output;
+    const common::hal::Clock* clock;
+    const uint32_t max_ticks_before_rebase;
+    char buffer[128];
+    size_t used = 0;
+    size_t bytes_written_ = 0;
+
+    bool first_event = true;
+    bool sda_high = false;
+    bool scl_high = false;
+    uint64_t last_time = 0;     // Time of the last timestamp written to the file
+    // The current time is base_time + ticks_since_base converted to nanos.
+    // We convert the ticks since a base point, rather than each delta, so
+    // rounding errors don't accumulate.
+    uint64_t base_time = 0;
+    uint32_t ticks_since_base = 0;
+
+    static uint32_t rebase_limit(const common::hal::Clock* clock);
+    void add_ticks(uint32_t ticks);
+    uint64_t current_time() const;
+    void append(const char* text);
+    void append(char c);
+    void append_number(uint64_t value);
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_VCD_WRITER_H
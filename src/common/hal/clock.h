@@ -23,6 +23,9 @@ public:
     virtual uint32_t nanos_between(uint32_t ticks_start, uint32_t ticks_end) const = 0;
 
     virtual uint32_t nanos_since(uint32_t& ticks_start) const = 0;
+
+    // The clock rate. Returns 0 if the rate isn't known.
+    virtual uint32_t ticks_per_second() const = 0;
 };
 
 }
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_COMMON_HAL_EDGE_CAPTURE_H
+#define I2C_UNDERNEATH_COMMON_HAL_EDGE_CAPTURE_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace common {
+namespace hal {
+
+// A free running counter with an input capture channel for each I2C line.
+// The hardware latches the counter whenever a line changes state. The
+// edges are buffered until they're read. This means the time of each
+// edge doesn't depend on how long it takes to handle an interrupt.
+//
+// The counter may be narrower than 32 bits. counter_mask() gives the
+// largest value it can hold before it wraps round to 0.
+//
+// Different concrete implementations of this class support different
+// platforms. The host build uses a simulated implementation for testing.
+class EdgeCapture {
+public:
+    static const uint8_t SDA = 0;
+    static const uint8_t SCL = 1;
+
+    // A captured edge
+    struct Edge {
+        uint32_t count; // Value of the counter when the edge happened
+        uint8_t line;   // SDA or SCL
+        bool high;      // State of the line after the edge
+    };
+
+    // Stops capturing and frees any hardware resources
+    virtual ~EdgeCapture() = default;
+
+    // The largest value the counter can hold. e.g. 0xFFFF for a 16 bit counter.
+    virtual uint32_t counter_mask() const = 0;
+
+    // The number of times the counter increments each second.
+    virtual uint32_t ticks_per_second() const = 0;
+
+    // Discards any buffered edges and starts capturing.
+    virtual void start() = 0;
+
+    // Stops capturing. Edges that have already been captured can still be read.
+    virtual void stop() = 0;
+
+    // The current value of the counter
+    virtual uint32_t read_counter() const = 0;
+
+    // The current state of a line. True if it's HIGH.
+    virtual bool read_line(uint8_t line) const = 0;
+
+    // Removes up to 'max_edges' edges from the buffer and copies them
+    // to 'edges', oldest first. Returns the number of edges copied.
+    virtual size_t read_edges(Edge* edges, size_t max_edges) = 0;
+};
+
+}
+}
+#endif //I2C_UNDERNEATH_COMMON_HAL_EDGE_CAPTURE_H
@@ -0,0 +1,55 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#pragma once
+#include <cstdint>
+#include <common/hal/clock.h>
+
+namespace common {
+namespace hal {
+
+// Converts ticks to nanoseconds at a fixed rate. It doesn't tell
+// the time so get_system_tick() always returns 0.
+// Use it to analyse traces on a different system to the one that
+// recorded them. e.g. with the host build.
+class FixedRateClock : public Clock {
+public:
+    explicit FixedRateClock(uint32_t ticks_per_second)
+        : rate(ticks_per_second) {
+    }
+
+    inline uint32_t get_system_tick() const override {
+        return 0;
+    }
+
+    inline uint32_t get_system_mills() const override {
+        return 0;
+    }
+
+    uint32_t ticks_to_nanos(uint32_t ticks) const override {
+        if (rate == 0) {
+            return 0;
+        }
+        return (uint32_t)((uint64_t)ticks * 1'000'000'000 / rate);
+    }
+
+    uint32_t ticks_per_second() const override {
+        return rate;
+    }
+
+    uint32_t nanos_between(uint32_t ticks_start, uint32_t ticks_end) const override {
+        return ticks_to_nanos(ticks_end - ticks_start);
+    }
+
+    uint32_t nanos_since(uint32_t& ticks_start) const override {
+        uint32_t past = ticks_start;
+        ticks_start = get_system_tick();
+        return nanos_between(past, ticks_start);
+    }
+
+private:
+    uint32_t rate;
+};
+
+}
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_COMMON_HAL_GPIO_PORT_H
+#define I2C_UNDERNEATH_COMMON_HAL_GPIO_PORT_H
+
+#include <cstdint>
+
+namespace common {
+namespace hal {
+
+// A group of pins that share a pad status register and an interrupt.
+// Each pin is one bit of the register.
+//
+// Different concrete implementations of this class support different
+// platforms. The host build uses a fake implementation for testing.
+class GpioPort {
+public:
+    // Disables any interrupts that were enabled
+    virtual ~GpioPort() = default;
+
+    // The bit that represents 'pin' or 0 if the pin isn't part of this port.
+    virtual uint32_t pin_mask(uint8_t pin) const = 0;
+
+    // The current state of every pin. A pin's bit is set if it's HIGH.
+    virtual uint32_t read_pins() const = 0;
+
+    // The pins that have changed since their flags were last cleared.
+    // A flag stays set if the pin changes back again. This reveals glitches.
+    virtual uint32_t read_interrupt_flags() const = 0;
+
+    virtual void clear_interrupt_flags(uint32_t mask) = 0;
+
+    // Calls 'isr' whenever a pin in 'mask' rises or falls.
+    virtual void enable_interrupts(uint32_t mask, void (* isr)()) = 0;
+
+    virtual void disable_interrupts() = 0;
+};
+
+}
+}
+#endif //I2C_UNDERNEATH_COMMON_HAL_GPIO_PORT_H
@@ -13,7 +13,7 @@ namespace hal {
 
 // This implementation is as fast as calling the hardware
 // specific functions directly.
-class TeensyClock : public Clock {
+class TeensyClock final : public Clock {
 public:
     inline uint32_t get_system_tick() const override {
         return ARM_DWT_CYCCNT;
@@ -27,6 +27,10 @@ public:
         return TeensyTimestamp::ticks_to_nanos(ticks);
     }
 
+    uint32_t ticks_per_second() const override {
+        return F_CPU_ACTUAL;
+    }
+
     inline uint32_t nanos_between(uint32_t ticks_start, uint32_t ticks_end) const override {
         return TeensyTimestamp::nanos_between(ticks_start, ticks_end);
     }
@@ -0,0 +1,66 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "teensy_edge_capture.h"
+
+namespace common {
+namespace hal {
+
+#define DEFAULT_IRQ_PRIORITY 128
+#define CAPTURE_BOTH_EDGES 3
+
+TeensyEdgeCapture::~TeensyEdgeCapture() {
+    stop();
+}
+
+void TeensyEdgeCapture::set_callback(void (* on_capture)()) {
+    isr = on_capture;
+}
+
+void TeensyEdgeCapture::start() {
+    stop();
+    if (gpt == &IMXRT_GPT1) {
+        CCM_CCGR1 |= CCM_CCGR1_GPT1_BUS(CCM_CCGR_ON) | CCM_CCGR1_GPT1_SERIAL(CCM_CCGR_ON);
+    } else {
+        CCM_CCGR0 |= CCM_CCGR0_GPT2_BUS(CCM_CCGR_ON) | CCM_CCGR0_GPT2_SERIAL(CCM_CCGR_ON);
+    }
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    lost_edges = 0;
+
+    // Free running counter clocked by the peripheral clock (PERCLK_CLK_ROOT)
+    gpt->CR = 0;
+    gpt->PR = 0;
+    gpt->SR = 0x3F;     // Clear all status flags
+    gpt->IR = GPT_IR_IF1IE | GPT_IR_IF2IE;
+    gpt->CR = GPT_CR_EN | GPT_CR_ENMOD | GPT_CR_FRR | GPT_CR_CLKSRC(1)
+              | GPT_CR_IM1(CAPTURE_BOTH_EDGES) | GPT_CR_IM2(CAPTURE_BOTH_EDGES);
+
+    if (isr) {
+        attachInterruptVector(irq, isr);
+        // Same priority as BusRecorder. 1 step higher than I2C.
+        NVIC_SET_PRIORITY(irq, DEFAULT_IRQ_PRIORITY - 16);
+        NVIC_ENABLE_IRQ(irq);
+    }
+}
+
+void TeensyEdgeCapture::stop() {
+    NVIC_DISABLE_IRQ(irq);
+    gpt->IR = 0;
+    gpt->CR &= ~(GPT_CR_IM1(CAPTURE_BOTH_EDGES) | GPT_CR_IM2(CAPTURE_BOTH_EDGES));
+}
+
+size_t TeensyEdgeCapture::read_edges(Edge* edges, size_t max_edges) {
+    size_t current_tail = tail.load(std::memory_order_relaxed);
+    const size_t current_head = head.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (count < max_edges && current_tail != current_head) {
+        edges[count++] = buffer[current_tail & (BUFFER_SIZE - 1)];
+        current_tail++;
+    }
+    tail.store(current_tail, std::memory_order_release);
+    return count;
+}
+
+}
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_COMMON_HAL_TEENSY_TEENSY_EDGE_CAPTURE_H
+#define I2C_UNDERNEATH_COMMON_HAL_TEENSY_TEENSY_EDGE_CAPTURE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <imxrt.h>
+#include "common/hal/edge_capture.h"
+
+namespace common {
+namespace hal {
+
+// Captures I2C edges with one of the Teensy 4's General Purpose Timers (GPT).
+// SDA must be connected to capture input 1 and SCL to capture input 2.
+// The timer counts the peripheral clock (PERCLK_CLK_ROOT). The Teensy 4
+// core runs it from the 24 MHz oscillator so each tick is about 42 nanos.
+//
+// The GPT latches the counter on each edge and raises an interrupt.
+// The ISR copies the captured count to a buffer. This is much faster
+// than BusRecorder's ISR and the time of each edge doesn't depend on
+// how long the ISR takes to run. There's still one interrupt per edge.
+// An edge is lost if the same line changes twice before the ISR runs.
+//
+// The caller must route the pins to the capture inputs before calling
+// start(). Set each pin's IOMUXC_SW_MUX_CTL_PAD register to the GPT
+// capture function and the matching IOMUXC_GPTx_IPP_IND_CAPINx_SELECT_INPUT
+// register. See the i.MX RT1060 reference manual for the options.
+class TeensyEdgeCapture : public EdgeCapture {
+public:
+    // The number of edges that can be buffered. Must be a power of 2.
+    static const size_t BUFFER_SIZE = 64;
+
+    // 'gpt' is either GPT1 or GPT2. 'irq' is the matching IRQ_GPT1 or IRQ_GPT2.
+    TeensyEdgeCapture(IMXRT_GPT_t* gpt, IRQ_NUMBER_t irq, uint8_t pin_sda, uint8_t pin_scl)
+        : gpt(gpt), irq(irq), pin_sda(pin_sda), pin_scl(pin_scl) {
+    }
+
+    ~TeensyEdgeCapture() override;
+
+    // Sets up the interrupt service routine (ISR). e.g.
+    // capture.set_callback([]() { capture.on_capture(); });
+    void set_callback(void (* on_capture)());
+
+    uint32_t counter_mask() const override {
+        return UINT32_MAX;
+    }
+
+    // The rate of PERCLK_CLK_ROOT. start() selects it as the timer's clock.
+    uint32_t ticks_per_second() const override {
+        const uint32_t cscmr1 = CCM_CSCMR1;
+        const uint32_t source = (cscmr1 & CCM_CSCMR1_PERCLK_CLK_SEL) ? 24'000'000 : F_BUS_ACTUAL;
+        return source / ((cscmr1 & CCM_CSCMR1_PERCLK_PODF(0x3F)) + 1);
+    }
+
+    void start() override;
+
+    void stop() override;
+
+    uint32_t read_counter() const override {
+        return gpt->CNT;
+    }
+
+    bool read_line(uint8_t line) const override {
+        return digitalReadFast(line == SDA ? pin_sda : pin_scl);
+    }
+
+    size_t read_edges(Edge* edges, size_t max_edges) override;
+
+    // The number of edges that were discarded because the buffer was full.
+    inline size_t lost_edge_count() const {
+        return lost_edges;
+    }
+
+    // Copies the captured edges to the buffer. DON'T call this method directly.
+    // Use set_callback() to fire it automatically.
+    inline void on_capture() {
+        const uint32_t status = gpt->SR & (GPT_SR_IF1 | GPT_SR_IF2);
+        gpt->SR = status;   // Clear the flags
+        if (status == (GPT_SR_IF1 | GPT_SR_IF2)) {
+            // Both lines changed. Keep the edges in order.
+            const uint32_t sda_count = gpt->ICR1;
+            const uint32_t scl_count = gpt->ICR2;
+            if ((int32_t)(scl_count - sda_count) < 0) {
+                push(scl_count, SCL);
+                push(sda_count, SDA);
+            } else {
+                push(sda_count, SDA);
+                push(scl_count, SCL);
+            }
+        } else if (status & GPT_SR_IF1) {
+            push(gpt->ICR1, SDA);
+        } else if (status & GPT_SR_IF2) {
+            push(gpt->ICR2, SCL);
+        }
+        asm volatile ("dsb");   // Make sure the flags are clear before the ISR returns
+    }
+
+private:
+    IMXRT_GPT_t* const gpt;
+    const IRQ_NUMBER_t irq;
+    const uint8_t pin_sda;
+    const uint8_t pin_scl;
+    void (* isr)() = nullptr;
+
+    Edge buffer[BUFFER_SIZE] = {};
+    std::atomic<size_t> head{0};    // Only written by the ISR
+    std::atomic<size_t> tail{0};    // Only written by read_edges()
+    volatile size_t lost_edges = 0;
+
+    inline void push(uint32_t count, uint8_t line) {
+        const size_t current_head = head.load(std::memory_order_relaxed);
+        if (current_head - tail.load(std::memory_order_acquire) >= BUFFER_SIZE) {
+            lost_edges = lost_edges + 1;
+            return;
+        }
+        buffer[current_head & (BUFFER_SIZE - 1)] = Edge{count, line, read_line(line)};
+        head.store(current_head + 1, std::memory_order_release);
+    }
+};
+
+}
+}
+#endif //I2C_UNDERNEATH_COMMON_HAL_TEENSY_TEENSY_EDGE_CAPTURE_H
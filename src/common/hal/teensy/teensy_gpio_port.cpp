@@ -0,0 +1,39 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#include "teensy_gpio_port.h"
+
+namespace common {
+namespace hal {
+
+#define DEFAULT_IRQ_PRIORITY 128
+
+void TeensyGpioPort::enable_interrupts(uint32_t mask, void (* isr)()) {
+    disable_interrupts();
+    enabled_mask = mask;
+
+    // Wire up the interrupt service routine
+    attachInterruptVector(irq, isr);
+    NVIC_ENABLE_IRQ(irq);
+    // Make this IRQ 1 step higher priority than I2C.
+    // Assumes the I2C priorities are still at the default value.
+    NVIC_SET_PRIORITY(irq, DEFAULT_IRQ_PRIORITY - 16);
+
+    // Configure interrupts for these pins
+    gpio->ISR = mask;       // Clear pending interrupts
+    gpio->EDGE_SEL |= mask; // Either edge will trigger the interrupts
+    gpio->IMR |= mask;      // Enable the interrupts
+}
+
+void TeensyGpioPort::disable_interrupts() {
+    if (!enabled_mask) {
+        return;
+    }
+    gpio->IMR &= ~enabled_mask;
+    NVIC_DISABLE_IRQ(irq);
+    NVIC_SET_PRIORITY(irq, DEFAULT_IRQ_PRIORITY);
+    enabled_mask = 0;
+}
+
+}
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_COMMON_HAL_TEENSY_TEENSY_GPIO_PORT_H
+#define I2C_UNDERNEATH_COMMON_HAL_TEENSY_TEENSY_GPIO_PORT_H
+
+#include <Arduino.h>
+#include "common/hal/gpio_port.h"
+#include "common/hal/teensy/super_fast_io.h"
+
+namespace common {
+namespace hal {
+
+// The pins that share an interrupt with 'pin'. See the pin lists in
+// bus_recorder.h. The state of the pins is read from the fast GPIO port
+// and the interrupts come from the matching slow port.
+class TeensyGpioPort final : public GpioPort {
+public:
+    explicit TeensyGpioPort(uint8_t pin)
+        : gpio(getSlowGPIO(pin)), fast_gpio(getGPIO(pin)), irq(getSlowIRQ(pin)) {
+    }
+
+    ~TeensyGpioPort() override {
+        disable_interrupts();
+    }
+
+    uint32_t pin_mask(uint8_t pin) const override {
+        if (pin >= CORE_NUM_DIGITAL || getSlowIRQ(pin) != irq) {
+            return 0;
+        }
+        return getPortBitmask(pin);
+    }
+
+    inline uint32_t read_pins() const override {
+        return fast_gpio->PSR;
+    }
+
+    inline uint32_t read_interrupt_flags() const override {
+        return gpio->ISR;
+    }
+
+    inline void clear_interrupt_flags(uint32_t mask) override {
+        gpio->ISR = mask;
+    }
+
+    void enable_interrupts(uint32_t mask, void (* isr)()) override;
+
+    void disable_interrupts() override;
+
+private:
+    IMXRT_GPIO_t* const gpio;
+    IMXRT_GPIO_t* const fast_gpio;
+    const IRQ_NUMBER_t irq;
+    uint32_t enabled_mask = 0;
+};
+
+}
+}
+#endif //I2C_UNDERNEATH_COMMON_HAL_TEENSY_TEENSY_GPIO_PORT_H
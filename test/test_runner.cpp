@@ -7,12 +7,37 @@
 #include "unit/analysis/duration_statistics_test.h"
 #include "unit/analysis/i2c_design_parameters_test.h"
 #include "unit/analysis/i2c_timing_analyser_test.h"
+#include "unit/analysis/streaming_timing_analyser_test.h"
 #include "unit/bus_monitor/bus_monitor_test.h"
+#include "unit/bus_trace/address_filtered_trace_test.h"
 #include "unit/bus_trace/bus_event_flags_test.h"
+#include "unit/bus_trace/bus_event_queue_test.h"
 #include "unit/bus_trace/bus_event_test.h"
-#include "unit/bus_trace/bus_recorder_a_test.h"
 #include "unit/bus_trace/bus_trace_builder_test.h"
+#include "unit/bus_trace/bus_trace_decoder_test.h"
+#include "unit/bus_trace/bus_trace_pool_test.h"
+#include "unit/bus_trace/bus_trace_serialiser_test.h"
 #include "unit/bus_trace/bus_trace_test.h"
+#include "unit/bus_trace/bus_trigger_test.h"
+#include "unit/bus_trace/byte_decoder_test.h"
+#include "unit/bus_trace/capture_recorder_test.h"
+#include "unit/bus_trace/double_buffered_trace_test.h"
+#include "unit/bus_trace/gpio_sample_decoder_test.h"
+#include "unit/bus_trace/message_iterator_test.h"
+#include "unit/bus_trace/multi_bus_recorder_test.h"
+#include "unit/bus_trace/packed_bus_trace_test.h"
+#include "unit/bus_trace/sigrok_session_test.h"
+#include "unit/bus_trace/triggered_trace_test.h"
+#include "unit/bus_trace/vcd_writer_test.h"
+
+#if defined(I2C_UNDERNEATH_NATIVE)
+// Tests that need the host build
+#include "unit/bus_trace/mapped_bus_trace_test.h"
+#endif
+
+#if defined(ARDUINO)
+// Tests that need a Teensy
+#include "unit/bus_trace/bus_recorder_a_test.h"
 #include "e2e/common/hal/teensy/super_fast_io_test.h"
 
 // End to End Tests
@@ -24,6 +49,7 @@
 #include "e2e/common/hal/teensy/teensy_timestamp_test.h"
 #include "e2e/common/hal/teensy/teensy_clock_test.h"
 #include "e2e/line_test/line_tester_test.h"
+#endif
 
 void test(TestSuite* suite);
 
@@ -33,7 +59,7 @@ bool run_subset() {
     return true;
 //    test(new analysis::I2CDesignParametersTest);
 //    test(new analysis::I2CTimingAnalyserTest);
-    test(new bus_trace::BusRecorderE2ETest);
+//    test(new bus_trace::BusRecorderE2ETest);
     return false;
 }
 
@@ -46,12 +72,35 @@ void run_all_tests() {
     test(new analysis::DurationStatisticsTest);
     test(new analysis::I2CDesignParametersTest);
     test(new analysis::I2CTimingAnalyserTest);
+    test(new analysis::StreamingTimingAnalyserTest);
     test(new bus_monitor::BusMonitorTest);
+    test(new bus_trace::AddressFilteredTraceTest);
     test(new bus_trace::BusEventFlagsTest);
+    test(new bus_trace::BusEventQueueTest);
     test(new bus_trace::BusEventTest);
-    test(new bus_trace::BusRecorderATest);
     test(new bus_trace::BusTraceBuilderTest);
+    test(new bus_trace::BusTraceDecoderTest);
+    test(new bus_trace::BusTracePoolTest);
+    test(new bus_trace::BusTraceSerialiserTest);
     test(new bus_trace::BusTraceTest);
+    test(new bus_trace::BusTriggerTest);
+    test(new bus_trace::ByteDecoderTest);
+    test(new bus_trace::CaptureRecorderTest);
+    test(new bus_trace::DoubleBufferedTraceTest);
+    test(new bus_trace::GpioSampleDecoderTest);
+    test(new bus_trace::MessageIteratorTest);
+    test(new bus_trace::MultiBusRecorderTest);
+    test(new bus_trace::PackedBusTraceTest);
+    test(new bus_trace::SigrokSessionTest);
+    test(new bus_trace::TriggeredTraceTest);
+    test(new bus_trace::VcdWriterTest);
+
+#if defined(I2C_UNDERNEATH_NATIVE)
+    test(new bus_trace::MappedBusTraceTest);
+#endif
+
+#if defined(ARDUINO)
+    test(new bus_trace::BusRecorderATest);
     test(new common::hal::SuperFastIoTest);
 
     // Full Stack Tests
@@ -66,6 +115,7 @@ void run_all_tests() {
     test(new common::hal::TeensyTimerTest);
     test(new common::hal::TeensyTimestampTest);
     test(new line_test::LineTesterTest);
+#endif
 }
 
 TestSuite* test_suite;
@@ -96,6 +146,7 @@ __attribute__((unused)) void tearDown(void) {
     test_suite->tearDown();
 }
 
+#if defined(ARDUINO)
 // Blink the LED to make sure the Teensy hasn't hung
 IntervalTimer blink_timer;
 void blink_isr();
@@ -122,6 +173,16 @@ __attribute__((unused)) void loop() {
         Serial.print(" ");
     }
 }
+#else
+// The host build runs the unit tests once and then exits.
+int main() {
+    UNITY_BEGIN();
+    if(run_subset()) {
+        run_all_tests();
+    }
+    return UNITY_END();
+}
+#endif
 
 // Equivalent to UNITY_END() except it doesn't halt the test runner.
 void report_test_results() {
@@ -140,6 +201,8 @@ void report_test_results() {
     Serial.println(".");
 }
 
+#if defined(ARDUINO)
 void blink_isr() {
     digitalToggle(LED_BUILTIN);
 }
+#endif
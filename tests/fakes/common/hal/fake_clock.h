@@ -37,6 +37,10 @@ public:
         return ticks * nanos_per_tick;
     }
 
+    uint32_t ticks_per_second() const override {
+        return 1'000'000'000 / nanos_per_tick;
+    }
+
     uint32_t nanos_between(uint32_t ticks_start, uint32_t ticks_end) const override {
         return ticks_to_nanos(ticks_end - ticks_start);
     }
@@ -0,0 +1,101 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_FAKES_COMMON_HAL_FAKE_EDGE_CAPTURE_H
+#define I2C_UNDERNEATH_FAKES_COMMON_HAL_FAKE_EDGE_CAPTURE_H
+
+#include <deque>
+#include <common/hal/edge_capture.h>
+
+namespace common {
+namespace hal {
+
+// Simulates input capture hardware with a counter of any width and a
+// buffer that holds 'buffer_size' edges. Edges are lost if the buffer
+// is full. Move time on with advance() and change the lines with
+// set_line().
+class FakeEdgeCapture : public EdgeCapture {
+public:
+    explicit FakeEdgeCapture(uint32_t counter_mask = 0xFFFF, uint32_t ticks_per_second = 150'000'000,
+                             size_t buffer_size = 64)
+        : mask(counter_mask), rate(ticks_per_second), buffer_size(buffer_size) {
+    }
+
+    uint32_t counter_mask() const override {
+        return mask;
+    }
+
+    uint32_t ticks_per_second() const override {
+        return rate;
+    }
+
+    void start() override {
+        buffer.clear();
+        capturing = true;
+    }
+
+    void stop() override {
+        capturing = false;
+    }
+
+    uint32_t read_counter() const override {
+        return counter;
+    }
+
+    bool read_line(uint8_t line) const override {
+        return lines[line];
+    }
+
+    size_t read_edges(Edge* edges, size_t max_edges) override {
+        read_edges_calls++;
+        size_t count = 0;
+        while (count < max_edges && !buffer.empty()) {
+            edges[count++] = buffer.front();
+            buffer.pop_front();
+        }
+        return count;
+    }
+
+    // Moves time forward
+    void advance(uint32_t ticks) {
+        counter = (counter + ticks) & mask;
+    }
+
+    // Changes the state of a line and captures the edge
+    void set_line(uint8_t line, bool high) {
+        if (lines[line] == high) {
+            return;
+        }
+        lines[line] = high;
+        if (!capturing) {
+            return;
+        }
+        if (buffer.size() < buffer_size) {
+            buffer.push_back(Edge{counter, line, high});
+        } else {
+            lost_edges++;
+        }
+    }
+
+    // Captures an edge without changing the state of the line.
+    // This simulates a pulse that was too short for the hardware.
+    void capture_edge(uint8_t line, bool high) {
+        buffer.push_back(Edge{counter, line, high});
+    }
+
+    size_t lost_edges = 0;
+    size_t read_edges_calls = 0;
+
+private:
+    const uint32_t mask;
+    const uint32_t rate;
+    const size_t buffer_size;
+    uint32_t counter = 0;
+    bool lines[2] = {true, true};
+    bool capturing = false;
+    std::deque<Edge> buffer;
+};
+
+}
+}
+#endif //I2C_UNDERNEATH_FAKES_COMMON_HAL_FAKE_EDGE_CAPTURE_H
@@ -0,0 +1,64 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_FAKES_COMMON_HAL_FAKE_GPIO_PORT_H
+#define I2C_UNDERNEATH_FAKES_COMMON_HAL_FAKE_GPIO_PORT_H
+
+#include <common/hal/gpio_port.h>
+
+namespace common {
+namespace hal {
+
+// A GPIO port where pin n is bit n. Pins 0 to 31 are part of the port.
+// Change the pins with set_pin() and glitch(). The fake doesn't call
+// the ISR itself. Call it from the test once you've changed the pins.
+class FakeGpioPort : public GpioPort {
+public:
+    uint32_t pin_mask(uint8_t pin) const override {
+        return pin < 32 ? 1u << pin : 0;
+    }
+
+    uint32_t read_pins() const override {
+        return pins;
+    }
+
+    uint32_t read_interrupt_flags() const override {
+        return flags;
+    }
+
+    void clear_interrupt_flags(uint32_t mask) override {
+        flags &= ~mask;
+    }
+
+    void enable_interrupts(uint32_t mask, void (* on_change)()) override {
+        enabled_mask = mask;
+        isr = on_change;
+    }
+
+    void disable_interrupts() override {
+        enabled_mask = 0;
+        isr = nullptr;
+    }
+
+    void set_pin(uint8_t pin, bool high) {
+        const uint32_t mask = pin_mask(pin);
+        if (((pins & mask) != 0) != high) {
+            pins ^= mask;
+            flags |= mask & enabled_mask;
+        }
+    }
+
+    // The pin changes and changes back again before the ISR runs.
+    void glitch(uint8_t pin) {
+        flags |= pin_mask(pin) & enabled_mask;
+    }
+
+    uint32_t pins = 0;
+    uint32_t flags = 0;
+    uint32_t enabled_mask = 0;
+    void (* isr)() = nullptr;
+};
+
+}
+}
+#endif //I2C_UNDERNEATH_FAKES_COMMON_HAL_FAKE_GPIO_PORT_H
@@ -0,0 +1,46 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_FAKE_STREAM_H
+#define I2C_UNDERNEATH_FAKE_STREAM_H
+
+#include <Arduino.h>
+
+// A Stream that reads from an array of bytes.
+// Anything written to the stream is discarded.
+class FakeStream : public Stream {
+public:
+    FakeStream(const uint8_t* data, size_t size)
+        : data(data), size(size) {
+    }
+
+    int available() override {
+        return (int)(size - position);
+    }
+
+    int read() override {
+        if (position < size) {
+            return data[position++];
+        }
+        return -1;
+    }
+
+    int peek() override {
+        if (position < size) {
+            return data[position];
+        }
+        return -1;
+    }
+
+    size_t write(uint8_t b) override {
+        (void)b;
+        return 0;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+};
+
+#endif //I2C_UNDERNEATH_FAKE_STREAM_H
@@ -0,0 +1,128 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_STREAMING_TIMING_ANALYSER_TEST_H
+#define I2C_UNDERNEATH_STREAMING_TIMING_ANALYSER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "utils/bus_trace_fixtures.h"
+#include "fakes/common/hal/fake_clock.h"
+#include <analysis/i2c_timing_analyser.h>
+#include <analysis/streaming_timing_analyser.h>
+
+namespace analysis {
+class StreamingTimingAnalyserTest : public TestSuite {
+private:
+    const static size_t MAX_EVENTS = 1024;
+    const static uint16_t SDA_RISE = 500;
+    const static uint16_t SCL_RISE = 1'000;
+    const static uint16_t SDA_FALL = 150;
+    const static uint16_t SCL_FALL = 300;
+
+    static void assert_statistics_equal(const DurationStatistics& expected, const DurationStatistics& actual) {
+        TEST_ASSERT_EQUAL_UINT32(expected.count(), actual.count());
+        TEST_ASSERT_EQUAL_UINT32(expected.min(), actual.min());
+        TEST_ASSERT_EQUAL_UINT32(expected.max(), actual.max());
+        if (expected.count() > 0) {
+            TEST_ASSERT_EQUAL_UINT32(expected.average(), actual.average());
+        }
+    }
+
+public:
+    static void streaming_analysis_matches_trace_analysis() {
+        // GIVEN a trace
+        common::hal::FakeClock clock;
+        bus_trace::BusTrace trace(&clock, MAX_EVENTS);
+        bus_trace::given_2_messages(trace);
+
+        // WHEN we analyse the events one at a time
+        StreamingTimingAnalyser analyser(&clock, SDA_RISE, SCL_RISE, SDA_FALL, SCL_FALL);
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            analyser.add_event(*trace.event(i));
+        }
+
+        // THEN we get the same result as analysing the whole trace
+        auto expected = I2CTimingAnalyser::analyse(trace, SDA_RISE, SCL_RISE, SDA_FALL, SCL_FALL);
+        auto& actual = analyser.analysis();
+        TEST_ASSERT_EQUAL_UINT32(trace.event_count(), analyser.event_count());
+        assert_statistics_equal(expected.clock_frequency, actual.clock_frequency);
+        assert_statistics_equal(expected.start_hold_time, actual.start_hold_time);
+        assert_statistics_equal(expected.scl_low_time, actual.scl_low_time);
+        assert_statistics_equal(expected.scl_high_time, actual.scl_high_time);
+        assert_statistics_equal(expected.start_setup_time, actual.start_setup_time);
+        assert_statistics_equal(expected.data_hold_time, actual.data_hold_time);
+        assert_statistics_equal(expected.data_setup_time, actual.data_setup_time);
+        assert_statistics_equal(expected.stop_setup_time, actual.stop_setup_time);
+        assert_statistics_equal(expected.bus_free_time, actual.bus_free_time);
+        assert_statistics_equal(expected.data_valid_time, actual.data_valid_time);
+        TEST_ASSERT_EQUAL_UINT32(1, actual.bus_free_time.count());
+    }
+
+    static void analysis_is_updated_as_each_event_arrives() {
+        // GIVEN an analyser that has seen the start of a message
+        common::hal::FakeClock clock;
+        StreamingTimingAnalyser analyser(&clock, 0, 0, 0, 0);
+        analyser.add_event(bus_trace::BusEvent(0, bus_trace::BusEventFlags::SDA_LINE_STATE | bus_trace::BusEventFlags::SCL_LINE_STATE));
+        analyser.add_event(bus_trace::BusEvent(100, bus_trace::BusEventFlags::SDA_LINE_CHANGED | bus_trace::BusEventFlags::SCL_LINE_STATE));
+        TEST_ASSERT_EQUAL_UINT32(0, analyser.analysis().start_hold_time.count());
+
+        // WHEN SCL falls to complete the START condition
+        analyser.add_event(bus_trace::BusEvent(2'000, bus_trace::BusEventFlags::SCL_LINE_CHANGED));
+
+        // THEN the start hold time is available immediately
+        TEST_ASSERT_EQUAL_UINT32(1, analyser.analysis().start_hold_time.count());
+        TEST_ASSERT_EQUAL_UINT32(2'000 * clock.nanos_per_tick, analyser.analysis().start_hold_time.average());
+    }
+
+    static void time_extensions_are_added_to_the_next_event() {
+        // GIVEN an analyser that has seen SDA fall for a START condition
+        common::hal::FakeClock clock;
+        StreamingTimingAnalyser analyser(&clock, 0, 0, 0, 0);
+        analyser.add_event(bus_trace::BusEvent(0, bus_trace::BusEventFlags::SDA_LINE_STATE | bus_trace::BusEventFlags::SCL_LINE_STATE));
+        analyser.add_event(bus_trace::BusEvent(100, bus_trace::BusEventFlags::SDA_LINE_CHANGED | bus_trace::BusEventFlags::SCL_LINE_STATE));
+
+        // WHEN SCL falls a very long time later
+        auto flags = bus_trace::BusEventFlags::SCL_LINE_CHANGED;
+        analyser.add_event(bus_trace::BusEvent::time_extension(0x30000 + 2'000, flags));
+        analyser.add_event(bus_trace::BusEvent(2'000, flags));
+
+        // THEN the start hold time includes the time extension
+        TEST_ASSERT_EQUAL_UINT32(1, analyser.analysis().start_hold_time.count());
+        TEST_ASSERT_EQUAL_UINT32((0x30000 + 2'000) * clock.nanos_per_tick, analyser.analysis().start_hold_time.average());
+    }
+
+    static void reset_discards_analysis() {
+        // GIVEN an analyser that has analysed a message
+        common::hal::FakeClock clock;
+        bus_trace::BusTrace trace(&clock, MAX_EVENTS);
+        bus_trace::given_2_messages(trace);
+        StreamingTimingAnalyser analyser(&clock, SDA_RISE, SCL_RISE, SDA_FALL, SCL_FALL);
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            analyser.add_event(*trace.event(i));
+        }
+
+        // WHEN we reset the analyser
+        analyser.reset();
+
+        // THEN the analysis is empty
+        TEST_ASSERT_EQUAL_UINT32(0, analyser.event_count());
+        TEST_ASSERT_EQUAL_UINT32(0, analyser.analysis().clock_frequency.count());
+        TEST_ASSERT_EQUAL_UINT32(0, analyser.analysis().scl_low_time.count());
+        TEST_ASSERT_EQUAL_UINT32(0, analyser.analysis().stop_setup_time.count());
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(streaming_analysis_matches_trace_analysis);
+        RUN_TEST(analysis_is_updated_as_each_event_arrives);
+        RUN_TEST(time_extensions_are_added_to_the_next_event);
+        RUN_TEST(reset_discards_analysis);
+    }
+
+    StreamingTimingAnalyserTest() : TestSuite(__FILE__) {};
+};
+
+} // analysis
+
+#endif //I2C_UNDERNEATH_STREAMING_TIMING_ANALYSER_TEST_H
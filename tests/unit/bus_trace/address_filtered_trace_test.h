@@ -0,0 +1,197 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_ADDRESS_FILTERED_TRACE_TEST_H
+#define I2C_UNDERNEATH_ADDRESS_FILTERED_TRACE_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "bus_trace/address_filtered_trace.h"
+#include "bus_trace/bus_trace_builder.h"
+
+namespace bus_trace {
+
+class AddressFilteredTraceTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+    static const size_t MAX_BYTES = 32;
+    typedef DecodedByte::Type Type;
+
+    // A write to 0x53, a read from 0x10 and a register read from 0x53
+    static void given_3_transactions(BusTrace& trace) {
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .start_bit()
+                .address_byte(0x53, BusTraceBuilder::WRITE).ack()
+                .data_byte(0x58).ack()
+                .stop_bit()
+                .start_bit()
+                .address_byte(0x10, BusTraceBuilder::READ).ack()
+                .data_byte(0xA7).nack()
+                .stop_bit()
+                .start_bit()
+                .address_byte(0x53, BusTraceBuilder::WRITE).ack()
+                .data_byte(0x02).ack();
+        // Release SCL so we can send a repeated START
+        trace.add_event(BusEvent(1'000, BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE | BusEventFlags::SDA_LINE_STATE));
+        builder.start_bit()
+                .address_byte(0x53, BusTraceBuilder::READ).ack()
+                .data_byte(0x11).nack()
+                .stop_bit();
+    }
+
+    // Returns the total number of ticks in 'source'
+    static uint32_t replay(const BusTrace& source, AddressFilteredTrace& filtered) {
+        uint32_t tick = 0;
+        for (size_t i = 0; i < source.event_count(); ++i) {
+            tick += source.event(i)->delta_t_in_ticks;
+            filtered.add_event(tick, source.event(i)->flags);
+        }
+        return tick;
+    }
+
+    static uint32_t total_ticks(const BusTrace& trace) {
+        uint32_t result = 0;
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            result += trace.event(i)->ticks();
+        }
+        return result;
+    }
+
+    static void decode(const BusTrace& trace, ByteDecoder& decoder) {
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            decoder.add_event(trace.event(i)->flags);
+        }
+    }
+
+    static void assert_byte(Type expected_type, uint8_t expected_value, const DecodedByte* actual) {
+        TEST_ASSERT_NOT_NULL(actual);
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)expected_type, (uint8_t)actual->type);
+        TEST_ASSERT_EQUAL_UINT8(expected_value, actual->value);
+    }
+
+public:
+    static void keeps_matching_transactions() {
+        // GIVEN a filter for address 0x53
+        BusTrace source(MAX_EVENTS);
+        given_3_transactions(source);
+        BusTrace trace(MAX_EVENTS);
+        AddressFilteredTrace filtered(trace);
+        filtered.add_address(0x53);
+        filtered.reset();
+
+        // WHEN it sees transactions for 2 different addresses
+        uint32_t ticks = replay(source, filtered);
+
+        // THEN it only keeps the transactions for 0x53
+        ByteDecoder decoder(MAX_BYTES);
+        decode(trace, decoder);
+        TEST_ASSERT_EQUAL_UINT32(11, decoder.byte_count());
+        assert_byte(Type::Start, 0, decoder.byte(0));
+        assert_byte(Type::AddressAck, 0xA6, decoder.byte(1));
+        assert_byte(Type::DataAck, 0x58, decoder.byte(2));
+        assert_byte(Type::Stop, 0, decoder.byte(3));
+        assert_byte(Type::Start, 0, decoder.byte(4));
+        assert_byte(Type::AddressAck, 0xA6, decoder.byte(5));
+        assert_byte(Type::DataAck, 0x02, decoder.byte(6));
+        assert_byte(Type::RepeatedStart, 0, decoder.byte(7));
+        assert_byte(Type::AddressAck, 0xA7, decoder.byte(8));
+        assert_byte(Type::DataNack, 0x11, decoder.byte(9));
+        assert_byte(Type::Stop, 0, decoder.byte(10));
+        TEST_ASSERT_EQUAL_UINT32(2, filtered.kept_transaction_count());
+        TEST_ASSERT_EQUAL_UINT32(1, filtered.discarded_transaction_count());
+
+        // AND the time between the transactions is preserved
+        TEST_ASSERT_EQUAL_UINT32(ticks, total_ticks(trace));
+    }
+
+    static void discards_everything_without_addresses() {
+        // GIVEN a filter without any addresses
+        BusTrace source(MAX_EVENTS);
+        given_3_transactions(source);
+        BusTrace trace(MAX_EVENTS);
+        AddressFilteredTrace filtered(trace);
+        filtered.reset();
+
+        // WHEN it sees some transactions
+        replay(source, filtered);
+
+        // THEN it only keeps the initial state of the bus
+        TEST_ASSERT_EQUAL_UINT32(1, trace.event_count());
+        TEST_ASSERT_TRUE(*trace.event(0) == *source.event(0));
+        TEST_ASSERT_EQUAL_UINT32(0, filtered.kept_transaction_count());
+        TEST_ASSERT_EQUAL_UINT32(3, filtered.discarded_transaction_count());
+    }
+
+    static void matches_addresses_with_a_mask() {
+        // GIVEN a filter for 0x50 to 0x57 and for 0x10
+        BusTrace trace(MAX_EVENTS);
+        AddressFilteredTrace filtered(trace);
+        TEST_ASSERT_TRUE(filtered.add_address(0x50, 0x78));
+        TEST_ASSERT_TRUE(filtered.add_address(0x10));
+
+        // THEN it matches all those addresses and no others
+        TEST_ASSERT_TRUE(filtered.matches(0x50));
+        TEST_ASSERT_TRUE(filtered.matches(0x57));
+        TEST_ASSERT_TRUE(filtered.matches(0x10));
+        TEST_ASSERT_FALSE(filtered.matches(0x58));
+        TEST_ASSERT_FALSE(filtered.matches(0x11));
+
+        // WHEN the addresses are cleared
+        filtered.clear_addresses();
+
+        // THEN it matches nothing
+        TEST_ASSERT_FALSE(filtered.matches(0x50));
+    }
+
+    static void add_address_fails_when_full() {
+        // GIVEN a filter with the maximum number of addresses
+        BusTrace trace(MAX_EVENTS);
+        AddressFilteredTrace filtered(trace);
+        for (size_t i = 0; i < AddressFilteredTrace::MAX_ADDRESSES; ++i) {
+            TEST_ASSERT_TRUE(filtered.add_address(i));
+        }
+
+        // WHEN we add another one
+        bool result = filtered.add_address(0x7F);
+
+        // THEN it's rejected
+        TEST_ASSERT_FALSE(result);
+        TEST_ASSERT_FALSE(filtered.matches(0x7F));
+    }
+
+    static void discards_transaction_if_address_takes_too_long() {
+        // GIVEN a filter for address 0x53
+        BusTrace trace(MAX_EVENTS);
+        AddressFilteredTrace filtered(trace);
+        filtered.add_address(0x53);
+        filtered.reset();
+        const BusEventFlags idle = SDA_LINE_STATE | SCL_LINE_STATE;
+        uint32_t tick = 0;
+        filtered.add_event(tick, idle);
+        filtered.add_event(tick += 10, SDA_LINE_CHANGED | SCL_LINE_STATE);   // START
+        filtered.add_event(tick += 10, SCL_LINE_CHANGED);
+
+        // WHEN SDA toggles while SCL is LOW for longer than the filter can wait
+        for (size_t i = 0; i < AddressFilteredTrace::MAX_PENDING_EVENTS; ++i) {
+            filtered.add_event(tick += 10, SDA_LINE_CHANGED | ((i % 2) ? BOTH_LOW_AND_UNCHANGED : SDA_LINE_STATE));
+        }
+
+        // THEN the transaction is discarded
+        TEST_ASSERT_EQUAL_UINT32(1, filtered.discarded_transaction_count());
+        TEST_ASSERT_EQUAL_UINT32(1, trace.event_count());
+    }
+
+    void test() final {
+        RUN_TEST(keeps_matching_transactions);
+        RUN_TEST(discards_everything_without_addresses);
+        RUN_TEST(matches_addresses_with_a_mask);
+        RUN_TEST(add_address_fails_when_full);
+        RUN_TEST(discards_transaction_if_address_takes_too_long);
+    }
+
+    AddressFilteredTraceTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_ADDRESS_FILTERED_TRACE_TEST_H
@@ -0,0 +1,242 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_EVENT_QUEUE_TEST_H
+#define I2C_UNDERNEATH_BUS_EVENT_QUEUE_TEST_H
+
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include <bus_trace/bus_event_queue.h>
+#if defined(I2C_UNDERNEATH_NATIVE)
+#include <thread>
+#endif
+
+namespace bus_trace {
+
+class BusEventQueueTest : public TestSuite {
+public:
+    static void capacity_is_rounded_down_to_power_of_2() {
+        TEST_ASSERT_EQUAL_UINT32(1, BusEventQueue(1).capacity());
+        TEST_ASSERT_EQUAL_UINT32(8, BusEventQueue(8).capacity());
+        TEST_ASSERT_EQUAL_UINT32(8, BusEventQueue(15).capacity());
+        BusEvent events[100];
+        TEST_ASSERT_EQUAL_UINT32(64, BusEventQueue(events, 100).capacity());
+    }
+
+    static void queue_without_space_discards_events() {
+        // GIVEN a queue with an external buffer of size 0
+        BusEvent events[1] = {BusEvent(7, BusEventFlags::SDA_LINE_STATE)};
+        BusEventQueue queue(events, 0);
+
+        // WHEN we push an event
+        bool pushed = queue.push(BusEvent(1, BusEventFlags::SDA_LINE_CHANGED));
+
+        // THEN it's discarded without touching the buffer
+        TEST_ASSERT_FALSE(pushed);
+        TEST_ASSERT_EQUAL_UINT32(0, queue.capacity());
+        TEST_ASSERT_TRUE(queue.empty());
+        TEST_ASSERT_EQUAL_UINT32(1, queue.dropped_event_count());
+        TEST_ASSERT_TRUE(BusEvent(7, BusEventFlags::SDA_LINE_STATE) == events[0]);
+    }
+
+    static void new_queue_is_empty() {
+        BusEventQueue queue(8);
+        BusEvent event(99, BusEventFlags::SDA_LINE_STATE);
+
+        TEST_ASSERT_TRUE(queue.empty());
+        TEST_ASSERT_EQUAL_UINT32(0, queue.size());
+        TEST_ASSERT_FALSE(queue.pop(event));
+        TEST_ASSERT_TRUE(BusEvent(99, BusEventFlags::SDA_LINE_STATE) == event);
+    }
+
+    static void events_are_popped_in_the_order_they_were_pushed() {
+        // GIVEN a queue with some events
+        BusEventQueue queue(8);
+        queue.push(BusEvent(1, BusEventFlags::SDA_LINE_CHANGED));
+        queue.push(BusEvent(2, BusEventFlags::SCL_LINE_CHANGED));
+        TEST_ASSERT_EQUAL_UINT32(2, queue.size());
+
+        // WHEN we pop the events
+        BusEvent first{};
+        BusEvent second{};
+        TEST_ASSERT_TRUE(queue.pop(first));
+        TEST_ASSERT_TRUE(queue.pop(second));
+
+        // THEN they come out in the same order
+        TEST_ASSERT_TRUE(BusEvent(1, BusEventFlags::SDA_LINE_CHANGED) == first);
+        TEST_ASSERT_TRUE(BusEvent(2, BusEventFlags::SCL_LINE_CHANGED) == second);
+        TEST_ASSERT_TRUE(queue.empty());
+    }
+
+    static void push_drops_events_when_full() {
+        // GIVEN a queue which is full
+        BusEventQueue queue(2);
+        TEST_ASSERT_TRUE(queue.push(BusEvent(1, BusEventFlags::SDA_LINE_CHANGED)));
+        TEST_ASSERT_TRUE(queue.push(BusEvent(2, BusEventFlags::SDA_LINE_CHANGED)));
+
+        // WHEN we push another event
+        bool pushed = queue.push(BusEvent(3, BusEventFlags::SDA_LINE_CHANGED));
+
+        // THEN the event is dropped
+        TEST_ASSERT_FALSE(pushed);
+        TEST_ASSERT_EQUAL_UINT32(2, queue.size());
+        TEST_ASSERT_EQUAL_UINT32(1, queue.dropped_event_count());
+
+        // AND there's room again once we've popped an event
+        BusEvent event{};
+        queue.pop(event);
+        TEST_ASSERT_TRUE(queue.push(BusEvent(4, BusEventFlags::SDA_LINE_CHANGED)));
+    }
+
+    static void queue_wraps_around() {
+        // GIVEN a small queue
+        BusEventQueue queue(4);
+
+        // WHEN we push and pop many more events than the queue can hold
+        for (uint16_t i = 0; i < 100; ++i) {
+            queue.push(BusEvent(i, BusEventFlags::SCL_LINE_CHANGED));
+            BusEvent event{};
+            TEST_ASSERT_TRUE(queue.pop(event));
+
+            // THEN every event comes out intact
+            TEST_ASSERT_EQUAL_UINT32(i, event.delta_t_in_ticks);
+        }
+        TEST_ASSERT_EQUAL_UINT32(0, queue.dropped_event_count());
+    }
+
+    static void push_with_tick_count_calculates_delta() {
+        // GIVEN a queue that was reset at tick 1000
+        BusEventQueue queue(8);
+        queue.reset(1000);
+
+        // WHEN we push events using the tick count
+        queue.push(1010, BusEventFlags::SDA_LINE_CHANGED);
+        queue.push(1030, BusEventFlags::SCL_LINE_CHANGED);
+
+        // THEN the deltas are relative to the previous event
+        BusEvent event{};
+        queue.pop(event);
+        TEST_ASSERT_EQUAL_UINT32(10, event.delta_t_in_ticks);
+        queue.pop(event);
+        TEST_ASSERT_EQUAL_UINT32(20, event.delta_t_in_ticks);
+    }
+
+    static void dropped_events_do_not_affect_delta_of_next_event() {
+        // GIVEN a full queue
+        BusEventQueue queue(1);
+        queue.reset(0);
+        queue.push(10, BusEventFlags::SDA_LINE_CHANGED);
+
+        // WHEN an event is dropped
+        queue.push(20, BusEventFlags::SCL_LINE_CHANGED);
+        BusEvent event{};
+        queue.pop(event);
+        // AND we push another event
+        queue.push(50, BusEventFlags::SCL_LINE_CHANGED);
+
+        // THEN the delta is measured from the last event in the queue
+        queue.pop(event);
+        TEST_ASSERT_EQUAL_UINT32(40, event.delta_t_in_ticks);
+    }
+
+    static void long_gaps_are_pushed_with_time_extension() {
+        // GIVEN a queue
+        BusEventQueue queue(4);
+        queue.reset(0);
+
+        // WHEN we push an event that's too far from the previous one for a BusEvent
+        TEST_ASSERT_TRUE(queue.push(0x20005, BusEventFlags::SCL_LINE_CHANGED));
+
+        // THEN a time extension is pushed first
+        BusEvent event{};
+        TEST_ASSERT_EQUAL_UINT32(2, queue.size());
+        queue.pop(event);
+        TEST_ASSERT_TRUE(event.is_time_extension());
+        TEST_ASSERT_EQUAL_UINT32(0x20000, event.ticks());
+        queue.pop(event);
+        TEST_ASSERT_TRUE(event == BusEvent(5, BusEventFlags::SCL_LINE_CHANGED));
+    }
+
+    static void time_extension_is_dropped_with_its_event() {
+        // GIVEN a queue with room for 1 more event
+        BusEventQueue queue(2);
+        queue.reset(0);
+        queue.push(10, BusEventFlags::SDA_LINE_CHANGED);
+
+        // WHEN we push an event that needs a time extension
+        TEST_ASSERT_FALSE(queue.push(100'000, BusEventFlags::SCL_LINE_CHANGED));
+
+        // THEN neither event is added
+        TEST_ASSERT_EQUAL_UINT32(1, queue.size());
+        TEST_ASSERT_EQUAL_UINT32(1, queue.dropped_event_count());
+    }
+
+    static void reset_empties_the_queue() {
+        BusEventQueue queue(2);
+        queue.push(BusEvent(1, BusEventFlags::SDA_LINE_CHANGED));
+        queue.push(BusEvent(2, BusEventFlags::SDA_LINE_CHANGED));
+        queue.push(BusEvent(3, BusEventFlags::SDA_LINE_CHANGED));
+
+        queue.reset();
+
+        TEST_ASSERT_TRUE(queue.empty());
+        TEST_ASSERT_EQUAL_UINT32(0, queue.dropped_event_count());
+    }
+
+    static void producer_and_consumer_run_concurrently() {
+#if defined(I2C_UNDERNEATH_NATIVE)
+        // GIVEN a thread standing in for the recorder's ISR
+        BusEventQueue queue(64);
+        const uint32_t event_count = 100'000;
+        std::thread producer([&queue, event_count]() {
+            for (uint32_t i = 0; i < event_count; ++i) {
+                auto event = BusEvent((uint16_t)i, BusEventFlags(i & 0xFF));
+                while (!queue.push(event)) {
+                    // Wait for the consumer to catch up
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        // WHEN we drain the queue on this thread at the same time
+        uint32_t received = 0;
+        bool in_order = true;
+        while (received < event_count) {
+            BusEvent event{};
+            if (queue.pop(event)) {
+                in_order &= (event == BusEvent((uint16_t)received, BusEventFlags(received & 0xFF)));
+                received++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        // THEN every event arrives once, in order
+        TEST_ASSERT_TRUE(in_order);
+        TEST_ASSERT_TRUE(queue.empty());
+#endif
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(capacity_is_rounded_down_to_power_of_2);
+        RUN_TEST(queue_without_space_discards_events);
+        RUN_TEST(new_queue_is_empty);
+        RUN_TEST(events_are_popped_in_the_order_they_were_pushed);
+        RUN_TEST(push_drops_events_when_full);
+        RUN_TEST(queue_wraps_around);
+        RUN_TEST(push_with_tick_count_calculates_delta);
+        RUN_TEST(dropped_events_do_not_affect_delta_of_next_event);
+        RUN_TEST(long_gaps_are_pushed_with_time_extension);
+        RUN_TEST(time_extension_is_dropped_with_its_event);
+        RUN_TEST(reset_empties_the_queue);
+        RUN_TEST(producer_and_consumer_run_concurrently);
+    }
+
+    BusEventQueueTest() : TestSuite(__FILE__) {};
+};
+
+}
+#endif //I2C_UNDERNEATH_BUS_EVENT_QUEUE_TEST_H
@@ -74,6 +74,32 @@ public:
         TEST_ASSERT_TRUE(BusEvent(123, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_CHANGED).scl_fell());
     }
 
+    static void time_extension() {
+        // GIVEN an SCL rising edge that happens a long time after the previous event
+        BusEventFlags next_flags = BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE | BusEventFlags::SDA_LINE_STATE;
+
+        // WHEN we create a time extension for it
+        BusEvent extension = BusEvent::time_extension(0x12345678, next_flags);
+
+        // THEN it holds the top 16 bits of the gap
+        TEST_ASSERT_TRUE(extension.is_time_extension());
+        TEST_ASSERT_EQUAL_UINT16(0x1234, extension.delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT32(0x12340000, extension.ticks());
+        // AND it has the line states from before the edge
+        TEST_ASSERT_EQUAL_UINT8(BusEventFlags::TIME_EXTENSION | BusEventFlags::SDA_LINE_STATE, extension.flags);
+        TEST_ASSERT_FALSE(extension.scl_rose());
+        TEST_ASSERT_FALSE(extension.scl_fell());
+        TEST_ASSERT_FALSE(extension.sda_rose());
+        TEST_ASSERT_FALSE(extension.sda_fell());
+    }
+
+    static void normal_events_are_not_time_extensions() {
+        TEST_ASSERT_FALSE(BusEvent(123, BusEventFlags::BOTH_LOW_AND_UNCHANGED).is_time_extension());
+        TEST_ASSERT_FALSE(BusEvent(123, BusEventFlags::SDA_PIN_CHANGED | BusEventFlags::SDA_LINE_CHANGED).is_time_extension());
+        TEST_ASSERT_FALSE(BusEvent(123, BusEventFlags::TIME_EXTENSION | BusEventFlags::SCL_LINE_CHANGED).is_time_extension());
+        TEST_ASSERT_EQUAL_UINT32(123, BusEvent(123, BusEventFlags::SCL_LINE_CHANGED).ticks());
+    }
+
     void test() final {
         RUN_TEST(create_bus_event);
         RUN_TEST(copy);
@@ -82,6 +108,8 @@ public:
         RUN_TEST(scl_fell);
         RUN_TEST(sda_rose);
         RUN_TEST(sda_fell);
+        RUN_TEST(time_extension);
+        RUN_TEST(normal_events_are_not_time_extensions);
     }
 
     BusEventTest() : TestSuite(__FILE__) {};
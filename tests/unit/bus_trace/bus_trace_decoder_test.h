@@ -0,0 +1,249 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRACE_DECODER_TEST_H
+#define I2C_UNDERNEATH_BUS_TRACE_DECODER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "utils/bus_trace_fixtures.h"
+#include "fakes/fake_serial.h"
+#include "bus_trace/bus_trace_builder.h"
+#include "bus_trace/bus_trace_decoder.h"
+
+namespace bus_trace {
+
+class BusTraceDecoderTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+    static const size_t MAX_FIELDS = 32;
+    typedef DecodedField::Type Type;
+
+    static void assert_types(const Type* expected, size_t expected_count, const BusTraceDecoder& decoder) {
+        TEST_ASSERT_EQUAL_UINT32(expected_count, decoder.field_count());
+        for (size_t i = 0; i < expected_count; ++i) {
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)expected[i], (uint8_t)decoder.field(i)->type);
+        }
+    }
+
+public:
+    static void decodes_messages() {
+        // GIVEN a trace containing a write followed by a read
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace);
+
+        // WHEN we decode it
+        BusTraceDecoder decoder(MAX_FIELDS);
+        decoder.decode(trace);
+
+        // THEN we get the START and STOP bits, addresses, data and ACKs
+        const Type expected[] = {
+                Type::Start, Type::Address, Type::Ack, Type::Data, Type::Ack, Type::Stop,
+                Type::Start, Type::Address, Type::Ack, Type::Data, Type::Nack, Type::Stop
+        };
+        assert_types(expected, sizeof(expected) / sizeof(expected[0]), decoder);
+        TEST_ASSERT_EQUAL_UINT8(0x53, decoder.field(1)->value);
+        TEST_ASSERT_FALSE(decoder.field(1)->read);
+        TEST_ASSERT_EQUAL_UINT8(0x58, decoder.field(3)->value);
+        TEST_ASSERT_EQUAL_UINT8(0x53, decoder.field(7)->value);
+        TEST_ASSERT_TRUE(decoder.field(7)->read);
+        TEST_ASSERT_EQUAL_UINT8(0xA7, decoder.field(9)->value);
+        TEST_ASSERT_EQUAL_UINT32(0, decoder.dropped_field_count());
+    }
+
+    static void fields_refer_to_trace_events() {
+        // GIVEN a decoded trace
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace);
+        BusTraceDecoder decoder(MAX_FIELDS);
+
+        // WHEN we decode it
+        decoder.decode(trace);
+
+        // THEN START and STOP bits refer to the SDA edge
+        // and everything else refers to an SCL rising edge
+        TEST_ASSERT_EQUAL_UINT32(1, decoder.field(0)->event_index);  // Event 0 is the idle bus
+        TEST_ASSERT_EQUAL_UINT32(4, decoder.field(1)->event_index);  // SDA rises for the first bit, then SCL rises
+        for (size_t i = 0; i < decoder.field_count(); ++i) {
+            const DecodedField* field = decoder.field(i);
+            const BusEvent* event = trace.event(field->event_index);
+            if (field->type == Type::Start) {
+                TEST_ASSERT_TRUE(event->sda_fell());
+            } else if (field->type == Type::Stop) {
+                TEST_ASSERT_TRUE(event->sda_rose());
+            } else {
+                TEST_ASSERT_TRUE(event->scl_rose());
+            }
+        }
+    }
+
+    static void repeated_start() {
+        // GIVEN a write followed by a read with a repeated START
+        BusTrace trace(MAX_EVENTS);
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .start_bit()
+                .address_byte(0x10, BusTraceBuilder::WRITE).ack()
+                .data_byte(0x01).ack();
+        // Release SDA and SCL so we can send another START
+        trace.add_event(BusEvent(1'000, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE));
+        trace.add_event(BusEvent(1'000, BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE | BusEventFlags::SDA_LINE_STATE));
+        builder.start_bit()
+                .address_byte(0x10, BusTraceBuilder::READ).ack()
+                .data_byte(0xFF).nack()
+                .stop_bit();
+
+        // WHEN we decode it
+        BusTraceDecoder decoder(MAX_FIELDS);
+        decoder.decode(trace);
+
+        // THEN the second START is a repeated START and the incomplete byte is discarded
+        const Type expected[] = {
+                Type::Start, Type::Address, Type::Ack, Type::Data, Type::Ack,
+                Type::RepeatedStart, Type::Address, Type::Ack, Type::Data, Type::Nack, Type::Stop
+        };
+        assert_types(expected, sizeof(expected) / sizeof(expected[0]), decoder);
+        TEST_ASSERT_EQUAL_UINT8(0x10, decoder.field(6)->value);
+        TEST_ASSERT_TRUE(decoder.field(6)->read);
+        TEST_ASSERT_EQUAL_UINT8(0xFF, decoder.field(8)->value);
+    }
+
+    static void ignores_bits_before_first_start() {
+        // GIVEN a trace that starts in the middle of a message
+        BusTrace trace(MAX_EVENTS);
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .data_byte(0x55).ack()
+                .stop_bit()
+                .start_bit()
+                .address_byte(0x22, BusTraceBuilder::WRITE).nack()
+                .stop_bit();
+
+        // WHEN we decode it
+        BusTraceDecoder decoder(MAX_FIELDS);
+        decoder.decode(trace);
+
+        // THEN only the complete message is decoded
+        const Type expected[] = {Type::Start, Type::Address, Type::Nack, Type::Stop};
+        assert_types(expected, sizeof(expected) / sizeof(expected[0]), decoder);
+        TEST_ASSERT_EQUAL_UINT8(0x22, decoder.field(1)->value);
+    }
+
+    static void handles_raw_recordings() {
+        // GIVEN a message
+        BusTrace message(MAX_EVENTS);
+        given_2_messages(message);
+        // AND a recording of it with spurious SDA edges and merged events
+        BusTrace recording(MAX_EVENTS);
+        for (size_t i = 0; i < message.event_count(); ++i) {
+            BusEvent event = *message.event(i);
+            const BusEvent* next = message.event(i + 1);
+            bool sda_only = event.flags == (event.flags & (BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE));
+            if (sda_only && (bool)(event.flags & BusEventFlags::SDA_LINE_CHANGED) && next && next->scl_rose()) {
+                // SDA changed while SCL was LOW. Merge the edge with the next SCL edge.
+                recording.add_event(BusEvent(event.delta_t_in_ticks, next->flags | BusEventFlags::SDA_LINE_CHANGED));
+                i++;
+            } else {
+                recording.add_event(event);
+                if (event.scl_fell()) {
+                    // Pulse SDA while SCL is LOW
+                    BusEventFlags sda_toggled = event.flags ^ BusEventFlags::SDA_LINE_STATE;
+                    recording.add_event(BusEvent(10, sda_toggled | BusEventFlags::SDA_LINE_CHANGED));
+                    recording.add_event(BusEvent(10, event.flags | BusEventFlags::SDA_LINE_CHANGED));
+                }
+            }
+        }
+
+        // WHEN we decode both of them
+        BusTraceDecoder expected(MAX_FIELDS);
+        expected.decode(message);
+        BusTraceDecoder actual(MAX_FIELDS);
+        actual.decode(recording);
+
+        // THEN they decode to the same message
+        TEST_ASSERT_EQUAL_UINT32(expected.field_count(), actual.field_count());
+        for (size_t i = 0; i < expected.field_count(); ++i) {
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)expected.field(i)->type, (uint8_t)actual.field(i)->type);
+            TEST_ASSERT_EQUAL_UINT8(expected.field(i)->value, actual.field(i)->value);
+            TEST_ASSERT_EQUAL(expected.field(i)->read, actual.field(i)->read);
+        }
+    }
+
+    static void add_event_matches_decode() {
+        // GIVEN a trace
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace);
+        BusTraceDecoder expected(MAX_FIELDS);
+        expected.decode(trace);
+
+        // WHEN we add the events one at a time
+        BusTraceDecoder actual(MAX_FIELDS);
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            actual.add_event(*trace.event(i));
+        }
+
+        // THEN we get the same fields
+        TEST_ASSERT_EQUAL_UINT32(expected.field_count(), actual.field_count());
+        for (size_t i = 0; i < expected.field_count(); ++i) {
+            TEST_ASSERT_TRUE(*expected.field(i) == *actual.field(i));
+        }
+    }
+
+    static void drops_fields_when_full() {
+        // GIVEN a decoder with room for 3 fields
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace);
+        DecodedField fields[3];
+        BusTraceDecoder decoder(fields, 3);
+
+        // WHEN we decode a trace with more fields than that
+        decoder.decode(trace);
+
+        // THEN the extra fields are dropped
+        TEST_ASSERT_EQUAL_UINT32(3, decoder.field_count());
+        TEST_ASSERT_EQUAL_UINT32(9, decoder.dropped_field_count());
+        TEST_ASSERT_NULL(decoder.field(3));
+
+        // WHEN we reset it
+        decoder.reset();
+
+        // THEN it's empty
+        TEST_ASSERT_EQUAL_UINT32(0, decoder.field_count());
+        TEST_ASSERT_EQUAL_UINT32(0, decoder.dropped_field_count());
+    }
+
+    static void print_fields() {
+        // GIVEN a decoded trace
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace);
+        BusTraceDecoder decoder(MAX_FIELDS);
+        decoder.decode(trace);
+
+        // WHEN we print it
+        FakeSerial serial;
+        size_t bytes_printed = decoder.printTo(serial);
+
+        // THEN each message is on its own line
+        String expected = "START 0x53 W ACK 0x58 ACK STOP\r\n";
+        expected       += "START 0x53 R ACK 0xA7 NACK STOP\r\n";
+        TEST_ASSERT_EQUAL(0, serial.strcmp(expected));
+        TEST_ASSERT_EQUAL_UINT32(expected.length(), bytes_printed);
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(decodes_messages);
+        RUN_TEST(fields_refer_to_trace_events);
+        RUN_TEST(repeated_start);
+        RUN_TEST(ignores_bits_before_first_start);
+        RUN_TEST(handles_raw_recordings);
+        RUN_TEST(add_event_matches_decode);
+        RUN_TEST(drops_fields_when_full);
+        RUN_TEST(print_fields);
+    }
+
+    BusTraceDecoderTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRACE_DECODER_TEST_H
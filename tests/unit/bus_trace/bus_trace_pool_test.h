@@ -0,0 +1,173 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRACE_POOL_TEST_H
+#define I2C_UNDERNEATH_BUS_TRACE_POOL_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "fakes/common/hal/fake_clock.h"
+#include "bus_trace/bus_trace_pool.h"
+
+namespace bus_trace {
+
+class BusTracePoolTest : public TestSuite {
+    static void add_events(BusTrace* trace, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            trace->add_event(BusEvent(10, SDA_LINE_CHANGED));
+        }
+    }
+
+    static void acquire_returns_empty_trace_with_clock() {
+        // GIVEN a pool
+        common::hal::FakeClock clock;
+        BusTracePool pool(&clock, 2, 5);
+
+        // WHEN we acquire a trace
+        BusTrace* trace = pool.acquire();
+
+        // THEN it's empty and uses the clock
+        TEST_ASSERT_NOT_NULL(trace);
+        TEST_ASSERT_EQUAL_UINT32(0, trace->event_count());
+        TEST_ASSERT_EQUAL_UINT32(5, trace->capacity());
+        add_events(trace, 2);
+        TEST_ASSERT_EQUAL_UINT32(10 * common::hal::FakeClock::nanos_per_tick, trace->nanos_to_previous(1));
+    }
+
+    static void acquire_returns_null_when_pool_empty() {
+        // GIVEN a pool where every trace is in use
+        BusTracePool pool(nullptr, 2, 5);
+        BusTrace* trace1 = pool.acquire();
+        BusTrace* trace2 = pool.acquire();
+        TEST_ASSERT_NOT_NULL(trace1);
+        TEST_ASSERT_NOT_NULL(trace2);
+        TEST_ASSERT_FALSE(trace1 == trace2);
+
+        // WHEN we try to acquire another trace
+        BusTrace* trace3 = pool.acquire();
+
+        // THEN it fails
+        TEST_ASSERT_NULL(trace3);
+        TEST_ASSERT_EQUAL_UINT32(1, pool.failed_acquire_count());
+    }
+
+    static void release_recycles_trace() {
+        // GIVEN a pool with a single trace that's been used
+        BusTracePool pool(nullptr, 1, 5);
+        BusTrace* trace = pool.acquire();
+        add_events(trace, 3);
+        trace->set_circular(true);
+        trace->enable_tick_index();
+
+        // WHEN we release it and acquire another trace
+        TEST_ASSERT_TRUE(pool.release(trace));
+        BusTrace* recycled = pool.acquire();
+
+        // THEN we get the same trace back but it's been reset
+        TEST_ASSERT_TRUE(recycled == trace);
+        TEST_ASSERT_EQUAL_UINT32(0, recycled->event_count());
+        TEST_ASSERT_FALSE(recycled->is_circular());
+        TEST_ASSERT_FALSE(recycled->has_tick_index());
+    }
+
+    static void release_rejects_moved_from_trace() {
+        // GIVEN a pool with a trace that's been moved from
+        BusTracePool pool(nullptr, 2, 5);
+        BusTrace* trace = pool.acquire();
+        add_events(trace, 3);
+        BusTrace moved(std::move(*trace));
+
+        // WHEN we release it
+        bool released = pool.release(trace);
+
+        // THEN it's rejected
+        TEST_ASSERT_FALSE(released);
+        // AND it's retired rather than still in use
+        TEST_ASSERT_EQUAL_UINT32(0, pool.traces_in_use());
+        TEST_ASSERT_EQUAL_UINT32(1, pool.retired_trace_count());
+        TEST_ASSERT_FALSE(pool.release(trace));
+        TEST_ASSERT_EQUAL_UINT32(1, pool.retired_trace_count());
+        // AND it's never handed out again
+        BusTrace* other = pool.acquire();
+        TEST_ASSERT_NOT_NULL(other);
+        TEST_ASSERT_TRUE(other != trace);
+        TEST_ASSERT_NULL(pool.acquire());
+        TEST_ASSERT_EQUAL_UINT32(1, pool.traces_in_use());
+        TEST_ASSERT_EQUAL_UINT32(1, pool.max_traces_in_use());
+    }
+
+    static void release_rejects_unknown_traces() {
+        // GIVEN a pool
+        BusTracePool pool(nullptr, 2, 5);
+        BusTrace* trace = pool.acquire();
+        BusTrace other(5);
+
+        // WHEN we release traces that aren't in use
+        // THEN they're rejected
+        TEST_ASSERT_FALSE(pool.release(&other));
+        TEST_ASSERT_FALSE(pool.release(nullptr));
+        TEST_ASSERT_TRUE(pool.release(trace));
+        TEST_ASSERT_FALSE(pool.release(trace));
+        TEST_ASSERT_EQUAL_UINT32(0, pool.traces_in_use());
+    }
+
+    static void pool_uses_supplied_events() {
+        // GIVEN a pool that uses our memory
+        BusEvent events[2 * 4];
+        BusTracePool pool(nullptr, events, 2, 4);
+
+        // WHEN we add events to both traces
+        BusTrace* trace1 = pool.acquire();
+        BusTrace* trace2 = pool.acquire();
+        trace1->add_event(BusEvent(1, SDA_LINE_CHANGED));
+        trace2->add_event(BusEvent(2, SCL_LINE_CHANGED));
+
+        // THEN they're stored in separate parts of the memory
+        TEST_ASSERT_TRUE(trace1->event(0) == &events[0]);
+        TEST_ASSERT_TRUE(trace2->event(0) == &events[4]);
+        TEST_ASSERT_EQUAL_UINT32(1, events[0].delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT32(2, events[4].delta_t_in_ticks);
+    }
+
+    static void pool_records_high_water_marks() {
+        // GIVEN a pool
+        BusTracePool pool(nullptr, 3, 5);
+
+        // WHEN we use some of the traces
+        BusTrace* trace1 = pool.acquire();
+        BusTrace* trace2 = pool.acquire();
+        add_events(trace1, 4);
+        add_events(trace2, 2);
+        pool.release(trace1);
+        pool.release(trace2);
+        BusTrace* trace3 = pool.acquire();
+
+        // THEN the pool reports the most it used
+        TEST_ASSERT_EQUAL_UINT32(1, pool.traces_in_use());
+        TEST_ASSERT_EQUAL_UINT32(2, pool.max_traces_in_use());
+        TEST_ASSERT_EQUAL_UINT32(4, pool.max_events_used());
+
+        // AND resetting the statistics keeps the traces in use
+        pool.reset_statistics();
+        TEST_ASSERT_EQUAL_UINT32(1, pool.max_traces_in_use());
+        TEST_ASSERT_EQUAL_UINT32(0, pool.max_events_used());
+        pool.release(trace3);
+    }
+
+public:
+    void test() final {
+        RUN_TEST(acquire_returns_empty_trace_with_clock);
+        RUN_TEST(acquire_returns_null_when_pool_empty);
+        RUN_TEST(release_recycles_trace);
+        RUN_TEST(release_rejects_unknown_traces);
+        RUN_TEST(release_rejects_moved_from_trace);
+        RUN_TEST(pool_uses_supplied_events);
+        RUN_TEST(pool_records_high_water_marks);
+    }
+
+    BusTracePoolTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRACE_POOL_TEST_H
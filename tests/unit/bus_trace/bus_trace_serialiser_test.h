@@ -0,0 +1,190 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRACE_SERIALISER_TEST_H
+#define I2C_UNDERNEATH_BUS_TRACE_SERIALISER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "utils/bus_trace_fixtures.h"
+#include "fakes/fake_stream.h"
+#include "fakes/common/hal/fake_clock.h"
+#include "common/hal/fixed_rate_clock.h"
+#include "bus_trace/bus_trace_serialiser.h"
+
+namespace bus_trace {
+
+class BusTraceSerialiserTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+
+    // Collects the bytes written to it.
+    class ByteSink : public Print {
+    public:
+        size_t write(uint8_t b) override {
+            if (size < sizeof(data)) {
+                data[size++] = b;
+                return 1;
+            }
+            return 0;
+        }
+
+        using Print::write;
+
+        uint8_t data[MAX_EVENTS * BusTraceSerialiser::EVENT_SIZE + BusTraceSerialiser::HEADER_SIZE] = {};
+        size_t size = 0;
+    };
+
+    // Messages followed by an event with the largest possible delta
+    static void given_messages_and_long_delta(BusTrace& trace) {
+        given_messages(trace);
+        trace.add_event(BusEvent(UINT16_MAX, BusEventFlags::SDA_PIN_CHANGED | BusEventFlags::SDA_LINE_STATE));
+    }
+
+public:
+    static void write_header() {
+        // GIVEN a trace with a clock
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.add_event(BusEvent(0x1234, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+
+        // WHEN we write it
+        ByteSink sink;
+        size_t count = BusTraceSerialiser::write(trace, sink, BusTraceHeader::PIN_EVENTS);
+
+        // THEN the output matches the documented format
+        const uint8_t expected[] = {
+                'I', '2', 'C', 'T', 1, BusTraceHeader::PIN_EVENTS, 0, 0,
+                0x00, 0x65, 0xCD, 0x1D,     // 500 MHz
+                1, 0, 0, 0,                 // 1 event
+                0x34, 0x12, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE, 0
+        };
+        TEST_ASSERT_EQUAL_UINT32(sizeof(expected), count);
+        TEST_ASSERT_EQUAL_UINT32(sizeof(expected), sink.size);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sink.data, sizeof(expected));
+    }
+
+    static void round_trip() {
+        // GIVEN a trace that's been written
+        common::hal::FakeClock clock;
+        BusTrace expected(&clock, MAX_EVENTS);
+        given_messages_and_long_delta(expected);
+        ByteSink sink;
+        BusTraceSerialiser::write(expected, sink);
+
+        // WHEN we read it again
+        BusTrace actual(MAX_EVENTS);
+        BusTraceHeader header;
+        bool ok = BusTraceSerialiser::read(sink.data, sink.size, actual, &header);
+
+        // THEN it's identical to the original
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(actual));
+        TEST_ASSERT_EQUAL_UINT8(BusTraceSerialiser::VERSION, header.version);
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), header.event_count);
+        TEST_ASSERT_EQUAL_UINT32(500'000'000, header.ticks_per_second);
+        TEST_ASSERT_FALSE(header.has_pin_events());
+    }
+
+    static void round_trip_through_stream() {
+        // GIVEN a trace that's been written
+        BusTrace expected(MAX_EVENTS);
+        given_messages_and_long_delta(expected);
+        ByteSink sink;
+        BusTraceSerialiser::write(expected, sink);
+
+        // WHEN we read it from a stream
+        FakeStream stream(sink.data, sink.size);
+        BusTrace actual(MAX_EVENTS);
+        bool ok = BusTraceSerialiser::read(stream, actual);
+
+        // THEN it's identical to the original
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(actual));
+    }
+
+    static void circular_trace_is_written_in_order() {
+        // GIVEN a circular trace that has overwritten some events
+        BusTrace trace(3);
+        trace.set_circular(true);
+        for (uint16_t i = 1; i <= 5; ++i) {
+            trace.add_event(BusEvent(i, BusEventFlags::SCL_LINE_CHANGED));
+        }
+
+        // WHEN we write and read it
+        ByteSink sink;
+        BusTraceSerialiser::write(trace, sink);
+        BusTrace actual(MAX_EVENTS);
+        BusTraceSerialiser::read(sink.data, sink.size, actual);
+
+        // THEN we get the oldest event first
+        TEST_ASSERT_EQUAL_UINT32(3, actual.event_count());
+        TEST_ASSERT_EQUAL_UINT16(3, actual.event(0)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT16(5, actual.event(2)->delta_t_in_ticks);
+    }
+
+    static void rejects_invalid_data() {
+        // GIVEN a valid serialised trace
+        BusTrace trace(MAX_EVENTS);
+        given_messages_and_long_delta(trace);
+        ByteSink sink;
+        BusTraceSerialiser::write(trace, sink);
+        BusTrace actual(MAX_EVENTS);
+
+        // THEN it's rejected if it's truncated
+        TEST_ASSERT_FALSE(BusTraceSerialiser::read(sink.data, BusTraceSerialiser::HEADER_SIZE - 1, actual));
+        TEST_ASSERT_FALSE(BusTraceSerialiser::read(sink.data, sink.size - 1, actual));
+        FakeStream stream(sink.data, sink.size - 1);
+        TEST_ASSERT_FALSE(BusTraceSerialiser::read(stream, actual));
+
+        // AND it's rejected if the magic number is wrong
+        sink.data[0] = 'X';
+        TEST_ASSERT_FALSE(BusTraceSerialiser::read(sink.data, sink.size, actual));
+    }
+
+    static void clock_rate_is_0_without_a_clock() {
+        // GIVEN a trace without a clock
+        BusTrace trace(MAX_EVENTS);
+
+        // WHEN we write it
+        ByteSink sink;
+        BusTraceSerialiser::write(trace, sink);
+
+        // THEN the clock rate is unknown
+        BusTraceHeader header;
+        TEST_ASSERT_TRUE(BusTraceSerialiser::read_header(sink.data, sink.size, header));
+        TEST_ASSERT_EQUAL_UINT32(0, header.ticks_per_second);
+        TEST_ASSERT_EQUAL_UINT32(0, header.event_count);
+    }
+
+    static void writes_rate_of_slow_clock() {
+        // GIVEN a trace with a slow clock whose rate isn't a whole number of kHz
+        common::hal::FixedRateClock clock(32'768);
+        BusTrace trace(&clock, MAX_EVENTS);
+
+        // WHEN we write it
+        ByteSink sink;
+        BusTraceSerialiser::write(trace, sink);
+
+        // THEN the header has the exact clock rate
+        BusTraceHeader header;
+        TEST_ASSERT_TRUE(BusTraceSerialiser::read_header(sink.data, sink.size, header));
+        TEST_ASSERT_EQUAL_UINT32(32'768, header.ticks_per_second);
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(write_header);
+        RUN_TEST(round_trip);
+        RUN_TEST(round_trip_through_stream);
+        RUN_TEST(circular_trace_is_written_in_order);
+        RUN_TEST(rejects_invalid_data);
+        RUN_TEST(clock_rate_is_0_without_a_clock);
+        RUN_TEST(writes_rate_of_slow_clock);
+    }
+
+    BusTraceSerialiserTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRACE_SERIALISER_TEST_H
@@ -6,6 +6,8 @@
 
 #include <unity.h>
 #include <Arduino.h>
+#include <utility>
+#include <vector>
 #include "utils/test_suite.h"
 #include "fakes/common/hal/fake_clock.h"
 #include "fakes/fake_serial.h"
@@ -156,6 +158,111 @@ public:
         TEST_ASSERT_EQUAL_UINT32(1, trace.event_count());
         TEST_ASSERT_NULL(trace.event(1));
         TEST_ASSERT_TRUE(event == *trace.event(0));
+
+        // AND the trace counts it
+        TEST_ASSERT_EQUAL_UINT32(1, trace.dropped_event_count());
+    }
+
+    static void time_extension_is_dropped_with_its_event() {
+        // GIVEN a trace with room for 1 more event
+        BusTrace trace(2);
+        trace.add_event(10, BusEventFlags::SDA_LINE_CHANGED);
+
+        // WHEN we add an event that needs a time extension
+        trace.add_event(10 + 100'000, BusEventFlags::SCL_LINE_CHANGED);
+
+        // THEN neither the event nor the extension is added
+        TEST_ASSERT_EQUAL_UINT32(1, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(1, trace.dropped_event_count());
+        // AND the overflow isn't counted as the event wasn't stored
+        TEST_ASSERT_EQUAL_UINT32(0, trace.delta_overflow_count());
+
+        // WHEN we add an event that needs a time extension to a trace with room for it
+        trace.reset();
+        trace.add_event_with_delta(100'000, BusEventFlags::SCL_LINE_CHANGED);
+        TEST_ASSERT_EQUAL_UINT32(1, trace.delta_overflow_count());
+
+        // AND reset() clears the counts
+        trace.reset();
+        TEST_ASSERT_EQUAL_UINT32(0, trace.dropped_event_count());
+        TEST_ASSERT_EQUAL_UINT32(0, trace.delta_overflow_count());
+    }
+
+    static void circular_trace_overwrites_oldest_events() {
+        // GIVEN a circular trace which is full
+        size_t max_event_count = 3;
+        BusEvent events[max_event_count];
+        BusTrace trace(events, max_event_count);
+        trace.set_circular(true);
+        trace.add_event(BusEvent(1, BusEventFlags::SCL_LINE_CHANGED));
+        trace.add_event(BusEvent(2, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(3, BusEventFlags::SCL_LINE_STATE));
+        TEST_ASSERT_EQUAL_UINT32(0, trace.overwritten_event_count());
+
+        // WHEN we record more events
+        trace.add_event(BusEvent(4, BusEventFlags::SDA_LINE_STATE));
+        trace.add_event(BusEvent(5, BusEventFlags::BOTH_LOW_AND_UNCHANGED));
+
+        // THEN the oldest events are overwritten
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(2, trace.overwritten_event_count());
+        // AND the remaining events are returned in the order they were recorded
+        TEST_ASSERT_TRUE(BusEvent(3, BusEventFlags::SCL_LINE_STATE) == *trace.event(0));
+        TEST_ASSERT_TRUE(BusEvent(4, BusEventFlags::SDA_LINE_STATE) == *trace.event(1));
+        TEST_ASSERT_TRUE(BusEvent(5, BusEventFlags::BOTH_LOW_AND_UNCHANGED) == *trace.event(2));
+        TEST_ASSERT_NULL(trace.event(3));
+    }
+
+    static void circular_trace_calculates_times_in_logical_order() {
+        // GIVEN a circular trace which has wrapped round
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, 3);
+        trace.set_circular(true);
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(200, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(300, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(400, BusEventFlags::SDA_LINE_CHANGED));
+
+        // WHEN we get the durations between events
+        // THEN the results match the remaining events
+        TEST_ASSERT_EQUAL_UINT32(400*clock.nanos_per_tick, trace.nanos_to_previous(2));
+        TEST_ASSERT_EQUAL_UINT32(700*clock.nanos_per_tick, trace.nanos_between(2, 0));
+    }
+
+    static void circular_trace_keeps_time_extension_at_start() {
+        // GIVEN a circular trace whose oldest event is a time extension
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, 2);
+        trace.set_circular(true);
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event_with_delta(0x12345, BusEventFlags::SCL_LINE_CHANGED);
+        TEST_ASSERT_TRUE(trace.event(0)->is_time_extension());
+
+        // WHEN we get the time to the previous event
+        uint32_t actual = trace.nanos_to_previous(1);
+
+        // THEN it includes the time extension
+        TEST_ASSERT_EQUAL_UINT32(0x12345*clock.nanos_per_tick, actual);
+    }
+
+    static void reset_clears_overwritten_event_count() {
+        // GIVEN a circular trace which has overwritten some events
+        BusTrace trace(2);
+        trace.set_circular(true);
+        trace.add_event(BusEvent(1, BusEventFlags::SCL_LINE_CHANGED));
+        trace.add_event(BusEvent(2, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(3, BusEventFlags::SCL_LINE_CHANGED));
+
+        // WHEN we reset the trace
+        trace.reset();
+        trace.add_event(BusEvent(4, BusEventFlags::SDA_LINE_CHANGED));
+
+        // THEN the trace starts again from the beginning
+        TEST_ASSERT_EQUAL_UINT32(0, trace.overwritten_event_count());
+        TEST_ASSERT_EQUAL_UINT32(1, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(4, BusEventFlags::SDA_LINE_CHANGED) == *trace.event(0));
+        // AND it's still circular
+        TEST_ASSERT_TRUE(trace.is_circular());
     }
 
     static void reset() {
@@ -172,8 +279,10 @@ public:
 
         // THEN the event count was reset
         TEST_ASSERT_EQUAL(1, trace.event_count());
+#if defined(ARDUINO_TEENSY40) || defined(ARDUINO_TEENSY41)
         // AND the delta to the next event starts from 0 again
         TEST_ASSERT_UINT32_WITHIN(2, 6, trace.event(0)->delta_t_in_ticks);
+#endif
     }
 
     static void destructor_does_not_deletes_supplied_array_of_events() {
@@ -187,6 +296,123 @@ public:
         delete(trace);
     }
 
+    static void move_constructor_takes_the_events() {
+        // GIVEN a trace with a tick index
+        common::hal::FakeClock clock;
+        BusTrace original(&clock, MAX_EVENTS);
+        original.enable_tick_index();
+        original.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        original.add_event(BusEvent(200, BusEventFlags::SCL_LINE_CHANGED));
+        const BusEvent* events = original.event(0);
+
+        // WHEN we move it
+        BusTrace moved(std::move(original));
+
+        // THEN the new trace has the same events without copying them
+        TEST_ASSERT_EQUAL_UINT32(2, moved.event_count());
+        TEST_ASSERT_EQUAL_UINT32(MAX_EVENTS, moved.capacity());
+        TEST_ASSERT_TRUE(events == moved.event(0));
+        TEST_ASSERT_TRUE(moved.has_tick_index());
+        TEST_ASSERT_EQUAL_UINT32(200*clock.nanos_per_tick, moved.nanos_between(1, 0));
+        // AND the original is empty and has no space for events
+        TEST_ASSERT_EQUAL_UINT32(0, original.event_count());
+        TEST_ASSERT_EQUAL_UINT32(0, original.capacity());
+        TEST_ASSERT_FALSE(original.has_tick_index());
+        original.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        TEST_ASSERT_EQUAL_UINT32(0, original.event_count());
+    }
+
+    static void move_assignment_frees_existing_events() {
+        // GIVEN 2 traces
+        BusTrace trace1(MAX_EVENTS);
+        trace1.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        BusTrace trace2(3);
+        trace2.add_event(BusEvent(5, BusEventFlags::SCL_LINE_CHANGED));
+        trace2.add_event(BusEvent(6, BusEventFlags::SCL_LINE_CHANGED));
+
+        // WHEN one is moved to the other
+        trace1 = std::move(trace2);
+
+        // THEN the events are replaced
+        TEST_ASSERT_EQUAL_UINT32(2, trace1.event_count());
+        TEST_ASSERT_EQUAL_UINT32(3, trace1.capacity());
+        TEST_ASSERT_TRUE(*trace1.event(1) == BusEvent(6, BusEventFlags::SCL_LINE_CHANGED));
+        TEST_ASSERT_EQUAL_UINT32(0, trace2.event_count());
+    }
+
+    static void traces_can_be_stored_in_containers() {
+        // GIVEN a vector of traces
+        std::vector<BusTrace> traces;
+
+        // WHEN we add enough traces to make the vector reallocate
+        for (uint16_t i = 0; i < 20; ++i) {
+            traces.emplace_back(4);
+            traces.back().add_event(BusEvent(i, BusEventFlags::SDA_LINE_CHANGED));
+        }
+
+        // THEN every trace keeps its events
+        for (uint16_t i = 0; i < 20; ++i) {
+            TEST_ASSERT_EQUAL_UINT16(i, traces[i].event(0)->delta_t_in_ticks);
+        }
+    }
+
+    static void reserve_keeps_events_in_order() {
+        // GIVEN a circular trace that has overwritten some events
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, 3);
+        trace.set_circular(true);
+        trace.enable_tick_index();
+        for (uint16_t i = 1; i <= 5; ++i) {
+            trace.add_event(BusEvent(i, BusEventFlags::SDA_LINE_CHANGED));
+        }
+        TEST_ASSERT_EQUAL_UINT32(9*clock.nanos_per_tick, trace.nanos_between(2, 0));
+
+        // WHEN we increase its capacity
+        bool ok = trace.reserve(10);
+
+        // THEN the oldest events are still first
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(10, trace.capacity());
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT16(3, trace.event(0)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT16(5, trace.event(2)->delta_t_in_ticks);
+        // AND new events are added rather than overwriting the old ones
+        trace.add_event(BusEvent(6, BusEventFlags::SDA_LINE_CHANGED));
+        TEST_ASSERT_EQUAL_UINT32(4, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(15*clock.nanos_per_tick, trace.nanos_between(3, 0));
+
+        // AND reserve never reduces the capacity
+        TEST_ASSERT_TRUE(trace.reserve(2));
+        TEST_ASSERT_EQUAL_UINT32(10, trace.capacity());
+    }
+
+    static void shrink_to_fit_removes_spare_capacity() {
+        // GIVEN a trace with spare capacity
+        BusTrace trace(MAX_EVENTS);
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(200, BusEventFlags::SCL_LINE_CHANGED));
+
+        // WHEN we shrink it
+        bool ok = trace.shrink_to_fit();
+
+        // THEN it only has space for the existing events
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(2, trace.capacity());
+        TEST_ASSERT_TRUE(*trace.event(1) == BusEvent(200, BusEventFlags::SCL_LINE_CHANGED));
+    }
+
+    static void cannot_resize_supplied_array_of_events() {
+        // GIVEN a trace that doesn't own its events
+        BusEvent events[MAX_EVENTS];
+        BusTrace trace(events, MAX_EVENTS);
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+
+        // THEN it can't be resized
+        TEST_ASSERT_FALSE(trace.reserve(MAX_EVENTS * 2));
+        TEST_ASSERT_FALSE(trace.shrink_to_fit());
+        TEST_ASSERT_EQUAL_UINT32(MAX_EVENTS, trace.capacity());
+    }
+
     static void empty_traces_are_identical() {
         // GIVEN 2 traces with different capacities
         BusTrace trace1(MAX_EVENTS);
@@ -415,11 +641,11 @@ public:
 
         BusTrace expected(MAX_EVENTS);
         // THEN the start event for the data bit is split so SDA rises when SCL is LOW
-        expected.add_event(10, SDA_LINE_CHANGED | SDA_LINE_STATE);
-        expected.add_event(0, SCL_LINE_CHANGED | SCL_LINE_STATE | SDA_LINE_STATE);
+        expected.add_event(BusEvent(10, SDA_LINE_CHANGED | SDA_LINE_STATE));
+        expected.add_event(BusEvent(0, SCL_LINE_CHANGED | SCL_LINE_STATE | SDA_LINE_STATE));
         // AND the end event for the data bit is split so SDA falls when SCL is LOW
-        expected.add_event(20, SCL_LINE_CHANGED | SDA_LINE_STATE);
-        expected.add_event(0, SDA_LINE_CHANGED);
+        expected.add_event(BusEvent(10, SCL_LINE_CHANGED | SDA_LINE_STATE));
+        expected.add_event(BusEvent(0, SDA_LINE_CHANGED));
 //        Serial.println("Expected:");
 //        Serial.println(expected);
 //        Serial.println("Got:");
@@ -563,6 +789,22 @@ public:
         TEST_ASSERT_EQUAL_UINT32(39, equivalent);
     }
 
+    static void compare_messages_returns_length_of_shorter_message() {
+        // GIVEN a message
+        BusTrace trace(MAX_EVENTS);
+        add_simple_message(trace);
+        // AND the same message with a merged event and an extra edge at the end
+        BusTrace longer(MAX_EVENTS);
+        add_simple_message(longer);
+        longer.add_event(BusEvent(10, SCL_LINE_CHANGED | SDA_LINE_CHANGED));
+        size_t message_length = trace.to_message().event_count();
+
+        // WHEN we compare them
+        // THEN the difference is where the shorter message ends
+        TEST_ASSERT_EQUAL_UINT32(message_length, trace.compare_messages(longer));
+        TEST_ASSERT_EQUAL_UINT32(message_length, longer.compare_messages(trace));
+    }
+
     static void message_comparable_does_not_ignore_SDA_changes_while_SCL_is_HIGH() {
         // GIVEN 2 traces which are edge comparable.
         BusEvent events1[MAX_EVENTS];
@@ -770,6 +1012,103 @@ public:
         TEST_ASSERT_EQUAL_UINT32(50*clock.nanos_per_tick, actual);
     }
 
+    static void nanos_between_with_tick_index() {
+        // GIVEN a trace with a tick index
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.enable_tick_index();
+        TEST_ASSERT_TRUE(trace.has_tick_index());
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(200, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(50, BusEventFlags::SDA_LINE_CHANGED));
+
+        // WHEN we get durations between events
+        // THEN the results are the same as without the index
+        TEST_ASSERT_EQUAL_UINT32(250*clock.nanos_per_tick, trace.nanos_between(2, 0));
+        TEST_ASSERT_EQUAL_UINT32(50*clock.nanos_per_tick, trace.nanos_between(2, 1));
+        TEST_ASSERT_EQUAL_UINT32(0, trace.nanos_between(1, 1));
+        TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, trace.nanos_between(3, 0));
+
+        // AND the index is extended when more events arrive
+        trace.add_event(BusEvent(300, BusEventFlags::SDA_LINE_CHANGED));
+        TEST_ASSERT_EQUAL_UINT32(550*clock.nanos_per_tick, trace.nanos_between(3, 0));
+    }
+
+    static void tick_index_is_rebuilt_after_reset_and_overwrites() {
+        // GIVEN a circular trace with a tick index
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, 3);
+        trace.set_circular(true);
+        trace.enable_tick_index();
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(200, BusEventFlags::SDA_LINE_CHANGED));
+        TEST_ASSERT_EQUAL_UINT32(200*clock.nanos_per_tick, trace.nanos_between(1, 0));
+
+        // WHEN the oldest events are overwritten
+        trace.add_event(BusEvent(300, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(400, BusEventFlags::SDA_LINE_CHANGED));
+
+        // THEN the index matches the remaining events
+        TEST_ASSERT_EQUAL_UINT32(700*clock.nanos_per_tick, trace.nanos_between(2, 0));
+
+        // AND it's rebuilt after the trace is reset
+        trace.reset();
+        trace.add_event(BusEvent(10, BusEventFlags::SDA_LINE_CHANGED));
+        trace.add_event(BusEvent(20, BusEventFlags::SDA_LINE_CHANGED));
+        TEST_ASSERT_EQUAL_UINT32(20*clock.nanos_per_tick, trace.nanos_between(1, 0));
+    }
+
+    static void add_event_records_long_gaps_with_time_extension() {
+        // GIVEN a trace
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.add_event(1'000, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE);
+
+        // WHEN we add events that are too far apart for a BusEvent
+        trace.add_event(1'000 + 100'000, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE);
+        trace.add_event(1'000 + 100'000 + 1'000'000, BusEventFlags::SCL_LINE_CHANGED);
+        trace.add_event(1'000 + 100'000 + 1'000'000 + 65'535, BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE);
+
+        // THEN each long gap is preceded by a time extension
+        TEST_ASSERT_EQUAL_UINT32(6, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(2, trace.delta_overflow_count());
+        TEST_ASSERT_TRUE(trace.event(1)->is_time_extension());
+        TEST_ASSERT_FALSE(trace.event(2)->is_time_extension());
+        TEST_ASSERT_TRUE(trace.event(3)->is_time_extension());
+        TEST_ASSERT_FALSE(trace.event(4)->is_time_extension());
+        TEST_ASSERT_FALSE(trace.event(5)->is_time_extension());
+
+        // AND the timings are exact
+        TEST_ASSERT_EQUAL_UINT32(100'000*clock.nanos_per_tick, trace.nanos_to_previous(2));
+        TEST_ASSERT_EQUAL_UINT32(1'000'000*clock.nanos_per_tick, trace.nanos_to_previous(4));
+        TEST_ASSERT_EQUAL_UINT32(65'535*clock.nanos_per_tick, trace.nanos_to_previous(5));
+        TEST_ASSERT_EQUAL_UINT32(1'165'535*clock.nanos_per_tick, trace.nanos_between(5, 0));
+        trace.enable_tick_index();
+        TEST_ASSERT_EQUAL_UINT32(1'165'535*clock.nanos_per_tick, trace.nanos_between(5, 0));
+        TEST_ASSERT_EQUAL_UINT32(1'065'535*clock.nanos_per_tick, trace.nanos_between(5, 2));
+    }
+
+    static void to_message_removes_time_extensions() {
+        // GIVEN a message with a long gap in it
+        BusTrace expected(MAX_EVENTS);
+        add_simple_message(expected);
+        BusTrace trace(MAX_EVENTS);
+        for (size_t i = 0; i < expected.event_count(); ++i) {
+            if (i == 10) {
+                trace.add_event(BusEvent::time_extension(200'000, expected.event(i)->flags));
+            }
+            trace.add_event(*expected.event(i));
+        }
+
+        // WHEN we convert it to a message
+        BusTrace message = trace.to_message();
+
+        // THEN the time extension is removed
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count() + 1, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, message.compare_edges(expected.to_message()));
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, trace.compare_messages(expected));
+    }
+
     // Include all the tests here
     void test() final {
         RUN_TEST(max_events_required_without_pin_events);
@@ -784,9 +1123,20 @@ public:
         RUN_TEST(add_event_is_fast_enough_on_a_teensy4);
         RUN_TEST(add_event_gets_system_tick_from_clock);
         RUN_TEST(add_event_drops_excess_events);
+        RUN_TEST(time_extension_is_dropped_with_its_event);
+        RUN_TEST(circular_trace_overwrites_oldest_events);
+        RUN_TEST(circular_trace_calculates_times_in_logical_order);
+        RUN_TEST(circular_trace_keeps_time_extension_at_start);
+        RUN_TEST(reset_clears_overwritten_event_count);
         RUN_TEST(reset);
         RUN_TEST(destructor_does_not_deletes_supplied_array_of_events);
         RUN_TEST(destructor_deletes_internal_array_of_events_if_it_owns_them);
+        RUN_TEST(move_constructor_takes_the_events);
+        RUN_TEST(move_assignment_frees_existing_events);
+        RUN_TEST(traces_can_be_stored_in_containers);
+        RUN_TEST(reserve_keeps_events_in_order);
+        RUN_TEST(shrink_to_fit_removes_spare_capacity);
+        RUN_TEST(cannot_resize_supplied_array_of_events);
 
         // is_identical_to
         RUN_TEST(empty_traces_are_identical);
@@ -814,6 +1164,7 @@ public:
         RUN_TEST(traces_are_message_comparable_if_they_are_edge_comparable);
         RUN_TEST(traces_are_message_comparable_even_if_spurious_SDA_changes_are_different);
         RUN_TEST(compare_messages_returns_index_of_first_difference);
+        RUN_TEST(compare_messages_returns_length_of_shorter_message);
         RUN_TEST(message_comparable_does_not_ignore_SDA_changes_while_SCL_is_HIGH);
 
         // duration between events
@@ -827,6 +1178,10 @@ public:
         RUN_TEST(nanos_between_without_a_clock);
         RUN_TEST(nanos_between_all_events);
         RUN_TEST(nanos_between);
+        RUN_TEST(nanos_between_with_tick_index);
+        RUN_TEST(tick_index_is_rebuilt_after_reset_and_overwrites);
+        RUN_TEST(add_event_records_long_gaps_with_time_extension);
+        RUN_TEST(to_message_removes_time_extensions);
 
         RUN_TEST(print_trace);
     }
@@ -0,0 +1,171 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BUS_TRIGGER_TEST_H
+#define I2C_UNDERNEATH_BUS_TRIGGER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "utils/bus_trace_fixtures.h"
+#include "bus_trace/bus_trigger.h"
+
+namespace bus_trace {
+
+class BusTriggerTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+
+    // Returns the number of events that fired the trigger
+    static size_t count_triggers(const BusTrace& trace, BusTrigger& trigger) {
+        size_t fired = 0;
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            const BusEvent* event = trace.event(i);
+            if (trigger.add_event(event->delta_t_in_ticks, event->flags)) {
+                fired++;
+            }
+        }
+        return fired;
+    }
+
+public:
+    static void does_not_fire_without_conditions() {
+        // GIVEN a trigger without any conditions
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace, 0x10);
+        BusTrigger trigger;
+
+        // WHEN it sees some messages
+        size_t fired = count_triggers(trace, trigger);
+
+        // THEN it never fires
+        TEST_ASSERT_EQUAL_UINT32(0, fired);
+    }
+
+    static void fires_on_start() {
+        // GIVEN a trigger on START
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace, 0x10);
+        BusTrigger trigger;
+        trigger.on_start();
+
+        // WHEN it sees 2 messages
+        size_t fired = count_triggers(trace, trigger);
+
+        // THEN it fires once for each message
+        TEST_ASSERT_EQUAL_UINT32(2, fired);
+    }
+
+    static void fires_on_matching_address() {
+        // GIVEN a trigger on the address of the second message
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace, 0x10);
+        BusTrigger trigger;
+        trigger.on_address(0x10);
+
+        // WHEN it sees both messages
+        size_t fired = count_triggers(trace, trigger);
+
+        // THEN it only fires for the second message
+        TEST_ASSERT_EQUAL_UINT32(1, fired);
+    }
+
+    static void fires_on_nack() {
+        // GIVEN a trigger on NACK
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace, 0x10);
+        BusTrigger trigger;
+        trigger.on_nack();
+
+        // WHEN it sees a read that ends with a NACK
+        size_t fired = count_triggers(trace, trigger);
+
+        // THEN it fires once
+        TEST_ASSERT_EQUAL_UINT32(1, fired);
+    }
+
+    static void combines_conditions() {
+        // GIVEN a trigger on START or NACK
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace, 0x10);
+        BusTrigger trigger;
+        trigger.on_start().on_nack();
+
+        // WHEN it sees both messages
+        size_t fired = count_triggers(trace, trigger);
+
+        // THEN it fires for either condition
+        TEST_ASSERT_EQUAL_UINT32(3, fired);
+    }
+
+    static void fires_when_scl_held_low() {
+        // GIVEN a trigger on SCL being held LOW for 10 microseconds by a 1 MHz clock
+        BusTrigger trigger;
+        trigger.on_scl_held_low(10'000, 1'000'000);
+        const BusEventFlags idle = SDA_LINE_STATE | SCL_LINE_STATE;
+
+        // WHEN SCL is LOW for 9 ticks
+        TEST_ASSERT_FALSE(trigger.add_event(0, idle));
+        TEST_ASSERT_FALSE(trigger.add_event(5, SCL_LINE_CHANGED | SDA_LINE_STATE));
+        TEST_ASSERT_FALSE(trigger.add_event(4, SDA_LINE_CHANGED));
+
+        // THEN it doesn't fire when SCL rises
+        TEST_ASSERT_FALSE(trigger.add_event(5, SCL_LINE_CHANGED | SCL_LINE_STATE));
+
+        // WHEN SCL is LOW for 10 ticks
+        TEST_ASSERT_FALSE(trigger.add_event(5, SCL_LINE_CHANGED));
+
+        // THEN it fires when SCL rises
+        TEST_ASSERT_TRUE(trigger.add_event(10, SCL_LINE_CHANGED | SCL_LINE_STATE));
+    }
+
+    static void fires_on_glitch() {
+        // GIVEN a trigger on glitches
+        BusTrigger trigger;
+        trigger.on_glitch();
+        TEST_ASSERT_FALSE(trigger.add_event(0, SDA_LINE_STATE | SCL_LINE_STATE));
+        TEST_ASSERT_FALSE(trigger.add_event(100, SCL_LINE_CHANGED | SDA_LINE_STATE));
+
+        // WHEN the recorder reports a glitch on SDA
+        // i.e. 2 changes to the same line with the same timestamp
+        bool first = trigger.add_event(100, SDA_LINE_CHANGED);
+        bool second = trigger.add_event(0, SDA_LINE_CHANGED | SDA_LINE_STATE);
+
+        // THEN it fires on the second half of the glitch
+        TEST_ASSERT_FALSE(first);
+        TEST_ASSERT_TRUE(second);
+    }
+
+    static void reset_forgets_the_bus_state() {
+        // GIVEN a trigger that has seen half an address
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace, 0x10);
+        BusTrigger trigger;
+        trigger.on_address(0x53);
+        for (size_t i = 0; i < 8; ++i) {
+            trigger.add_event(trace.event(i)->delta_t_in_ticks, trace.event(i)->flags);
+        }
+
+        // WHEN it's reset and sees the whole trace
+        trigger.reset();
+        size_t fired = count_triggers(trace, trigger);
+
+        // THEN it keeps its conditions and fires on the address
+        TEST_ASSERT_EQUAL_UINT32(1, fired);
+    }
+
+    void test() final {
+        RUN_TEST(does_not_fire_without_conditions);
+        RUN_TEST(fires_on_start);
+        RUN_TEST(fires_on_matching_address);
+        RUN_TEST(fires_on_nack);
+        RUN_TEST(combines_conditions);
+        RUN_TEST(fires_when_scl_held_low);
+        RUN_TEST(fires_on_glitch);
+        RUN_TEST(reset_forgets_the_bus_state);
+    }
+
+    BusTriggerTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BUS_TRIGGER_TEST_H
@@ -0,0 +1,189 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_BYTE_DECODER_TEST_H
+#define I2C_UNDERNEATH_BYTE_DECODER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "utils/bus_trace_fixtures.h"
+#include "bus_trace/bus_trace_builder.h"
+#include "bus_trace/bus_trace_decoder.h"
+#include "bus_trace/byte_decoder.h"
+
+namespace bus_trace {
+
+class ByteDecoderTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+    static const size_t MAX_BYTES = 32;
+    typedef DecodedByte::Type Type;
+
+    static void decode(const BusTrace& trace, ByteDecoder& decoder) {
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            decoder.add_event(trace.event(i)->flags);
+        }
+    }
+
+    static void assert_byte(Type expected_type, uint8_t expected_value, const DecodedByte* actual) {
+        TEST_ASSERT_NOT_NULL(actual);
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)expected_type, (uint8_t)actual->type);
+        TEST_ASSERT_EQUAL_UINT8(expected_value, actual->value);
+    }
+
+public:
+    static void decodes_messages() {
+        // GIVEN a trace containing a write followed by a read
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace);
+
+        // WHEN we decode it one event at a time
+        ByteDecoder decoder(MAX_BYTES);
+        decode(trace, decoder);
+
+        // THEN we get the bytes and the START and STOP bits
+        TEST_ASSERT_EQUAL_UINT32(8, decoder.byte_count());
+        assert_byte(Type::Start, 0, decoder.byte(0));
+        assert_byte(Type::AddressAck, 0xA6, decoder.byte(1));
+        assert_byte(Type::DataAck, 0x58, decoder.byte(2));
+        assert_byte(Type::Stop, 0, decoder.byte(3));
+        assert_byte(Type::Start, 0, decoder.byte(4));
+        assert_byte(Type::AddressAck, 0xA7, decoder.byte(5));
+        assert_byte(Type::DataNack, 0xA7, decoder.byte(6));
+        assert_byte(Type::Stop, 0, decoder.byte(7));
+        TEST_ASSERT_EQUAL_UINT32(0, decoder.dropped_byte_count());
+    }
+
+    static void repeated_start_and_address_nack() {
+        // GIVEN a NACKed write followed by a repeated START
+        BusTrace trace(MAX_EVENTS);
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .start_bit()
+                .address_byte(0x10, BusTraceBuilder::WRITE).nack();
+        // SDA is already HIGH. Release SCL so we can send another START
+        trace.add_event(BusEvent(1'000, BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE | BusEventFlags::SDA_LINE_STATE));
+        builder.start_bit()
+                .address_byte(0x11, BusTraceBuilder::READ).ack()
+                .stop_bit();
+
+        // WHEN we decode it
+        ByteDecoder decoder(MAX_BYTES);
+        decode(trace, decoder);
+
+        // THEN the second START is a repeated START
+        TEST_ASSERT_EQUAL_UINT32(5, decoder.byte_count());
+        assert_byte(Type::Start, 0, decoder.byte(0));
+        assert_byte(Type::AddressNack, 0x20, decoder.byte(1));
+        assert_byte(Type::RepeatedStart, 0, decoder.byte(2));
+        assert_byte(Type::AddressAck, 0x23, decoder.byte(3));
+        assert_byte(Type::Stop, 0, decoder.byte(4));
+    }
+
+    static void matches_bus_trace_decoder() {
+        // GIVEN a recording with merged edges and bits before the first START
+        BusTrace trace(MAX_EVENTS);
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Max, common::i2c_specification::FastMode);
+        builder.bus_initially_idle()
+                .data_byte(0x99).nack()
+                .stop_bit();
+        given_2_messages(trace);
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED));   // START
+        trace.add_event(BusEvent(100, BusEventFlags::SCL_LINE_CHANGED));
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE
+                                      | BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE)); // Merged
+        trace.add_event(BusEvent(100, BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE));
+
+        // WHEN we decode it with both decoders
+        BusTraceDecoder expected(MAX_BYTES);
+        expected.decode(trace);
+        ByteDecoder actual(MAX_BYTES);
+        decode(trace, actual);
+
+        // THEN they agree
+        size_t byte_index = 0;
+        for (size_t i = 0; i < expected.field_count(); ++i) {
+            const DecodedField* field = expected.field(i);
+            const DecodedByte* byte = actual.byte(byte_index);
+            TEST_ASSERT_NOT_NULL(byte);
+            switch (field->type) {
+                case DecodedField::Type::Start:
+                    assert_byte(Type::Start, 0, byte);
+                    break;
+                case DecodedField::Type::RepeatedStart:
+                    assert_byte(Type::RepeatedStart, 0, byte);
+                    break;
+                case DecodedField::Type::Stop:
+                    assert_byte(Type::Stop, 0, byte);
+                    break;
+                case DecodedField::Type::Address:
+                    TEST_ASSERT_EQUAL_UINT8((field->value << 1) | field->read, byte->value);
+                    continue;   // Wait for the ACK
+                case DecodedField::Type::Data:
+                    TEST_ASSERT_EQUAL_UINT8(field->value, byte->value);
+                    continue;   // Wait for the ACK
+                case DecodedField::Type::Ack:
+                    TEST_ASSERT_TRUE(byte->type == Type::AddressAck || byte->type == Type::DataAck);
+                    break;
+                case DecodedField::Type::Nack:
+                    TEST_ASSERT_TRUE(byte->type == Type::AddressNack || byte->type == Type::DataNack);
+                    break;
+            }
+            byte_index++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(byte_index, actual.byte_count());
+    }
+
+    static void drops_bytes_when_full() {
+        // GIVEN a decoder with room for 3 bytes
+        BusTrace trace(MAX_EVENTS);
+        given_2_messages(trace);
+        DecodedByte bytes[3];
+        ByteDecoder decoder(bytes, 3);
+
+        // WHEN we decode a trace with more bytes than that
+        decode(trace, decoder);
+
+        // THEN the extra bytes are dropped
+        TEST_ASSERT_EQUAL_UINT32(3, decoder.byte_count());
+        TEST_ASSERT_EQUAL_UINT32(5, decoder.dropped_byte_count());
+        TEST_ASSERT_NULL(decoder.byte(3));
+    }
+
+    static void reset_forgets_state() {
+        // GIVEN a decoder that's part way through a message
+        ByteDecoder decoder(MAX_BYTES);
+        BusTrace trace(MAX_EVENTS);
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .start_bit()
+                .address_byte(0x53, BusTraceBuilder::WRITE);
+        decode(trace, decoder);
+
+        // WHEN we reset it
+        decoder.reset();
+
+        // THEN it's empty
+        TEST_ASSERT_EQUAL_UINT32(0, decoder.byte_count());
+        TEST_ASSERT_EQUAL_UINT32(0, decoder.dropped_byte_count());
+        // AND the rest of the message is ignored until the next START
+        trace.reset();
+        builder.ack().data_byte(0x01).ack().stop_bit();
+        decode(trace, decoder);
+        TEST_ASSERT_EQUAL_UINT32(0, decoder.byte_count());
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(decodes_messages);
+        RUN_TEST(repeated_start_and_address_nack);
+        RUN_TEST(matches_bus_trace_decoder);
+        RUN_TEST(drops_bytes_when_full);
+        RUN_TEST(reset_forgets_state);
+    }
+
+    ByteDecoderTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_BYTE_DECODER_TEST_H
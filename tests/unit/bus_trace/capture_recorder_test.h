@@ -0,0 +1,197 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_CAPTURE_RECORDER_TEST_H
+#define I2C_UNDERNEATH_CAPTURE_RECORDER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "fakes/common/hal/fake_edge_capture.h"
+#include "bus_trace/bus_trace_builder.h"
+#include "bus_trace/capture_recorder.h"
+
+namespace bus_trace {
+
+class CaptureRecorderTest : public TestSuite {
+    static const size_t MAX_EVENTS = 200;
+    static const uint8_t SDA = common::hal::EdgeCapture::SDA;
+    static const uint8_t SCL = common::hal::EdgeCapture::SCL;
+
+    // Replays 'trace' on the capture hardware. Drains the recorder
+    // at least every 'drain_interval' ticks.
+    static void replay(const BusTrace& trace, common::hal::FakeEdgeCapture& capture,
+                       CaptureRecorder& recorder, uint32_t drain_interval) {
+        for (size_t i = 1; i < trace.event_count(); ++i) {
+            const BusEvent* event = trace.event(i);
+            uint32_t delta = event->delta_t_in_ticks;
+            while (delta > drain_interval) {
+                capture.advance(drain_interval);
+                recorder.drain();
+                delta -= drain_interval;
+            }
+            capture.advance(delta);
+            capture.set_line(SDA, event->flags & SDA_LINE_STATE);
+            capture.set_line(SCL, event->flags & SCL_LINE_STATE);
+        }
+        recorder.drain();
+    }
+
+    static void records_time_of_each_edge() {
+        // GIVEN a recorder
+        common::hal::FakeEdgeCapture capture;
+        CaptureRecorder recorder(capture);
+        BusTrace trace(MAX_EVENTS);
+        recorder.start(trace);
+
+        // WHEN the lines change
+        capture.advance(100);
+        capture.set_line(SDA, false);
+        capture.advance(50);
+        capture.set_line(SCL, false);
+        TEST_ASSERT_EQUAL_UINT32(2, recorder.drain());
+
+        // THEN each edge is recorded with the time it was captured
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(0, SDA_LINE_STATE | SCL_LINE_STATE) == *trace.event(0));
+        TEST_ASSERT_TRUE(BusEvent(100, SDA_LINE_CHANGED | SCL_LINE_STATE) == *trace.event(1));
+        TEST_ASSERT_TRUE(BusEvent(50, SCL_LINE_CHANGED) == *trace.event(2));
+        TEST_ASSERT_TRUE(recorder.statistics().is_complete());
+    }
+
+    static void extends_narrow_counter() {
+        // GIVEN a recorder with an 8 bit counter
+        common::hal::FakeEdgeCapture capture(0xFF);
+        CaptureRecorder recorder(capture);
+        BusTrace trace(MAX_EVENTS);
+        capture.advance(200);
+        recorder.start(trace);
+
+        // WHEN edges are further apart than the counter period
+        // and the recorder is drained regularly
+        for (int i = 0; i < 5; ++i) {
+            capture.advance(200);
+            recorder.drain();
+        }
+        capture.advance(30);
+        capture.set_line(SDA, false);
+        recorder.drain();
+        capture.advance(200);
+        recorder.drain();
+        capture.advance(100);
+        capture.set_line(SDA, true);
+        recorder.drain();
+
+        // THEN the deltas include every time the counter wrapped
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(1'030, trace.event(1)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT32(300, trace.event(2)->delta_t_in_ticks);
+    }
+
+    static void drains_edges_in_batches() {
+        // GIVEN a recorder
+        common::hal::FakeEdgeCapture capture;
+        CaptureRecorder recorder(capture);
+        BusTrace trace(MAX_EVENTS);
+        recorder.start(trace);
+
+        // WHEN more edges are captured than fit in a batch
+        const size_t edges = 2 * CaptureRecorder::BATCH_SIZE + 3;
+        for (size_t i = 0; i < edges; ++i) {
+            capture.advance(10);
+            capture.set_line(SCL, i % 2);
+        }
+        capture.read_edges_calls = 0;
+        size_t drained = recorder.drain();
+
+        // THEN they're all recorded
+        TEST_ASSERT_EQUAL_UINT32(edges, drained);
+        TEST_ASSERT_EQUAL_UINT32(edges + 1, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(3, capture.read_edges_calls);
+    }
+
+    static void merges_simultaneous_edges() {
+        // GIVEN a recorder
+        common::hal::FakeEdgeCapture capture;
+        CaptureRecorder recorder(capture);
+        BusTrace trace(MAX_EVENTS);
+        recorder.start(trace);
+
+        // WHEN both lines change in the same tick
+        capture.advance(40);
+        capture.set_line(SCL, false);
+        capture.set_line(SDA, false);
+        recorder.drain();
+
+        // THEN they're recorded as a single event
+        TEST_ASSERT_EQUAL_UINT32(2, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(40, SDA_LINE_CHANGED | SCL_LINE_CHANGED) == *trace.event(1));
+        TEST_ASSERT_EQUAL_UINT32(1, recorder.statistics().merged_events);
+    }
+
+    static void records_missed_edge_as_glitch() {
+        // GIVEN a recorder
+        common::hal::FakeEdgeCapture capture;
+        CaptureRecorder recorder(capture);
+        BusTrace trace(MAX_EVENTS);
+        recorder.start(trace);
+
+        // WHEN the hardware reports a rising edge on a line that's already HIGH
+        capture.advance(25);
+        capture.capture_edge(SDA, true);
+        recorder.drain();
+
+        // THEN the recorder adds a glitch and reports the missing edge
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(25, SDA_LINE_CHANGED | SCL_LINE_STATE) == *trace.event(1));
+        TEST_ASSERT_TRUE(BusEvent(0, SDA_LINE_CHANGED | SDA_LINE_STATE | SCL_LINE_STATE) == *trace.event(2));
+        RecorderStatistics stats = recorder.statistics();
+        TEST_ASSERT_EQUAL_UINT32(1, stats.missed_edges);
+        TEST_ASSERT_EQUAL_UINT32(1, stats.glitches);
+        TEST_ASSERT_FALSE(stats.is_complete());
+    }
+
+    static void records_i2c_message() {
+        // GIVEN an I2C message
+        BusTrace expected(MAX_EVENTS);
+        BusTraceBuilder builder(expected, BusTraceBuilder::TimingStrategy::Max, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .start_bit()
+                .address_byte(0x53, BusTraceBuilder::READ)
+                .ack()
+                .data_byte(0xA6)
+                .nack()
+                .stop_bit();
+
+        // WHEN it's recorded with a 16 bit counter
+        common::hal::FakeEdgeCapture capture(0xFFFF);
+        CaptureRecorder recorder(capture);
+        BusTrace actual(MAX_EVENTS);
+        recorder.start(actual);
+        replay(expected, capture, recorder, 10'000);
+        recorder.stop();
+
+        // THEN the recording is exact
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.compare_edges(actual));
+        for (size_t i = 1; i < expected.event_count(); ++i) {
+            TEST_ASSERT_EQUAL_UINT32(expected.event(i)->delta_t_in_ticks, actual.event(i)->delta_t_in_ticks);
+        }
+        TEST_ASSERT_FALSE(recorder.is_recording());
+        TEST_ASSERT_TRUE(recorder.statistics().is_complete());
+    }
+
+public:
+    void test() final {
+        RUN_TEST(records_time_of_each_edge);
+        RUN_TEST(extends_narrow_counter);
+        RUN_TEST(drains_edges_in_batches);
+        RUN_TEST(merges_simultaneous_edges);
+        RUN_TEST(records_missed_edge_as_glitch);
+        RUN_TEST(records_i2c_message);
+    }
+
+    CaptureRecorderTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_CAPTURE_RECORDER_TEST_H
@@ -0,0 +1,150 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_DOUBLE_BUFFERED_TRACE_TEST_H
+#define I2C_UNDERNEATH_DOUBLE_BUFFERED_TRACE_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "bus_trace/double_buffered_trace.h"
+
+namespace bus_trace {
+
+class DoubleBufferedTraceTest : public TestSuite {
+    static BusTrace* last_full_trace;
+    static size_t callback_count;
+
+    static void on_full(BusTrace& trace) {
+        last_full_trace = &trace;
+        callback_count++;
+    }
+
+    static void add_events(DoubleBufferedTrace& traces, uint32_t& tick, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            tick += 10;
+            traces.add_event(tick, (i % 2) ? SDA_LINE_CHANGED : SCL_LINE_CHANGED);
+        }
+    }
+
+    static void swaps_traces_when_full() {
+        // GIVEN a double buffer
+        BusTrace first(4);
+        BusTrace second(4);
+        DoubleBufferedTrace traces(first, second, on_full);
+        last_full_trace = nullptr;
+        callback_count = 0;
+        traces.reset(0);
+        uint32_t tick = 0;
+
+        // WHEN we add more events than the first trace can hold
+        add_events(traces, tick, 4);
+
+        // THEN the traces are swapped before the first one overflows
+        TEST_ASSERT_EQUAL_UINT32(1, callback_count);
+        TEST_ASSERT_TRUE(last_full_trace == &first);
+        TEST_ASSERT_TRUE(traces.full_trace() == &first);
+        TEST_ASSERT_TRUE(&traces.current_trace() == &second);
+        TEST_ASSERT_EQUAL_UINT32(3, first.event_count());
+        TEST_ASSERT_EQUAL_UINT32(1, second.event_count());
+        TEST_ASSERT_EQUAL_UINT32(1, traces.swap_count());
+        TEST_ASSERT_EQUAL_UINT32(0, traces.dropped_event_count());
+    }
+
+    static void swapped_traces_have_no_gaps() {
+        // GIVEN a double buffer
+        BusTrace first(3);
+        BusTrace second(3);
+        DoubleBufferedTrace traces(first, second);
+        traces.reset(100);
+
+        // WHEN events span both traces
+        traces.add_event(110, SDA_LINE_CHANGED);
+        traces.add_event(125, SCL_LINE_CHANGED);
+        traces.add_event(150, SDA_LINE_CHANGED);
+
+        // THEN the first event in the second trace has the time since the last event in the first
+        TEST_ASSERT_EQUAL_UINT32(2, first.event_count());
+        TEST_ASSERT_EQUAL_UINT32(10, first.event(0)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT32(15, first.event(1)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT32(1, second.event_count());
+        TEST_ASSERT_EQUAL_UINT32(25, second.event(0)->delta_t_in_ticks);
+    }
+
+    static void drops_events_until_full_trace_released() {
+        // GIVEN a double buffer where both traces are full
+        BusTrace first(4);
+        BusTrace second(4);
+        DoubleBufferedTrace traces(first, second);
+        traces.reset(0);
+        uint32_t tick = 0;
+        add_events(traces, tick, 6);
+
+        // WHEN we add more events
+        add_events(traces, tick, 2);
+
+        // THEN they're dropped
+        TEST_ASSERT_EQUAL_UINT32(2, traces.dropped_event_count());
+        TEST_ASSERT_EQUAL_UINT32(3, second.event_count());
+
+        // WHEN the full trace is released
+        TEST_ASSERT_TRUE(traces.release(first));
+        add_events(traces, tick, 1);
+
+        // THEN recording carries on in the released trace
+        TEST_ASSERT_TRUE(traces.full_trace() == &second);
+        TEST_ASSERT_TRUE(&traces.current_trace() == &first);
+        TEST_ASSERT_EQUAL_UINT32(1, first.event_count());
+        TEST_ASSERT_EQUAL_UINT32(30, first.event(0)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT32(2, traces.swap_count());
+    }
+
+    static void release_rejects_traces_that_are_not_full() {
+        // GIVEN a double buffer that hasn't swapped
+        BusTrace first(4);
+        BusTrace second(4);
+        DoubleBufferedTrace traces(first, second);
+        traces.reset(0);
+
+        // WHEN we release a trace that isn't full
+        // THEN it's rejected
+        TEST_ASSERT_NULL(traces.full_trace());
+        TEST_ASSERT_FALSE(traces.release(first));
+        TEST_ASSERT_FALSE(traces.release(second));
+    }
+
+    static void adds_time_extension_across_swap() {
+        // GIVEN a double buffer with one free slot in the current trace
+        BusTrace first(2);
+        BusTrace second(4);
+        DoubleBufferedTrace traces(first, second);
+        traces.reset(0);
+        traces.add_event(10, SDA_LINE_CHANGED);
+
+        // WHEN we add an event that needs a time extension
+        traces.add_event(10 + 0x20000, SCL_LINE_CHANGED);
+
+        // THEN the event and its extension go into the next trace
+        TEST_ASSERT_EQUAL_UINT32(1, first.event_count());
+        TEST_ASSERT_EQUAL_UINT32(2, second.event_count());
+        TEST_ASSERT_TRUE(second.event(0)->is_time_extension());
+        TEST_ASSERT_EQUAL_UINT32(0x20000, second.event(0)->ticks() + second.event(1)->delta_t_in_ticks);
+    }
+
+public:
+    void test() final {
+        RUN_TEST(swaps_traces_when_full);
+        RUN_TEST(swapped_traces_have_no_gaps);
+        RUN_TEST(drops_events_until_full_trace_released);
+        RUN_TEST(release_rejects_traces_that_are_not_full);
+        RUN_TEST(adds_time_extension_across_swap);
+    }
+
+    DoubleBufferedTraceTest() : TestSuite(__FILE__) {};
+};
+
+BusTrace* DoubleBufferedTraceTest::last_full_trace = nullptr;
+size_t DoubleBufferedTraceTest::callback_count = 0;
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_DOUBLE_BUFFERED_TRACE_TEST_H
@@ -0,0 +1,190 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_GPIO_SAMPLE_DECODER_TEST_H
+#define I2C_UNDERNEATH_GPIO_SAMPLE_DECODER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "bus_trace/gpio_sample_decoder.h"
+
+namespace bus_trace {
+
+class GpioSampleDecoderTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1000;
+    static const uint32_t SDA_MASK = 1 << 16;
+    static const uint32_t SCL_MASK = 1 << 17;
+    static const uint32_t BOTH_HIGH = SDA_MASK | SCL_MASK;
+    static const uint32_t NOISE = 0xF00F;  // Other pins on the same port
+
+    // Compares each sample with the one before. No tricks.
+    static void decode_one_at_a_time(BusTrace& trace, const uint32_t* samples, size_t count, uint32_t ticks_per_sample) {
+        uint32_t masks = SDA_MASK | SCL_MASK;
+        size_t last_event = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t sample = samples[i] & masks;
+            uint32_t previous = i ? samples[i - 1] & masks : sample;
+            if (i == 0 || sample != previous) {
+                uint8_t states = ((sample & SDA_MASK) ? SDA_LINE_STATE : 0) | ((sample & SCL_MASK) ? SCL_LINE_STATE : 0);
+                uint8_t old_states = ((previous & SDA_MASK) ? SDA_LINE_STATE : 0) | ((previous & SCL_MASK) ? SCL_LINE_STATE : 0);
+                trace.add_event_with_delta((i - last_event) * ticks_per_sample, (BusEventFlags)(((states ^ old_states) << 2) | states));
+                last_event = i;
+            }
+        }
+    }
+
+    static void first_sample_gives_initial_state() {
+        // GIVEN a decoder
+        BusTrace trace(MAX_EVENTS);
+        GpioSampleDecoder decoder(trace, SDA_MASK, SCL_MASK);
+
+        // WHEN we add samples that don't change
+        uint32_t samples[] = {SDA_MASK | NOISE, SDA_MASK, SDA_MASK | NOISE};
+        decoder.add_samples(samples, 3);
+
+        // THEN there's just one event with the initial state
+        TEST_ASSERT_EQUAL_UINT32(1, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(0, SDA_LINE_STATE) == *trace.event(0));
+        TEST_ASSERT_EQUAL_UINT32(3, decoder.sample_count());
+    }
+
+    static void records_edges_across_chunks() {
+        // GIVEN a decoder where each sample is 4 ticks
+        BusTrace trace(MAX_EVENTS);
+        GpioSampleDecoder decoder(trace, SDA_MASK, SCL_MASK, 4);
+        uint32_t samples[100];
+        for (auto& sample : samples) {
+            sample = BOTH_HIGH;
+        }
+        samples[0] = BOTH_HIGH | NOISE;
+        for (size_t i = 40; i < 100; ++i) {
+            samples[i] = SCL_MASK;  // SDA falls at 40
+        }
+        for (size_t i = 70; i < 100; ++i) {
+            samples[i] = 0;         // SCL falls at 70
+        }
+
+        // WHEN the samples arrive in uneven chunks
+        decoder.add_samples(samples, 7);
+        decoder.add_samples(samples + 7, 50);
+        decoder.add_samples(samples + 57, 43);
+
+        // THEN each edge has the right delta
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(40 * 4, SDA_LINE_CHANGED | SCL_LINE_STATE) == *trace.event(1));
+        TEST_ASSERT_TRUE(BusEvent(30 * 4, SCL_LINE_CHANGED) == *trace.event(2));
+    }
+
+    static void merges_edges_in_same_sample() {
+        // GIVEN a decoder
+        BusTrace trace(MAX_EVENTS);
+        GpioSampleDecoder decoder(trace, SDA_MASK, SCL_MASK);
+
+        // WHEN both lines change in one sample
+        uint32_t samples[] = {BOTH_HIGH, BOTH_HIGH, 0};
+        decoder.add_samples(samples, 3);
+
+        // THEN there's a single event
+        TEST_ASSERT_EQUAL_UINT32(2, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(2, SDA_LINE_CHANGED | SCL_LINE_CHANGED) == *trace.event(1));
+        TEST_ASSERT_EQUAL_UINT32(1, decoder.merged_event_count());
+    }
+
+    static void skipped_samples_add_time() {
+        // GIVEN a decoder
+        BusTrace trace(MAX_EVENTS);
+        GpioSampleDecoder decoder(trace, SDA_MASK, SCL_MASK);
+        uint32_t high[] = {BOTH_HIGH, BOTH_HIGH};
+        decoder.add_samples(high, 2);
+
+        // WHEN samples are lost before an edge
+        decoder.skip_samples(1'000);
+        uint32_t low[] = {SCL_MASK};
+        decoder.add_samples(low, 1);
+
+        // THEN the delta includes the lost samples
+        TEST_ASSERT_EQUAL_UINT32(2, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(1'002, trace.event(1)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT32(1'003, decoder.sample_count());
+    }
+
+    static void long_gaps_are_saturated() {
+        // GIVEN a decoder where each sample is 1000 ticks
+        BusTrace trace(MAX_EVENTS);
+        GpioSampleDecoder decoder(trace, SDA_MASK, SCL_MASK, 1'000);
+        uint32_t high[] = {BOTH_HIGH};
+        decoder.add_samples(high, 1);
+
+        // WHEN the next edge is more than 2^32 ticks later
+        decoder.skip_samples(5'000'000);
+        uint32_t low[] = {SCL_MASK};
+        decoder.add_samples(low, 1);
+
+        // THEN the gap is recorded as the longest possible delta rather than wrapping
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_TRUE(trace.event(1)->is_time_extension());
+        TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, trace.event(1)->ticks() + trace.event(2)->delta_t_in_ticks);
+    }
+
+    static void matches_simple_decoder() {
+        // GIVEN a long run of samples with edges at irregular intervals
+        const size_t count = 5'000;
+        static uint32_t samples[count];
+        uint32_t state = BOTH_HIGH;
+        uint32_t random = 12345;
+        for (size_t i = 0; i < count; ++i) {
+            random = random * 1103515245 + 12345;
+            if ((random >> 16) % 13 == 0) {
+                state ^= ((random >> 8) & 1) ? SDA_MASK : SCL_MASK;
+            }
+            samples[i] = state | ((random >> 20) & NOISE);
+        }
+
+        // WHEN they're decoded
+        BusTrace expected(count);
+        decode_one_at_a_time(expected, samples, count, 3);
+        BusTrace actual(count);
+        GpioSampleDecoder decoder(actual, SDA_MASK, SCL_MASK, 3);
+        decoder.add_samples(samples, 1'001);
+        decoder.add_samples(samples + 1'001, count - 1'001);
+
+        // THEN the events are the same as the simple decoder's
+        TEST_ASSERT_GREATER_THAN_UINT32(100, expected.event_count());
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(actual));
+    }
+
+    static void reset_adds_new_initial_event() {
+        // GIVEN a decoder that's been used
+        BusTrace trace(MAX_EVENTS);
+        GpioSampleDecoder decoder(trace, SDA_MASK, SCL_MASK);
+        uint32_t samples[] = {BOTH_HIGH, SDA_MASK};
+        decoder.add_samples(samples, 2);
+
+        // WHEN it's reset
+        trace.reset();
+        decoder.reset();
+        decoder.add_samples(samples + 1, 1);
+
+        // THEN the next sample is the initial state
+        TEST_ASSERT_EQUAL_UINT32(1, trace.event_count());
+        TEST_ASSERT_TRUE(BusEvent(0, SDA_LINE_STATE) == *trace.event(0));
+        TEST_ASSERT_EQUAL_UINT32(1, decoder.sample_count());
+    }
+
+public:
+    void test() final {
+        RUN_TEST(first_sample_gives_initial_state);
+        RUN_TEST(records_edges_across_chunks);
+        RUN_TEST(merges_edges_in_same_sample);
+        RUN_TEST(skipped_samples_add_time);
+        RUN_TEST(long_gaps_are_saturated);
+        RUN_TEST(matches_simple_decoder);
+        RUN_TEST(reset_adds_new_initial_event);
+    }
+
+    GpioSampleDecoderTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_GPIO_SAMPLE_DECODER_TEST_H
@@ -0,0 +1,228 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_MAPPED_BUS_TRACE_TEST_H
+#define I2C_UNDERNEATH_MAPPED_BUS_TRACE_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "utils/test_suite.h"
+#include "utils/bus_trace_fixtures.h"
+#include "fakes/common/hal/fake_clock.h"
+#include "analysis/i2c_timing_analyser.h"
+#include "bus_trace/bus_trace_serialiser.h"
+#include "bus_trace/mapped_bus_trace.h"
+
+namespace bus_trace {
+
+class MappedBusTraceTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+
+    // Writes to a temporary file
+    class FileSink : public Print {
+    public:
+        explicit FileSink(FILE* file) : file(file) {
+        }
+
+        size_t write(uint8_t b) override {
+            return fputc(b, file) == EOF ? 0 : 1;
+        }
+
+        size_t write(const uint8_t* buffer, size_t size) override {
+            return fwrite(buffer, 1, size, file);
+        }
+
+    private:
+        FILE* file;
+    };
+
+    static char path[64];
+
+    static void given_file(const BusTrace& trace, size_t bytes_to_remove = 0) {
+        FILE* file = fopen(path, "wb");
+        FileSink sink(file);
+        size_t size = BusTraceSerialiser::write(trace, sink);
+        fclose(file);
+        if (bytes_to_remove) {
+            TEST_ASSERT_EQUAL_INT(0, truncate(path, (off_t)(size - bytes_to_remove)));
+        }
+    }
+
+public:
+    void setUp() override {
+        strcpy(path, "/tmp/mapped_bus_trace_XXXXXX");
+        int fd = mkstemp(path);
+        TEST_ASSERT_TRUE(fd >= 0);
+        ::close(fd);
+    }
+
+    void tearDown() override {
+        remove(path);
+    }
+
+    static void events_are_read_from_the_file() {
+        // GIVEN a serialised trace
+        common::hal::FakeClock clock;
+        BusTrace expected(&clock, MAX_EVENTS);
+        given_messages(expected);
+        given_file(expected);
+
+        // WHEN we map it
+        MappedBusTrace mapped;
+        bool ok = mapped.open(path);
+
+        // THEN we can see every event
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_TRUE(mapped.is_open());
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), mapped.event_count());
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(mapped.trace()));
+        TEST_ASSERT_TRUE(*expected.event(7) == *mapped.event(7));
+        TEST_ASSERT_NULL(mapped.event(mapped.event_count()));
+        // AND the trace is a view of the same events
+        TEST_ASSERT_TRUE(mapped.event(3) == mapped.trace().event(3));
+    }
+
+    static void times_use_clock_rate_from_header() {
+        // GIVEN a trace recorded with a 500 MHz clock
+        common::hal::FakeClock clock;
+        BusTrace expected(&clock, MAX_EVENTS);
+        given_messages(expected);
+        given_file(expected);
+
+        // WHEN we map it without a clock
+        MappedBusTrace mapped;
+        mapped.open(path);
+
+        // THEN the times are the same as the original
+        TEST_ASSERT_EQUAL_UINT32(500'000'000, mapped.header().ticks_per_second);
+        size_t last = expected.event_count() - 1;
+        TEST_ASSERT_EQUAL_UINT32(expected.nanos_between(last, 0), mapped.trace().nanos_between(last, 0));
+        // AND the timing analysis is the same
+        auto expected_analysis = analysis::I2CTimingAnalyser::analyse(expected, 0, 0, 0, 0);
+        auto actual_analysis = analysis::I2CTimingAnalyser::analyse(mapped.trace(), 0, 0, 0, 0);
+        TEST_ASSERT_EQUAL_UINT32(expected_analysis.scl_low_time.count(), actual_analysis.scl_low_time.count());
+        TEST_ASSERT_EQUAL_UINT32(expected_analysis.scl_low_time.min(), actual_analysis.scl_low_time.min());
+        TEST_ASSERT_EQUAL_UINT32(expected_analysis.data_setup_time.max(), actual_analysis.data_setup_time.max());
+    }
+
+    static void trace_is_read_only() {
+        // GIVEN a mapped trace
+        BusTrace expected(MAX_EVENTS);
+        given_messages(expected);
+        given_file(expected);
+        MappedBusTrace mapped;
+        mapped.open(path);
+        BusTrace& trace = mapped.trace();
+        TEST_ASSERT_TRUE(trace.is_read_only());
+
+        // WHEN we try to change it
+        trace.set_circular(true);
+        trace.add_event(BusEvent(5, BusEventFlags::SDA_LINE_CHANGED));
+        trace.reset();
+
+        // THEN nothing happens
+        TEST_ASSERT_FALSE(trace.is_circular());
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(trace));
+    }
+
+    static void chunks_cover_the_whole_file() {
+        // GIVEN a file with a time extension
+        common::hal::FakeClock clock;
+        BusTrace expected(&clock, MAX_EVENTS);
+        expected.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        expected.add_event(BusEvent::time_extension(0x20000, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+        expected.add_event(BusEvent(0, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+        given_messages(expected);
+        given_file(expected);
+        MappedBusTrace mapped;
+        mapped.open(path);
+
+        // WHEN we process it 2 events at a time
+        size_t total = 0;
+        size_t chunks = 0;
+        uint32_t nanos = 0;
+        BusEvent previous_last;
+        bool ok = mapped.for_each_chunk(2, [&](const BusTrace& chunk) {
+            TEST_ASSERT_TRUE(chunk.is_read_only());
+            TEST_ASSERT_FALSE(chunk.event(chunk.event_count() - 1)->is_time_extension());
+            if (chunks) {
+                // Each chunk starts with the last event of the previous one
+                TEST_ASSERT_TRUE(previous_last == *chunk.event(0));
+                total += chunk.event_count() - 1;
+            } else {
+                total += chunk.event_count();
+            }
+            nanos += chunk.nanos_between(chunk.event_count() - 1, 0);
+            previous_last = *chunk.event(chunk.event_count() - 1);
+            chunks++;
+        });
+
+        // THEN every event is seen
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), total);
+        // AND no time is lost between the chunks
+        TEST_ASSERT_EQUAL_UINT32(expected.nanos_between(expected.event_count() - 1, 0), nanos);
+        // AND the time extension stays with its event
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count() - 2, chunks);
+        BusTrace chunk = mapped.chunk(0, 3);
+        TEST_ASSERT_EQUAL_UINT32(0x20000 * common::hal::FakeClock::nanos_per_tick, chunk.nanos_to_previous(2));
+    }
+
+    static void rejects_chunks_that_are_too_small() {
+        // GIVEN a file
+        BusTrace expected(MAX_EVENTS);
+        given_messages(expected);
+        given_file(expected);
+        MappedBusTrace mapped;
+        mapped.open(path);
+
+        // WHEN we ask for chunks that are too small to hold an edge
+        size_t chunks = 0;
+        bool ok = mapped.for_each_chunk(1, [&](const BusTrace&) {
+            chunks++;
+        });
+
+        // THEN we don't get any
+        TEST_ASSERT_FALSE(ok);
+        TEST_ASSERT_EQUAL_UINT32(0, chunks);
+        TEST_ASSERT_FALSE(mapped.for_each_chunk(0, [&](const BusTrace&) {
+            chunks++;
+        }));
+    }
+
+    static void rejects_invalid_files() {
+        // GIVEN a truncated file
+        BusTrace expected(MAX_EVENTS);
+        given_messages(expected);
+        given_file(expected, 1);
+
+        // THEN it can't be mapped
+        MappedBusTrace mapped;
+        TEST_ASSERT_FALSE(mapped.open(path));
+        TEST_ASSERT_FALSE(mapped.is_open());
+        TEST_ASSERT_EQUAL_UINT32(0, mapped.event_count());
+
+        // AND neither can a missing file
+        TEST_ASSERT_FALSE(mapped.open("/tmp/there/is/no/such/file"));
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(events_are_read_from_the_file);
+        RUN_TEST(times_use_clock_rate_from_header);
+        RUN_TEST(trace_is_read_only);
+        RUN_TEST(chunks_cover_the_whole_file);
+        RUN_TEST(rejects_chunks_that_are_too_small);
+        RUN_TEST(rejects_invalid_files);
+    }
+
+    MappedBusTraceTest() : TestSuite(__FILE__) {};
+};
+
+char MappedBusTraceTest::path[64];
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_MAPPED_BUS_TRACE_TEST_H
@@ -0,0 +1,184 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_MESSAGE_ITERATOR_TEST_H
+#define I2C_UNDERNEATH_MESSAGE_ITERATOR_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "fakes/common/hal/fake_clock.h"
+#include "bus_trace/bus_trace_builder.h"
+#include "bus_trace/message_iterator.h"
+
+namespace bus_trace {
+
+class MessageIteratorTest : public TestSuite {
+    static const size_t MAX_EVENTS = 200;
+
+    // A message with a spurious SDA pulse, a time extension and 2 merged events
+    static void given_a_messy_trace(BusTrace& trace) {
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .start_bit()
+                .address_byte(0xF0, BusTraceBuilder::WRITE);
+        trace.add_event(BusEvent(50, SDA_LINE_CHANGED | SDA_LINE_STATE));
+        trace.add_event(BusEvent(50, SDA_LINE_CHANGED));
+        builder.ack()
+                .data_byte(0x35)
+                .ack();
+        trace.add_event(BusEvent::time_extension(0x30000, SCL_LINE_CHANGED | SCL_LINE_STATE));
+        trace.add_event(BusEvent(0, SCL_LINE_CHANGED | SCL_LINE_STATE));
+        trace.add_event(BusEvent(10, SCL_LINE_CHANGED | SDA_LINE_CHANGED | SCL_LINE_STATE | SDA_LINE_STATE));
+        trace.add_event(BusEvent(20, SCL_LINE_CHANGED | SDA_LINE_CHANGED));
+        builder.stop_bit();
+    }
+
+    static void then_iterator_matches_to_message(const BusTrace& trace, bool merge_sda_edges, bool split_events) {
+        BusTrace expected = trace.to_message(merge_sda_edges, split_events);
+        MessageIterator iter(trace, merge_sda_edges, split_events);
+        size_t count = 0;
+        while (iter.has_next()) {
+            BusEvent event = iter.next();
+            TEST_ASSERT_TRUE(count < expected.event_count());
+            TEST_ASSERT_TRUE(*expected.event(count) == event);
+            count++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), count);
+        TEST_ASSERT_EQUAL_UINT32(count, MessageIterator::event_count(trace, merge_sda_edges, split_events));
+    }
+
+public:
+    static void iterator_gives_same_events_as_to_message() {
+        // GIVEN a trace with events that need normalising
+        BusTrace trace(MAX_EVENTS);
+        given_a_messy_trace(trace);
+
+        // THEN the iterator matches to_message() for every combination of options
+        then_iterator_matches_to_message(trace, true, true);
+        then_iterator_matches_to_message(trace, false, true);
+        then_iterator_matches_to_message(trace, true, false);
+        then_iterator_matches_to_message(trace, false, false);
+    }
+
+    static void iterator_handles_traces_without_a_message() {
+        // GIVEN an empty trace
+        BusTrace trace(MAX_EVENTS);
+        TEST_ASSERT_FALSE(MessageIterator(trace).has_next());
+
+        // AND a trace that only holds a time extension
+        trace.add_event(BusEvent::time_extension(0x30000, SDA_LINE_CHANGED));
+        TEST_ASSERT_FALSE(MessageIterator(trace).has_next());
+
+        // AND a trace that only holds a spurious pulse
+        BusTrace pulse(MAX_EVENTS);
+        pulse.add_event(BusEvent(50, SDA_LINE_CHANGED | SDA_LINE_STATE));
+        pulse.add_event(BusEvent(50, SDA_LINE_CHANGED));
+        TEST_ASSERT_FALSE(MessageIterator(pulse).has_next());
+    }
+
+    static void to_message_writes_to_supplied_trace() {
+        // GIVEN a trace
+        BusTrace trace(MAX_EVENTS);
+        given_a_messy_trace(trace);
+        BusTrace expected = trace.to_message();
+
+        // WHEN we convert it to a message in an existing trace
+        BusTrace message(MAX_EVENTS);
+        message.add_event(BusEvent(1, SDA_LINE_CHANGED));
+        size_t count = trace.to_message(message);
+
+        // THEN the old events are replaced with the message
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), count);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(message));
+    }
+
+    static void to_message_drops_events_if_supplied_trace_is_too_small() {
+        // GIVEN a trace
+        BusTrace trace(MAX_EVENTS);
+        given_a_messy_trace(trace);
+        BusTrace expected = trace.to_message();
+
+        // WHEN we convert it to a message in a small trace
+        BusTrace message(10);
+        size_t count = trace.to_message(message);
+
+        // THEN we're told how many events we missed
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), count);
+        TEST_ASSERT_EQUAL_UINT32(10, message.event_count());
+    }
+
+    static void normalise_converts_trace_in_place() {
+        // GIVEN a trace with spare space for the split events
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        given_a_messy_trace(trace);
+        BusTrace expected = trace.to_message();
+        const BusEvent* events = trace.event(0);
+
+        // WHEN we normalise it
+        bool ok = trace.normalise();
+
+        // THEN it's the same as the message
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(trace));
+        // AND it still uses the same array
+        TEST_ASSERT_TRUE(events == trace.event(0));
+    }
+
+    static void normalise_needs_space_for_split_events() {
+        // GIVEN a full trace with 2 merged events
+        BusTrace messy(MAX_EVENTS);
+        given_a_messy_trace(messy);
+        BusTrace trace(messy.event_count() + 1);
+        for (size_t i = 0; i < messy.event_count(); ++i) {
+            trace.add_event(*messy.event(i));
+        }
+
+        // WHEN we try to normalise it
+        bool ok = trace.normalise();
+
+        // THEN it fails and the trace is unchanged
+        TEST_ASSERT_FALSE(ok);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, messy.is_identical_to(trace));
+
+        // BUT it works if we don't split the events
+        TEST_ASSERT_TRUE(trace.normalise(true, false));
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, messy.to_message(true, false).is_identical_to(trace));
+    }
+
+    static void normalise_circular_trace() {
+        // GIVEN a circular trace that has overwritten its oldest events
+        BusTrace messy(MAX_EVENTS);
+        given_a_messy_trace(messy);
+        BusTrace trace(messy.event_count() - 4);
+        trace.set_circular(true);
+        for (size_t i = 0; i < messy.event_count(); ++i) {
+            trace.add_event(*messy.event(i));
+        }
+        BusTrace expected = trace.to_message(true, false);
+
+        // WHEN we normalise it
+        bool ok = trace.normalise(true, false);
+
+        // THEN the events are in order
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(trace));
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(iterator_gives_same_events_as_to_message);
+        RUN_TEST(iterator_handles_traces_without_a_message);
+        RUN_TEST(to_message_writes_to_supplied_trace);
+        RUN_TEST(to_message_drops_events_if_supplied_trace_is_too_small);
+        RUN_TEST(normalise_converts_trace_in_place);
+        RUN_TEST(normalise_needs_space_for_split_events);
+        RUN_TEST(normalise_circular_trace);
+    }
+
+    MessageIteratorTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_MESSAGE_ITERATOR_TEST_H
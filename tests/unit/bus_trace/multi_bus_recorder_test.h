@@ -0,0 +1,209 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_MULTI_BUS_RECORDER_TEST_H
+#define I2C_UNDERNEATH_MULTI_BUS_RECORDER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "fakes/common/hal/fake_clock.h"
+#include "fakes/common/hal/fake_gpio_port.h"
+#include "bus_trace/multi_bus_recorder.h"
+
+namespace bus_trace {
+
+class MultiBusRecorderTest : public TestSuite {
+    typedef MultiBusRecorder<common::hal::FakeGpioPort, common::hal::FakeClock> Recorder;
+
+    static const size_t MAX_EVENTS = 20;
+    static const uint8_t SDA_0 = 16;
+    static const uint8_t SCL_0 = 17;
+    static const uint8_t SDA_1 = 2;
+    static const uint8_t SCL_1 = 3;
+
+    static Recorder* recorder;
+
+    // Starts recording 2 buses. Bus 0 is idle and bus 1 has SCL LOW.
+    static void given_2_buses(Recorder& multi_recorder, common::hal::FakeGpioPort& port,
+                              BusTrace& trace0, BusTrace& trace1) {
+        recorder = &multi_recorder;
+        port.set_pin(SDA_0, true);
+        port.set_pin(SCL_0, true);
+        port.set_pin(SDA_1, true);
+        TEST_ASSERT_TRUE(multi_recorder.add_bus(SDA_0, SCL_0));
+        TEST_ASSERT_TRUE(multi_recorder.add_bus(SDA_1, SCL_1));
+        multi_recorder.set_callback([]() { recorder->add_event(); });
+        BusTrace* traces[] = {&trace0, &trace1};
+        TEST_ASSERT_TRUE(multi_recorder.start(traces, 2));
+    }
+
+    static void add_bus_rejects_invalid_pins() {
+        // GIVEN a recorder
+        common::hal::FakeGpioPort port;
+        common::hal::FakeClock clock;
+        Recorder multi_recorder(port, clock);
+
+        // WHEN we add buses with bad pins
+        // THEN they're rejected
+        TEST_ASSERT_FALSE(multi_recorder.add_bus(40, 1));
+        TEST_ASSERT_FALSE(multi_recorder.add_bus(1, 1));
+        TEST_ASSERT_TRUE(multi_recorder.add_bus(0, 1));
+        TEST_ASSERT_FALSE(multi_recorder.add_bus(1, 2));
+        TEST_ASSERT_TRUE(multi_recorder.add_bus(2, 3));
+        TEST_ASSERT_TRUE(multi_recorder.add_bus(4, 5));
+        TEST_ASSERT_TRUE(multi_recorder.add_bus(6, 7));
+        TEST_ASSERT_FALSE(multi_recorder.add_bus(8, 9));
+        TEST_ASSERT_EQUAL_UINT32(Recorder::MAX_BUSES, multi_recorder.bus_count());
+    }
+
+    static void start_needs_a_trace_for_each_bus() {
+        // GIVEN a recorder with 2 buses
+        common::hal::FakeGpioPort port;
+        common::hal::FakeClock clock;
+        Recorder multi_recorder(port, clock);
+        multi_recorder.add_bus(SDA_0, SCL_0);
+        multi_recorder.add_bus(SDA_1, SCL_1);
+        BusTrace trace(MAX_EVENTS);
+        BusTrace* traces[] = {&trace, &trace};
+
+        // WHEN we start it incorrectly
+        // THEN it fails
+        TEST_ASSERT_FALSE(multi_recorder.start(traces, 2));     // No callback
+        multi_recorder.set_callback([]() {});
+        TEST_ASSERT_FALSE(multi_recorder.start(traces, 1));
+        TEST_ASSERT_FALSE(multi_recorder.is_recording());
+        TEST_ASSERT_EQUAL_UINT32(0, port.enabled_mask);
+    }
+
+    static void records_each_bus_in_its_own_trace() {
+        // GIVEN 2 buses
+        common::hal::FakeGpioPort port;
+        common::hal::FakeClock clock;
+        Recorder multi_recorder(port, clock);
+        BusTrace trace0(&clock, MAX_EVENTS);
+        BusTrace trace1(&clock, MAX_EVENTS);
+        given_2_buses(multi_recorder, port, trace0, trace1);
+        TEST_ASSERT_EQUAL_UINT32(port.pin_mask(SDA_0) | port.pin_mask(SCL_0) | port.pin_mask(SDA_1) | port.pin_mask(SCL_1),
+                                 port.enabled_mask);
+
+        // WHEN each bus changes
+        clock.system_tick += 100;
+        port.set_pin(SDA_0, false);
+        port.isr();
+        clock.system_tick += 50;
+        port.set_pin(SCL_1, true);
+        port.isr();
+
+        // THEN the traces start with the initial line states
+        TEST_ASSERT_EQUAL_UINT32(2, trace0.event_count());
+        TEST_ASSERT_TRUE(BusEvent(0, SDA_LINE_STATE | SCL_LINE_STATE) == *trace0.event(0));
+        TEST_ASSERT_EQUAL_UINT32(2, trace1.event_count());
+        TEST_ASSERT_TRUE(BusEvent(0, SDA_LINE_STATE) == *trace1.event(0));
+
+        // AND each trace only has events from its own bus
+        TEST_ASSERT_TRUE(BusEvent(100, SDA_LINE_CHANGED | SCL_LINE_STATE) == *trace0.event(1));
+        TEST_ASSERT_TRUE(BusEvent(150, SCL_LINE_CHANGED | SCL_LINE_STATE | SDA_LINE_STATE) == *trace1.event(1));
+        TEST_ASSERT_EQUAL_UINT32(100 * clock.nanos_per_tick, multi_recorder.nanos_since_start(trace0, 1));
+        TEST_ASSERT_EQUAL_UINT32(150 * clock.nanos_per_tick, multi_recorder.nanos_since_start(trace1, 1));
+    }
+
+    static void buses_share_a_timebase() {
+        // GIVEN 2 buses
+        common::hal::FakeGpioPort port;
+        common::hal::FakeClock clock;
+        Recorder multi_recorder(port, clock);
+        BusTrace trace0(&clock, MAX_EVENTS);
+        BusTrace trace1(&clock, MAX_EVENTS);
+        given_2_buses(multi_recorder, port, trace0, trace1);
+
+        // WHEN the buses change at different times and then at the same time
+        clock.system_tick += 70;
+        port.set_pin(SCL_0, false);
+        port.isr();
+        clock.system_tick += 200'000;
+        port.set_pin(SCL_0, true);
+        port.set_pin(SDA_1, false);
+        port.isr();
+
+        // THEN the simultaneous events are the same time after the start
+        // Both long gaps need a time extension
+        TEST_ASSERT_EQUAL_UINT32(4, trace0.event_count());
+        TEST_ASSERT_EQUAL_UINT32(3, trace1.event_count());
+        TEST_ASSERT_EQUAL_UINT32(200'070 * clock.nanos_per_tick, multi_recorder.nanos_since_start(trace0, 3));
+        TEST_ASSERT_EQUAL_UINT32(200'070 * clock.nanos_per_tick, multi_recorder.nanos_since_start(trace1, 2));
+        // AND there's no time for an event that doesn't exist
+        TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, multi_recorder.nanos_since_start(trace1, 3));
+    }
+
+    static void records_glitches_and_merged_events() {
+        // GIVEN 2 buses
+        common::hal::FakeGpioPort port;
+        common::hal::FakeClock clock;
+        Recorder multi_recorder(port, clock);
+        BusTrace trace0(MAX_EVENTS);
+        BusTrace trace1(MAX_EVENTS);
+        given_2_buses(multi_recorder, port, trace0, trace1);
+
+        // WHEN one bus glitches and both lines of the other change at once
+        clock.system_tick += 30;
+        port.glitch(SDA_0);
+        port.set_pin(SDA_1, false);
+        port.set_pin(SCL_1, true);
+        port.isr();
+
+        // THEN the glitch is recorded as 2 events
+        TEST_ASSERT_EQUAL_UINT32(3, trace0.event_count());
+        TEST_ASSERT_TRUE(BusEvent(30, SDA_LINE_CHANGED | SCL_LINE_STATE) == *trace0.event(1));
+        TEST_ASSERT_TRUE(BusEvent(0, SDA_LINE_CHANGED | SDA_LINE_STATE | SCL_LINE_STATE) == *trace0.event(2));
+        TEST_ASSERT_EQUAL_UINT32(1, multi_recorder.statistics(0).glitches);
+
+        // AND the merged edges are recorded as 1 event
+        TEST_ASSERT_EQUAL_UINT32(2, trace1.event_count());
+        TEST_ASSERT_TRUE(BusEvent(30, SDA_LINE_CHANGED | SCL_LINE_CHANGED | SCL_LINE_STATE) == *trace1.event(1));
+        TEST_ASSERT_EQUAL_UINT32(1, multi_recorder.statistics(1).merged_events);
+        TEST_ASSERT_EQUAL_UINT32(0, multi_recorder.statistics(1).glitches);
+    }
+
+    static void stop_keeps_statistics() {
+        // GIVEN a recording where a trace filled up
+        common::hal::FakeGpioPort port;
+        common::hal::FakeClock clock;
+        Recorder multi_recorder(port, clock);
+        BusTrace trace0(2);
+        BusTrace trace1(MAX_EVENTS);
+        given_2_buses(multi_recorder, port, trace0, trace1);
+        for (int i = 0; i < 4; ++i) {
+            clock.system_tick += 10;
+            port.set_pin(SCL_0, i % 2);
+            port.isr();
+        }
+
+        // WHEN we stop recording
+        multi_recorder.stop();
+
+        // THEN interrupts are disabled and the statistics are kept
+        TEST_ASSERT_FALSE(multi_recorder.is_recording());
+        TEST_ASSERT_EQUAL_UINT32(0, port.enabled_mask);
+        TEST_ASSERT_EQUAL_UINT32(3, multi_recorder.statistics(0).dropped_events);
+        TEST_ASSERT_FALSE(multi_recorder.statistics(0).is_complete());
+        TEST_ASSERT_TRUE(multi_recorder.statistics(1).is_complete());
+    }
+
+public:
+    void test() final {
+        RUN_TEST(add_bus_rejects_invalid_pins);
+        RUN_TEST(start_needs_a_trace_for_each_bus);
+        RUN_TEST(records_each_bus_in_its_own_trace);
+        RUN_TEST(buses_share_a_timebase);
+        RUN_TEST(records_glitches_and_merged_events);
+        RUN_TEST(stop_keeps_statistics);
+    }
+
+    MultiBusRecorderTest() : TestSuite(__FILE__) {};
+};
+
+MultiBusRecorderTest::Recorder* MultiBusRecorderTest::recorder = nullptr;
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_MULTI_BUS_RECORDER_TEST_H
@@ -0,0 +1,229 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_PACKED_BUS_TRACE_TEST_H
+#define I2C_UNDERNEATH_PACKED_BUS_TRACE_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "bus_trace/bus_trace_builder.h"
+#include "bus_trace/packed_bus_trace.h"
+
+namespace bus_trace {
+
+class PackedBusTraceTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+    static const size_t MAX_BYTES = 4096;
+
+    static void given_messages(BusTrace& trace) {
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Max, common::i2c_specification::FastMode);
+        builder.bus_initially_idle();
+        for (uint8_t i = 0; i < 4; ++i) {
+            builder.start_bit()
+                    .address_byte(0x53, BusTraceBuilder::WRITE).ack()
+                    .data_byte(0x58 + i).ack()
+                    .data_byte(0xA7 - i).nack()
+                    .stop_bit();
+        }
+    }
+
+public:
+    static void round_trip_message() {
+        // GIVEN a trace of some I2C messages
+        BusTrace expected(MAX_EVENTS);
+        given_messages(expected);
+
+        // WHEN we pack it and unpack it again
+        PackedBusTrace packed(MAX_BYTES);
+        packed.pack(expected);
+        BusTrace actual(MAX_EVENTS);
+        packed.unpack(actual);
+
+        // THEN the events are unchanged
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), packed.event_count());
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), actual.event_count());
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(actual));
+    }
+
+    static void packed_trace_is_smaller() {
+        // GIVEN a trace of some I2C messages
+        BusTrace trace(MAX_EVENTS);
+        given_messages(trace);
+
+        // WHEN we pack it
+        PackedBusTrace packed(MAX_BYTES);
+        packed.pack(trace);
+
+        // THEN it takes less than half the space
+        size_t unpacked_size = trace.event_count() * sizeof(BusEvent);
+        TEST_ASSERT_LESS_THAN_UINT32(unpacked_size / 2, packed.byte_count());
+    }
+
+    static void round_trip_unusual_events() {
+        // GIVEN events with extreme deltas, pin flags and no changes
+        BusTrace expected(MAX_EVENTS);
+        expected.add_event(BusEvent(0, BusEventFlags::BOTH_LOW_AND_UNCHANGED));
+        expected.add_event(BusEvent(UINT16_MAX, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE));
+        expected.add_event(BusEvent(0, BusEventFlags::SDA_LINE_CHANGED));
+        expected.add_event(BusEvent(UINT16_MAX, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE));
+        expected.add_event(BusEvent(17, BusEventFlags::SCL_PIN_CHANGED | BusEventFlags::SCL_LINE_STATE));
+        expected.add_event(BusEvent(12'345, BusEventFlags::SDA_PIN_CHANGED | BusEventFlags::SDA_LINE_CHANGED));
+        expected.add_event(BusEvent(1, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        expected.add_event(BusEvent(UINT16_MAX, BusEventFlags::SCL_LINE_CHANGED));
+
+        // WHEN we pack it and unpack it again
+        PackedBusTrace packed(MAX_BYTES);
+        packed.pack(expected);
+        BusTrace actual(MAX_EVENTS);
+        packed.unpack(actual);
+
+        // THEN the events are unchanged
+        TEST_ASSERT_EQUAL_UINT32(expected.event_count(), actual.event_count());
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(actual));
+    }
+
+    static void iterate_over_events() {
+        // GIVEN a packed trace
+        BusTrace trace(MAX_EVENTS);
+        given_messages(trace);
+        PackedBusTrace packed(MAX_BYTES);
+        packed.pack(trace);
+
+        // WHEN we iterate over it
+        size_t index = 0;
+        for (const BusEvent& event : packed) {
+            // THEN we get the original events
+            TEST_ASSERT_TRUE(event == *trace.event(index));
+            index++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(trace.event_count(), index);
+    }
+
+    static void empty_trace() {
+        // GIVEN an empty trace
+        PackedBusTrace packed(MAX_BYTES);
+
+        // THEN it has no events
+        TEST_ASSERT_EQUAL_UINT32(0, packed.event_count());
+        TEST_ASSERT_EQUAL_UINT32(0, packed.byte_count());
+        TEST_ASSERT_TRUE(packed.begin() == packed.end());
+    }
+
+    static void drops_events_when_full() {
+        // GIVEN a small packed trace
+        uint8_t buffer[10];
+        PackedBusTrace packed(buffer, sizeof(buffer));
+
+        // WHEN we add more events than it can hold
+        for (int i = 0; i < 10; ++i) {
+            packed.add_event(BusEvent(UINT16_MAX, BusEventFlags::SCL_LINE_CHANGED));
+        }
+
+        // THEN the extra events are dropped
+        TEST_ASSERT_LESS_THAN_UINT32(10, packed.event_count());
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(sizeof(buffer), packed.byte_count());
+        TEST_ASSERT_EQUAL_UINT32(10 - packed.event_count(), packed.dropped_event_count());
+        size_t count = 0;
+        for (const BusEvent& event : packed) {
+            TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, event.delta_t_in_ticks);
+            count++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(packed.event_count(), count);
+    }
+
+    static void events_after_a_dropped_time_extension_are_dropped() {
+        // GIVEN a packed trace with room for 1 event but not for a time extension as well
+        uint8_t buffer[2 * PackedBusTrace::MAX_BYTES_PER_EVENT - 1];
+        PackedBusTrace packed(buffer, sizeof(buffer));
+
+        // WHEN we add an event after a long gap followed by some short events
+        packed.add_event(100'000, BusEventFlags::SDA_LINE_CHANGED);
+        packed.add_event(100'010, BusEventFlags::SCL_LINE_CHANGED);
+        packed.add_event(100'020, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE);
+
+        // THEN all the events are dropped so the trace doesn't have a gap
+        TEST_ASSERT_EQUAL_UINT32(0, packed.event_count());
+        TEST_ASSERT_EQUAL_UINT32(3, packed.dropped_event_count());
+        // AND the overflow isn't counted as the event wasn't stored
+        TEST_ASSERT_EQUAL_UINT32(0, packed.delta_overflow_count());
+
+        // AND reset() makes room again
+        packed.reset();
+        packed.add_event(10, BusEventFlags::SCL_LINE_CHANGED);
+        TEST_ASSERT_EQUAL_UINT32(1, packed.event_count());
+    }
+
+    static void add_event_with_tick_count() {
+        // GIVEN a packed trace that was reset at a known time
+        PackedBusTrace packed(MAX_BYTES);
+        packed.reset(1'000);
+
+        // WHEN we add events with timestamps
+        packed.add_event(1'100, BusEventFlags::SDA_LINE_CHANGED);
+        packed.add_event(1'350, BusEventFlags::SCL_LINE_CHANGED);
+
+        // THEN the deltas are the differences between the timestamps
+        BusTrace actual(MAX_EVENTS);
+        packed.unpack(actual);
+        TEST_ASSERT_EQUAL_UINT32(2, actual.event_count());
+        TEST_ASSERT_EQUAL_UINT16(100, actual.event(0)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT16(250, actual.event(1)->delta_t_in_ticks);
+    }
+
+    static void add_event_records_long_gaps_with_time_extension() {
+        // GIVEN a packed trace
+        PackedBusTrace packed(MAX_BYTES);
+        packed.reset(0);
+
+        // WHEN we add an event that's too far from the previous one for a BusEvent
+        packed.add_event(10, BusEventFlags::SDA_LINE_CHANGED);
+        packed.add_event(10 + 3'000'000, BusEventFlags::SCL_LINE_CHANGED);
+
+        // THEN it's preceded by a time extension
+        BusTrace actual(MAX_EVENTS);
+        packed.unpack(actual);
+        TEST_ASSERT_EQUAL_UINT32(3, actual.event_count());
+        TEST_ASSERT_EQUAL_UINT32(1, packed.delta_overflow_count());
+        TEST_ASSERT_TRUE(actual.event(1)->is_time_extension());
+        TEST_ASSERT_EQUAL_UINT32(3'000'000, actual.event(1)->ticks() + actual.event(2)->ticks());
+    }
+
+    static void reset() {
+        // GIVEN a packed trace with some events
+        BusTrace trace(MAX_EVENTS);
+        given_messages(trace);
+        PackedBusTrace packed(MAX_BYTES);
+        packed.pack(trace);
+
+        // WHEN we reset it and pack the trace again
+        packed.reset();
+        TEST_ASSERT_EQUAL_UINT32(0, packed.event_count());
+        TEST_ASSERT_EQUAL_UINT32(0, packed.byte_count());
+        packed.pack(trace);
+
+        // THEN we get the same events
+        BusTrace actual(MAX_EVENTS);
+        packed.unpack(actual);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, trace.is_identical_to(actual));
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(round_trip_message);
+        RUN_TEST(packed_trace_is_smaller);
+        RUN_TEST(round_trip_unusual_events);
+        RUN_TEST(iterate_over_events);
+        RUN_TEST(empty_trace);
+        RUN_TEST(drops_events_when_full);
+        RUN_TEST(events_after_a_dropped_time_extension_are_dropped);
+        RUN_TEST(add_event_with_tick_count);
+        RUN_TEST(add_event_records_long_gaps_with_time_extension);
+        RUN_TEST(reset);
+    }
+
+    PackedBusTraceTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_PACKED_BUS_TRACE_TEST_H
@@ -0,0 +1,356 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_SIGROK_SESSION_TEST_H
+#define I2C_UNDERNEATH_SIGROK_SESSION_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "fakes/common/hal/fake_clock.h"
+#include "bus_trace/bus_trace_builder.h"
+#include "bus_trace/sigrok_session.h"
+
+namespace bus_trace {
+
+class SigrokSessionTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+    // The FakeClock runs at 500 MHz so there are 250 ticks per sample
+    static const uint64_t SAMPLERATE = 2'000'000;
+    static const uint16_t TICKS_PER_SAMPLE = 250;
+
+    // Collects the bytes written to it.
+    class ByteSink : public Print {
+    public:
+        size_t write(uint8_t b) override {
+            if (size < sizeof(data)) {
+                data[size++] = b;
+                return 1;
+            }
+            return 0;
+        }
+
+        using Print::write;
+
+        uint8_t data[8192] = {};
+        size_t size = 0;
+    };
+
+    // The session in these fixtures has 15 samples at 2 MHz:
+    //   4 x idle, 2 x SDA low, 3 x both low, 1 x SDA high, 5 x idle
+    static void then_fixture_events_match(const BusTrace& trace) {
+        BusTrace expected(MAX_EVENTS);
+        expected.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        expected.add_event(BusEvent(4 * TICKS_PER_SAMPLE, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+        expected.add_event(BusEvent(2 * TICKS_PER_SAMPLE, BusEventFlags::SCL_LINE_CHANGED));
+        expected.add_event(BusEvent(3 * TICKS_PER_SAMPLE, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE));
+        expected.add_event(BusEvent(1 * TICKS_PER_SAMPLE, BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE | BusEventFlags::SDA_LINE_STATE));
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.is_identical_to(trace));
+    }
+
+public:
+    static void write_samples_at_chosen_samplerate() {
+        // GIVEN a trace
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(500, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(1000, BusEventFlags::SCL_LINE_CHANGED));
+
+        // WHEN we write the samples at 1 MHz
+        ByteSink sink;
+        size_t count = SigrokSession::write_samples(trace, sink, 1'000'000);
+
+        // THEN there's a sample every microsecond
+        // SDA is bit 0 and SCL is bit 1
+        const uint8_t expected[] = {0x03, 0x02, 0x02, 0x00};
+        TEST_ASSERT_EQUAL_UINT32(sizeof(expected), count);
+        TEST_ASSERT_EQUAL_UINT32(sizeof(expected), sink.size);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sink.data, sizeof(expected));
+    }
+
+    static void edges_within_one_sample_are_merged() {
+        // GIVEN a glitch that's shorter than the sample period
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(10, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(500, BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE));
+
+        // WHEN we write the samples
+        ByteSink sink;
+        SigrokSession::write_samples(trace, sink, 1'000'000);
+
+        // THEN the glitch disappears
+        const uint8_t expected[] = {0x03, 0x03, 0x01};
+        TEST_ASSERT_EQUAL_UINT32(sizeof(expected), sink.size);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, sink.data, sizeof(expected));
+    }
+
+    static void trace_must_have_a_clock() {
+        // GIVEN a trace without a clock
+        BusTrace trace(MAX_EVENTS);
+        trace.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+
+        // THEN it can't be converted to samples
+        ByteSink sink;
+        TEST_ASSERT_EQUAL_UINT32(0, SigrokSession::write(trace, sink, SAMPLERATE));
+        TEST_ASSERT_EQUAL_UINT32(0, SigrokSession::write_samples(trace, sink, SAMPLERATE));
+        TEST_ASSERT_EQUAL_UINT32(0, sink.size);
+    }
+
+    static void round_trip() {
+        // GIVEN some messages
+        common::hal::FakeClock clock;
+        BusTrace expected(&clock, MAX_EVENTS);
+        BusTraceBuilder builder(expected, BusTraceBuilder::TimingStrategy::Max, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle()
+                .start_bit()
+                .address_byte(0x53, BusTraceBuilder::WRITE).ack()
+                .data_byte(0x58).ack()
+                .data_byte(0xA7).nack()
+                .stop_bit();
+
+        // WHEN we write a session and read it back again
+        ByteSink sink;
+        size_t count = SigrokSession::write(expected, sink, 4'000'000);
+        BusTrace actual(&clock, MAX_EVENTS);
+        SigrokSessionInfo info;
+        bool ok = SigrokSession::read(sink.data, sink.size, actual, &info);
+
+        // THEN we get the same messages
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT32(sink.size, count);
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, expected.compare_messages(actual));
+        // AND the session describes the samples
+        TEST_ASSERT_EQUAL_UINT64(4'000'000, info.samplerate);
+        TEST_ASSERT_EQUAL_UINT8(2, info.total_probes);
+        TEST_ASSERT_EQUAL_UINT8(1, info.unit_size);
+        TEST_ASSERT_EQUAL_UINT8(SigrokSession::SDA_PROBE, info.sda_probe);
+        TEST_ASSERT_EQUAL_UINT8(SigrokSession::SCL_PROBE, info.scl_probe);
+        // AND the timings are accurate to within one sample
+        uint32_t duration = expected.nanos_between(expected.event_count() - 1, 0);
+        TEST_ASSERT_UINT32_WITHIN(250, duration, actual.nanos_between(actual.event_count() - 1, 0));
+    }
+
+    static void read_session_from_another_tool() {
+        // GIVEN a session file created by a standard zip library
+        // with 2 bytes per sample. SCL is probe 3 and SDA is probe 10.
+        // The samples are split into 2 chunks in the middle of a sample.
+        // Probe 1 toggles on every sample.
+        static const uint8_t STORED_SESSION[] = {
+                0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0x0d, 0xbe,
+                0xd5, 0x1a, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x76, 0x65,
+                0x72, 0x73, 0x69, 0x6f, 0x6e, 0x32, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00,
+                0xf3, 0x0d, 0x51, 0x5d, 0x54, 0x64, 0x33, 0x1e, 0xa5, 0x00, 0x00, 0x00, 0xa5, 0x00, 0x00, 0x00,
+                0x08, 0x00, 0x00, 0x00, 0x6d, 0x65, 0x74, 0x61, 0x64, 0x61, 0x74, 0x61, 0x5b, 0x67, 0x6c, 0x6f,
+                0x62, 0x61, 0x6c, 0x5d, 0x0d, 0x0a, 0x73, 0x69, 0x67, 0x72, 0x6f, 0x6b, 0x20, 0x76, 0x65, 0x72,
+                0x73, 0x69, 0x6f, 0x6e, 0x3d, 0x30, 0x2e, 0x35, 0x2e, 0x32, 0x0d, 0x0a, 0x0d, 0x0a, 0x5b, 0x64,
+                0x65, 0x76, 0x69, 0x63, 0x65, 0x20, 0x31, 0x5d, 0x0d, 0x0a, 0x63, 0x61, 0x70, 0x74, 0x75, 0x72,
+                0x65, 0x66, 0x69, 0x6c, 0x65, 0x3d, 0x6c, 0x6f, 0x67, 0x69, 0x63, 0x2d, 0x31, 0x0d, 0x0a, 0x74,
+                0x6f, 0x74, 0x61, 0x6c, 0x20, 0x70, 0x72, 0x6f, 0x62, 0x65, 0x73, 0x3d, 0x33, 0x0d, 0x0a, 0x73,
+                0x61, 0x6d, 0x70, 0x6c, 0x65, 0x72, 0x61, 0x74, 0x65, 0x3d, 0x32, 0x20, 0x4d, 0x48, 0x7a, 0x0d,
+                0x0a, 0x74, 0x6f, 0x74, 0x61, 0x6c, 0x20, 0x61, 0x6e, 0x61, 0x6c, 0x6f, 0x67, 0x3d, 0x30, 0x0d,
+                0x0a, 0x70, 0x72, 0x6f, 0x62, 0x65, 0x31, 0x3d, 0x44, 0x30, 0x0d, 0x0a, 0x70, 0x72, 0x6f, 0x62,
+                0x65, 0x33, 0x3d, 0x73, 0x63, 0x6c, 0x0d, 0x0a, 0x70, 0x72, 0x6f, 0x62, 0x65, 0x31, 0x30, 0x3d,
+                0x73, 0x64, 0x61, 0x0d, 0x0a, 0x75, 0x6e, 0x69, 0x74, 0x73, 0x69, 0x7a, 0x65, 0x3d, 0x32, 0x0d,
+                0x0a, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0xa2,
+                0x78, 0x40, 0x06, 0x0b, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x6c,
+                0x6f, 0x67, 0x69, 0x63, 0x2d, 0x31, 0x2d, 0x31, 0x04, 0x82, 0x05, 0x82, 0x04, 0x82, 0x05, 0x82,
+                0x04, 0x80, 0x05, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf3, 0x0d, 0x51,
+                0x5d, 0xe7, 0x9a, 0x1b, 0xfa, 0x13, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00,
+                0x00, 0x6c, 0x6f, 0x67, 0x69, 0x63, 0x2d, 0x31, 0x2d, 0x32, 0x80, 0x00, 0x80, 0x01, 0x80, 0x00,
+                0x80, 0x01, 0x82, 0x04, 0x82, 0x05, 0x82, 0x04, 0x82, 0x05, 0x82, 0x04, 0x82, 0x50, 0x4b, 0x01,
+                0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0x0d, 0xbe, 0xd5,
+                0x1a, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x76, 0x65, 0x72, 0x73, 0x69,
+                0x6f, 0x6e, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf3, 0x0d,
+                0x51, 0x5d, 0x54, 0x64, 0x33, 0x1e, 0xa5, 0x00, 0x00, 0x00, 0xa5, 0x00, 0x00, 0x00, 0x08, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x26, 0x00, 0x00, 0x00,
+                0x6d, 0x65, 0x74, 0x61, 0x64, 0x61, 0x74, 0x61, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0xa2, 0x78, 0x40, 0x06, 0x0b, 0x00, 0x00, 0x00,
+                0x0b, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                0x80, 0x01, 0xf1, 0x00, 0x00, 0x00, 0x6c, 0x6f, 0x67, 0x69, 0x63, 0x2d, 0x31, 0x2d, 0x31, 0x50,
+                0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0xe7,
+                0x9a, 0x1b, 0xfa, 0x13, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x23, 0x01, 0x00, 0x00, 0x6c, 0x6f, 0x67,
+                0x69, 0x63, 0x2d, 0x31, 0x2d, 0x32, 0x50, 0x4b, 0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+                0x04, 0x00, 0xd9, 0x00, 0x00, 0x00, 0x5d, 0x01, 0x00, 0x00, 0x00, 0x00,
+        };
+        // WHEN we read it
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        SigrokSessionInfo info;
+        bool ok = SigrokSession::read(STORED_SESSION, sizeof(STORED_SESSION), trace, &info, "sda", "scl");
+
+        // THEN the probes are found by name regardless of case
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT8(10, info.sda_probe);
+        TEST_ASSERT_EQUAL_UINT8(3, info.scl_probe);
+        TEST_ASSERT_EQUAL_UINT8(2, info.unit_size);
+        TEST_ASSERT_EQUAL_UINT64(15, info.sample_count);
+        TEST_ASSERT_EQUAL_UINT64(SAMPLERATE, info.samplerate);
+        // AND we get one event for each change
+        then_fixture_events_match(trace);
+    }
+
+    static void read_compressed_session() {
+        // GIVEN a compressed session file like the ones PulseView writes
+        // It has the fixture samples repeated 20 times.
+        static const uint8_t COMPRESSED_SESSION[] = {
+                0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0x0d, 0xbe,
+                0xd5, 0x1a, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x76, 0x65,
+                0x72, 0x73, 0x69, 0x6f, 0x6e, 0x33, 0x02, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00,
+                0x08, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0x16, 0x46, 0x6c, 0x1d, 0x7a, 0x00, 0x00, 0x00, 0x8e, 0x00,
+                0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x6d, 0x65, 0x74, 0x61, 0x64, 0x61, 0x74, 0x61, 0x2d, 0x8b,
+                0x31, 0x0e, 0xc2, 0x30, 0x0c, 0x00, 0x77, 0xbf, 0x22, 0x1f, 0xa0, 0x6a, 0x22, 0x75, 0xf4, 0x80,
+                0x60, 0x60, 0x80, 0xa9, 0x63, 0xd5, 0xc1, 0x0d, 0x26, 0xb2, 0x08, 0x71, 0x94, 0xa4, 0x1d, 0xfa,
+                0x7a, 0x10, 0xb0, 0x9d, 0x74, 0x77, 0x53, 0x88, 0xba, 0x50, 0x9c, 0xa1, 0x4a, 0x28, 0xfa, 0x34,
+                0x1b, 0x97, 0x2a, 0x9a, 0xb0, 0xef, 0x86, 0xce, 0x01, 0x4c, 0x77, 0xde, 0xc4, 0xb3, 0xb1, 0x33,
+                0x78, 0xca, 0x6d, 0x2d, 0xfc, 0x90, 0xc8, 0x18, 0x35, 0x88, 0x3f, 0x58, 0x68, 0xda, 0x28, 0x9a,
+                0x5c, 0x74, 0xe1, 0x8a, 0x0e, 0x2a, 0xbd, 0x72, 0xe4, 0x42, 0x8d, 0xd1, 0x99, 0xdb, 0x65, 0xff,
+                0x7b, 0x4a, 0xf4, 0x19, 0xb0, 0x87, 0x6f, 0x68, 0x71, 0x3c, 0x1f, 0x7f, 0xe8, 0x70, 0x3c, 0x5d,
+                0x61, 0x4d, 0xd2, 0xaa, 0xec, 0x8c, 0x16, 0xde, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x00, 0x00,
+                0x08, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0x72, 0xe9, 0x90, 0xa8, 0x12, 0x00, 0x00, 0x00, 0x2c, 0x01,
+                0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x6c, 0x6f, 0x67, 0x69, 0x63, 0x2d, 0x31, 0x2d, 0x31, 0x63,
+                0x66, 0x66, 0x66, 0x66, 0x62, 0x62, 0x60, 0x60, 0x60, 0x64, 0x86, 0x81, 0x51, 0x2e, 0x0e, 0x2e,
+                0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xf3, 0x0d, 0x51,
+                0x5d, 0x0d, 0xbe, 0xd5, 0x1a, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x76,
+                0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x00, 0x00,
+                0x08, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0x16, 0x46, 0x6c, 0x1d, 0x7a, 0x00, 0x00, 0x00, 0x8e, 0x00,
+                0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x01,
+                0x28, 0x00, 0x00, 0x00, 0x6d, 0x65, 0x74, 0x61, 0x64, 0x61, 0x74, 0x61, 0x50, 0x4b, 0x01, 0x02,
+                0x14, 0x03, 0x14, 0x00, 0x00, 0x00, 0x08, 0x00, 0xf3, 0x0d, 0x51, 0x5d, 0x72, 0xe9, 0x90, 0xa8,
+                0x12, 0x00, 0x00, 0x00, 0x2c, 0x01, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                0x00, 0x00, 0x00, 0x00, 0x80, 0x01, 0xc8, 0x00, 0x00, 0x00, 0x6c, 0x6f, 0x67, 0x69, 0x63, 0x2d,
+                0x31, 0x2d, 0x31, 0x50, 0x4b, 0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00, 0xa2,
+                0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00,
+        };
+        // WHEN we read it
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        SigrokSessionInfo info;
+        bool ok = SigrokSession::read(COMPRESSED_SESSION, sizeof(COMPRESSED_SESSION), trace, &info);
+
+#if defined(I2C_UNDERNEATH_HAVE_ZLIB)
+        // THEN it's decompressed
+        TEST_ASSERT_TRUE(ok);
+        TEST_ASSERT_EQUAL_UINT64(15 * 20, info.sample_count);
+        TEST_ASSERT_EQUAL_UINT32(1 + 20 * 4, trace.event_count());
+        BusTrace first(MAX_EVENTS);
+        for (size_t i = 0; i < 5; ++i) {
+            first.add_event(*trace.event(i));
+        }
+        then_fixture_events_match(first);
+#else
+        // THEN it's rejected as we can't decompress it
+        TEST_ASSERT_FALSE(ok);
+#endif
+    }
+
+    static void rejects_invalid_session() {
+        // GIVEN a valid session file
+        common::hal::FakeClock clock;
+        BusTrace expected(&clock, MAX_EVENTS);
+        BusTraceBuilder builder(expected, BusTraceBuilder::TimingStrategy::Max, common::i2c_specification::StandardMode);
+        builder.bus_initially_idle().start_bit().address_byte(0x53, BusTraceBuilder::READ).nack().stop_bit();
+        ByteSink sink;
+        SigrokSession::write(expected, sink, SAMPLERATE);
+        BusTrace actual(&clock, MAX_EVENTS);
+        TEST_ASSERT_TRUE(SigrokSession::read(sink.data, sink.size, actual));
+
+        // THEN it's rejected if it doesn't have the probes we need
+        TEST_ASSERT_FALSE(SigrokSession::read(sink.data, sink.size, actual, nullptr, "SDA", "CLK"));
+
+        // AND it's rejected if it's truncated
+        TEST_ASSERT_FALSE(SigrokSession::read(sink.data, sink.size - 1, actual));
+
+        // AND it's rejected if the samples are corrupt
+        // The last sample comes just before the zip file's central directory
+        const uint8_t* end_record = sink.data + sink.size - 22;
+        size_t directory = end_record[16] | (end_record[17] << 8);
+        sink.data[directory - 1] ^= 0x01;
+        TEST_ASSERT_FALSE(SigrokSession::read(sink.data, sink.size, actual));
+    }
+
+    static void decoder_uses_sample_number_without_clock() {
+        // GIVEN a trace without a clock
+        BusTrace trace(MAX_EVENTS);
+        LogicSampleDecoder decoder(trace, SAMPLERATE);
+
+        // WHEN we add some samples
+        const uint8_t samples[] = {0x03, 0x03, 0x03, 0x01, 0x00};
+        decoder.add_samples(samples, sizeof(samples));
+
+        // THEN each sample is one tick
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT16(3, trace.event(1)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL(BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE, trace.event(1)->flags);
+        TEST_ASSERT_EQUAL_UINT16(1, trace.event(2)->delta_t_in_ticks);
+        TEST_ASSERT_EQUAL_UINT64(5, decoder.sample_count());
+    }
+
+    static void decoder_adds_time_extension_for_long_gaps() {
+        // GIVEN a slow samplerate
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        LogicSampleDecoder decoder(trace, 1'000);
+
+        // WHEN the lines change after one sample
+        const uint8_t samples[] = {0x03, 0x02};
+        decoder.add_samples(samples, sizeof(samples));
+
+        // THEN the gap of 1 ms is too long for a single event
+        TEST_ASSERT_EQUAL_UINT32(3, trace.event_count());
+        TEST_ASSERT_TRUE(trace.event(1)->is_time_extension());
+        TEST_ASSERT_EQUAL_UINT32(1'000'000, trace.nanos_between(2, 0));
+    }
+
+    static void decoder_ignores_samples_if_arguments_are_invalid() {
+        // GIVEN decoders with an invalid unit size or probe bit
+        BusTrace trace(MAX_EVENTS);
+        LogicSampleDecoder empty_units(trace, SAMPLERATE, 0, 1, 0);
+        LogicSampleDecoder huge_units(trace, SAMPLERATE, 0, 1, LogicSampleDecoder::MAX_UNIT_SIZE + 1);
+        LogicSampleDecoder bad_sda(trace, SAMPLERATE, 8, 1, 1);
+        LogicSampleDecoder bad_scl(trace, SAMPLERATE, 0, 16, 2);
+        LogicSampleDecoder good(trace, SAMPLERATE, 0, 15, 2);
+
+        // WHEN we add some samples
+        const uint8_t samples[] = {0x03, 0x03, 0x01, 0x00, 0x00};
+        empty_units.add_samples(samples, sizeof(samples));
+        huge_units.add_samples(samples, sizeof(samples));
+        bad_sda.add_samples(samples, sizeof(samples));
+        bad_scl.add_samples(samples, sizeof(samples));
+
+        // THEN they're ignored
+        TEST_ASSERT_FALSE(empty_units.is_valid());
+        TEST_ASSERT_FALSE(huge_units.is_valid());
+        TEST_ASSERT_FALSE(bad_sda.is_valid());
+        TEST_ASSERT_FALSE(bad_scl.is_valid());
+        TEST_ASSERT_TRUE(good.is_valid());
+        TEST_ASSERT_EQUAL_UINT32(0, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT64(0, empty_units.sample_count());
+        TEST_ASSERT_EQUAL_UINT64(0, huge_units.sample_count());
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(write_samples_at_chosen_samplerate);
+        RUN_TEST(edges_within_one_sample_are_merged);
+        RUN_TEST(trace_must_have_a_clock);
+        RUN_TEST(round_trip);
+        RUN_TEST(read_session_from_another_tool);
+        RUN_TEST(read_compressed_session);
+        RUN_TEST(rejects_invalid_session);
+        RUN_TEST(decoder_uses_sample_number_without_clock);
+        RUN_TEST(decoder_adds_time_extension_for_long_gaps);
+        RUN_TEST(decoder_ignores_samples_if_arguments_are_invalid);
+    }
+
+    SigrokSessionTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_SIGROK_SESSION_TEST_H
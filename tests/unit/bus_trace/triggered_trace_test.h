@@ -0,0 +1,178 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_TRIGGERED_TRACE_TEST_H
+#define I2C_UNDERNEATH_TRIGGERED_TRACE_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "utils/bus_trace_fixtures.h"
+#include "bus_trace/triggered_trace.h"
+
+namespace bus_trace {
+
+class TriggeredTraceTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+    static size_t callback_count;
+
+    static void on_complete(TriggeredTrace&) {
+        callback_count++;
+    }
+
+    // Returns the total number of ticks at the end of the trace
+    static uint32_t replay(const BusTrace& source, TriggeredTrace& capture) {
+        uint32_t tick = 0;
+        for (size_t i = 0; i < source.event_count(); ++i) {
+            tick += source.event(i)->delta_t_in_ticks;
+            capture.add_event(tick, source.event(i)->flags);
+        }
+        return tick;
+    }
+
+    // Returns the index of the first event that fires 'trigger'
+    static size_t find_trigger(const BusTrace& source, BusTrigger& trigger) {
+        for (size_t i = 0; i < source.event_count(); ++i) {
+            if (trigger.add_event(source.event(i)->delta_t_in_ticks, source.event(i)->flags)) {
+                trigger.reset();
+                return i;
+            }
+        }
+        return SIZE_MAX;
+    }
+
+public:
+    static void keeps_events_around_the_trigger() {
+        // GIVEN a capture that keeps 3 events after a NACK
+        BusTrace source(MAX_EVENTS);
+        given_2_messages(source, 0x10);
+        BusTrigger trigger;
+        trigger.on_nack();
+        size_t expected_trigger = find_trigger(source, trigger);
+        BusTrace trace(10);
+        TriggeredTrace capture(trace, trigger, 3, on_complete);
+        callback_count = 0;
+        capture.reset();
+
+        // WHEN it sees the messages
+        replay(source, capture);
+
+        // THEN the trace holds the events leading up to the NACK
+        // AND the 3 events after it
+        TEST_ASSERT_TRUE(capture.is_triggered());
+        TEST_ASSERT_TRUE(capture.is_complete());
+        TEST_ASSERT_EQUAL_UINT32(1, callback_count);
+        TEST_ASSERT_EQUAL_UINT32(10, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(6, capture.trigger_index());
+        size_t first = expected_trigger - capture.trigger_index();
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            TEST_ASSERT_TRUE(*trace.event(i) == *source.event(first + i));
+        }
+    }
+
+    static void time_extensions_are_not_post_trigger_events() {
+        // GIVEN a capture that keeps 3 events after a START
+        BusTrigger trigger;
+        trigger.on_start();
+        BusTrace trace(10);
+        TriggeredTrace capture(trace, trigger, 3);
+        capture.reset();
+        uint32_t tick = 0;
+        const BusEventFlags start = SDA_LINE_CHANGED | SCL_LINE_STATE;
+        capture.add_event(tick, SDA_LINE_STATE | SCL_LINE_STATE);
+        capture.add_event(tick += 100, start);
+
+        // WHEN each of the following events comes after a gap of more than 65535 ticks
+        capture.add_event(tick += 100'000, SCL_LINE_CHANGED);
+        capture.add_event(tick += 100'000, SDA_LINE_CHANGED | SDA_LINE_STATE);
+        TEST_ASSERT_FALSE(capture.is_complete());
+        capture.add_event(tick += 100'000, SCL_LINE_CHANGED | SCL_LINE_STATE | SDA_LINE_STATE);
+
+        // THEN the capture completes after 3 events, not 3 slots
+        TEST_ASSERT_TRUE(capture.is_complete());
+        TEST_ASSERT_EQUAL_UINT32(8, trace.event_count());
+        // AND the trigger index points at the START
+        TEST_ASSERT_EQUAL_UINT32(1, capture.trigger_index());
+        TEST_ASSERT_TRUE(BusEvent(100, start) == *trace.event(capture.trigger_index()));
+    }
+
+    static void ignores_events_after_capture_is_complete() {
+        // GIVEN a capture that has completed on the first START
+        BusTrace source(MAX_EVENTS);
+        given_2_messages(source, 0x10);
+        BusTrigger trigger;
+        trigger.on_start();
+        BusTrace trace(10);
+        TriggeredTrace capture(trace, trigger, 2);
+        capture.reset();
+
+        // WHEN it sees the rest of the messages
+        replay(source, capture);
+
+        // THEN it keeps the idle bus, the START and 2 more events
+        TEST_ASSERT_TRUE(capture.is_complete());
+        TEST_ASSERT_EQUAL_UINT32(4, trace.event_count());
+        TEST_ASSERT_EQUAL_UINT32(1, capture.trigger_index());
+        TEST_ASSERT_EQUAL_UINT32(0, trace.overwritten_event_count());
+    }
+
+    static void keeps_latest_events_until_triggered() {
+        // GIVEN a capture whose trigger never fires
+        BusTrace source(MAX_EVENTS);
+        given_2_messages(source, 0x10);
+        BusTrigger trigger;
+        trigger.on_address(0x7F);
+        BusTrace trace(10);
+        TriggeredTrace capture(trace, trigger, 2);
+        capture.reset();
+
+        // WHEN it sees the messages
+        replay(source, capture);
+
+        // THEN it holds the most recent events
+        TEST_ASSERT_FALSE(capture.is_triggered());
+        TEST_ASSERT_FALSE(capture.is_complete());
+        TEST_ASSERT_EQUAL_UINT32(SIZE_MAX, capture.trigger_index());
+        TEST_ASSERT_EQUAL_UINT32(10, trace.event_count());
+        TEST_ASSERT_TRUE(*trace.event(9) == *source.event(source.event_count() - 1));
+    }
+
+    static void rearm_starts_another_capture() {
+        // GIVEN a capture that has completed on the first START
+        BusTrace source(MAX_EVENTS);
+        given_2_messages(source, 0x10);
+        BusTrigger trigger;
+        trigger.on_start();
+        BusTrace trace(10);
+        TriggeredTrace capture(trace, trigger, 2);
+        capture.reset();
+        uint32_t tick = replay(source, capture);
+        TEST_ASSERT_TRUE(capture.is_complete());
+
+        // WHEN it's rearmed
+        capture.rearm();
+
+        // THEN it waits for the trigger again
+        TEST_ASSERT_FALSE(capture.is_triggered());
+        TEST_ASSERT_EQUAL_UINT32(0, trace.event_count());
+
+        // AND the next event is timed from the last one
+        capture.add_event(tick + 7, SCL_LINE_STATE | SDA_LINE_STATE);
+        TEST_ASSERT_EQUAL_UINT32(7, trace.event(0)->delta_t_in_ticks);
+    }
+
+    void test() final {
+        RUN_TEST(keeps_events_around_the_trigger);
+        RUN_TEST(time_extensions_are_not_post_trigger_events);
+        RUN_TEST(ignores_events_after_capture_is_complete);
+        RUN_TEST(keeps_latest_events_until_triggered);
+        RUN_TEST(rearm_starts_another_capture);
+    }
+
+    TriggeredTraceTest() : TestSuite(__FILE__) {};
+};
+
+size_t TriggeredTraceTest::callback_count = 0;
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_TRIGGERED_TRACE_TEST_H
@@ -0,0 +1,153 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_VCD_WRITER_TEST_H
+#define I2C_UNDERNEATH_VCD_WRITER_TEST_H
+#include <unity.h>
+#include <Arduino.h>
+#include "utils/test_suite.h"
+#include "fakes/fake_serial.h"
+#include "fakes/common/hal/fake_clock.h"
+#include "common/hal/fixed_rate_clock.h"
+#include "bus_trace/bus_trace_builder.h"
+#include "bus_trace/vcd_writer.h"
+
+namespace bus_trace {
+
+class VcdWriterTest : public TestSuite {
+    static const size_t MAX_EVENTS = 1024;
+
+    static String header() {
+        String expected = "$version i2c-underneath BusTrace $end\n";
+        expected += "$timescale 1ns $end\n";
+        expected += "$scope module i2c $end\n";
+        expected += "$var wire 1 ! SDA $end\n";
+        expected += "$var wire 1 \" SCL $end\n";
+        expected += "$upscope $end\n";
+        expected += "$enddefinitions $end\n";
+        return expected;
+    }
+
+public:
+    static void write_trace() {
+        // GIVEN a START condition
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.add_event(BusEvent(7, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(200, BusEventFlags::SCL_LINE_CHANGED));
+        // AND an event where both lines changed
+        trace.add_event(BusEvent(50, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+
+        // WHEN we write it as a VCD file
+        FakeSerial serial;
+        size_t count = VcdWriter::write(trace, serial);
+
+        // THEN the times are in nanoseconds
+        String expected = header();
+        expected += "#0\n$dumpvars\n1!\n1\"\n$end\n";
+        expected += "#200\n0!\n";
+        expected += "#600\n0\"\n";
+        expected += "#700\n1!\n1\"\n";
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), serial.get_string().c_str());
+        TEST_ASSERT_EQUAL_UINT32(expected.length(), count);
+    }
+
+    static void write_trace_without_clock() {
+        // GIVEN a trace without a clock
+        BusTrace trace(MAX_EVENTS);
+        trace.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(100, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+
+        // WHEN we write it
+        FakeSerial serial;
+        VcdWriter::write(trace, serial);
+
+        // THEN the times are in ticks
+        String expected = "$version i2c-underneath BusTrace $end\n";
+        expected += "$comment Times are in clock ticks not nanoseconds $end\n";
+        expected += "$timescale 1ns $end\n";
+        TEST_ASSERT_EQUAL_INT(0, strncmp(expected.c_str(), serial.get_string().c_str(), expected.length()));
+        String end = "#100\n0!\n";
+        const String& actual = serial.get_string();
+        TEST_ASSERT_EQUAL_STRING(end.c_str(), actual.c_str() + actual.length() - end.length());
+    }
+
+    static void time_extensions_add_to_the_time() {
+        // GIVEN a trace with a long gap
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        auto flags = BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE;
+        trace.add_event(BusEvent::time_extension(0x7FFF0010, flags));
+        trace.add_event(BusEvent(0x0010, flags));
+
+        // WHEN we write it
+        FakeSerial serial;
+        VcdWriter::write(trace, serial);
+
+        // THEN the time is exact even though it's larger than 32 bits in nanos
+        String end = "#4294836256\n0!\n";   // 0x7FFF0010 ticks * 2 nanos per tick
+        const String& actual = serial.get_string();
+        TEST_ASSERT_EQUAL_STRING(end.c_str(), actual.c_str() + actual.length() - end.length());
+    }
+
+    static void slow_clock_times_are_exact() {
+        // GIVEN a trace recorded with a 10 kHz clock
+        // AND a gap that's longer than 32 bits in nanos
+        common::hal::FixedRateClock clock(10'000);
+        BusTrace trace(&clock, MAX_EVENTS);
+        trace.add_event(BusEvent(0, BusEventFlags::SDA_LINE_STATE | BusEventFlags::SCL_LINE_STATE));
+        trace.add_event(BusEvent(60'000, BusEventFlags::SDA_LINE_CHANGED | BusEventFlags::SCL_LINE_STATE));
+
+        // WHEN we write it
+        FakeSerial serial;
+        VcdWriter::write(trace, serial);
+
+        // THEN the time doesn't overflow
+        String end = "#6000000000\n0!\n";   // 60,000 ticks * 100,000 nanos per tick
+        const String& actual = serial.get_string();
+        TEST_ASSERT_EQUAL_STRING(end.c_str(), actual.c_str() + actual.length() - end.length());
+    }
+
+    static void write_events_incrementally() {
+        // GIVEN a long trace
+        common::hal::FakeClock clock;
+        BusTrace trace(&clock, MAX_EVENTS);
+        BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::FastMode);
+        builder.bus_initially_idle();
+        for (uint8_t i = 0; i < 10; ++i) {
+            builder.start_bit().address_byte(0x53, BusTraceBuilder::WRITE).ack().data_byte(i).ack().stop_bit();
+        }
+
+        // WHEN we write the events one at a time
+        FakeSerial serial;
+        VcdWriter writer(serial, &clock);
+        writer.write_header();
+        for (size_t i = 0; i < trace.event_count(); ++i) {
+            writer.add_event(*trace.event(i));
+        }
+        writer.flush();
+
+        // THEN we get the same output as writing the whole trace
+        FakeSerial expected;
+        VcdWriter::write(trace, expected);
+        TEST_ASSERT_EQUAL_STRING(expected.get_string().c_str(), serial.get_string().c_str());
+        TEST_ASSERT_EQUAL_UINT32(serial.get_string().length(), writer.bytes_written());
+    }
+
+    // Include all the tests here
+    void test() final {
+        RUN_TEST(write_trace);
+        RUN_TEST(write_trace_without_clock);
+        RUN_TEST(time_extensions_add_to_the_time);
+        RUN_TEST(slow_clock_times_are_exact);
+        RUN_TEST(write_events_incrementally);
+    }
+
+    VcdWriterTest() : TestSuite(__FILE__) {};
+};
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_VCD_WRITER_TEST_H
@@ -0,0 +1,44 @@
+// Copyright (c) 2022 Richard Gemmell
+// Released under the MIT License. See license.txt. (https://opensource.org/licenses/MIT)
+
+#ifndef I2C_UNDERNEATH_TEST_BUS_TRACE_FIXTURES_H
+#define I2C_UNDERNEATH_TEST_BUS_TRACE_FIXTURES_H
+
+#include <cstdint>
+#include "bus_trace/bus_trace.h"
+#include "bus_trace/bus_trace_builder.h"
+
+// Traces of I2C messages that are shared by several test suites.
+namespace bus_trace {
+
+// Adds a write of 0x58 to 0x53 followed by a read of 0xA7 from
+// 'read_address' that ends with a NACK. The bus is idle to begin with.
+inline void given_2_messages(BusTrace& trace, uint8_t read_address = 0x53) {
+    BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+    builder.bus_initially_idle()
+            .start_bit()
+            .address_byte(0x53, BusTraceBuilder::WRITE).ack()
+            .data_byte(0x58).ack()
+            .stop_bit()
+            .start_bit()
+            .address_byte(read_address, BusTraceBuilder::READ).ack()
+            .data_byte(0xA7).nack()
+            .stop_bit();
+}
+
+// Adds 5 writes to 0x53. Message i writes the byte 0x58 + i.
+// The bus is idle to begin with.
+inline void given_messages(BusTrace& trace) {
+    BusTraceBuilder builder(trace, BusTraceBuilder::TimingStrategy::Min, common::i2c_specification::StandardMode);
+    builder.bus_initially_idle();
+    for (uint8_t i = 0; i < 5; ++i) {
+        builder.start_bit()
+                .address_byte(0x53, BusTraceBuilder::WRITE).ack()
+                .data_byte(0x58 + i).ack()
+                .stop_bit();
+    }
+}
+
+} // bus_trace
+
+#endif //I2C_UNDERNEATH_TEST_BUS_TRACE_FIXTURES_H